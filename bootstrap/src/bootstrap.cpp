@@ -46,6 +46,12 @@ private:
 
         qt_spy::ProbeOptions options;
         options.autoStart = true;
+        // The host may be arbitrarily large; instrument only what clients look at.
+        options.lazyAttach = true;
+        // Never hold up the host's frames for long, whatever a client asks for.
+        options.snapshotTimeBudgetMs = 4;
+        // Let a client that lost its connection pick up where it left off.
+        options.resumeWindowMs = 30000;
         // Use the core application instance as parent when available to align lifetimes.
         QObject *parent = context ? context : QCoreApplication::instance();
         m_probe = new qt_spy::Probe(options, parent);
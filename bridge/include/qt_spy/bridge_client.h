@@ -1,17 +1,60 @@
 #pragma once
 
+#include "qt_spy/bridge_reply.h"
 #include "qt_spy/protocol.h"
+#include "qt_spy/wire_format.h"
 
+#include <QHash>
 #include <QObject>
 #include <QLocalSocket>
 #include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+
+class QThread;
 
 namespace qt_spy {
 
+// Limits what the helper reads and sends per node. See protocol::fields for
+// the accepted tokens; an empty mask requests everything.
+struct FieldMask {
+    QStringList fields;
+    QStringList propertyNames;
+
+    bool isEmpty() const { return fields.isEmpty() && propertyNames.isEmpty(); }
+};
+
+struct SnapshotOptions {
+    // Deliver the tree as snapshotBegin, snapshotChunk... and snapshotEnd
+    // instead of a single snapshot message.
+    bool chunked = false;
+    int chunkSize = 0; // nodes per chunk; 0 lets the helper pick
+    FieldMask mask;
+    // Only this node and its descendants; the reply echoes it as rootId.
+    NodeId rootId = protocol::kInvalidNodeId;
+    // Levels below the root(s) to include; nodes at the limit report
+    // childCount instead of childIds. -1 means no limit.
+    int maxDepth = -1;
+};
+
 class BridgeClient : public QObject {
     Q_OBJECT
 public:
+    static constexpr int kDefaultRequestTimeoutMs = 30000;
+
+    // Where the socket is read and frames are decoded. WorkerThread keeps the
+    // reading and parsing of large snapshots off the client's own (usually GUI)
+    // thread; signals are emitted on the client's thread either way.
+    enum class IoMode {
+        SameThread,
+        WorkerThread,
+    };
+
     explicit BridgeClient(QObject *parent = nullptr);
+    explicit BridgeClient(IoMode ioMode, QObject *parent = nullptr);
+    ~BridgeClient() override;
+
+    IoMode ioMode() const;
 
     void connectToServer(const QString &serverName);
     void disconnectFromServer();
@@ -19,14 +62,69 @@ public:
     QLocalSocket::LocalSocketState state() const;
     QString serverName() const;
 
+    // Encoding offered in the next attach. The helper confirms its choice in
+    // hello; until then, and against helpers without CBOR support, JSON is used.
+    void setPreferredEncoding(protocol::Encoding encoding);
+    protocol::Encoding preferredEncoding() const;
+    protocol::Encoding encoding() const;
+
+    // Whether the next attach offers to inflate compressed frames (on by
+    // default), and whether the helper accepted in its last hello.
+    void setFrameCompression(bool offered);
+    bool frameCompressionNegotiated() const;
+
+    // Whether attach asks to resume the previous session (off by default).
+    // After a dropped connection the helper then replays only the events
+    // missed meanwhile, provided a full snapshot had been received and no
+    // update was lost since; resumed() tells whether the last hello did so.
+    // When it did not, a new snapshot is needed as usual.
+    void setResumeEnabled(bool enabled);
+    bool resumeEnabled() const;
+    bool resumed() const;
+    // Makes the next attach start over, for a consumer that dropped what it
+    // had received.
+    void forgetSession();
+    QString session() const;
+    // seq of the newest event or snapshot received in the session; 0 before
+    // any.
+    quint64 lastSequence() const;
+
     void sendAttach(const QString &clientName = QString(),
                     int protocolVersion = qt_spy::protocol::kVersion);
     void sendDetach(const QString &requestId = QString());
     void requestSnapshot(const QString &requestId = QString());
-    void requestProperties(const QString &id, const QString &requestId = QString());
-    void selectNode(const QString &id, const QString &requestId = QString());
+    void requestSnapshot(const QString &requestId, const SnapshotOptions &options);
+    void requestProperties(NodeId id, const QString &requestId = QString(),
+                           const FieldMask &mask = FieldMask());
+    void selectNode(NodeId id, const QString &requestId = QString());
+    // propertiesChanged is only sent for subscribed nodes; propertyNames
+    // narrows a subscription, empty means every property. maxRateHz caps the
+    // updates per property (0 = unlimited, negative = the probe's default).
+    void subscribe(const QVector<NodeId> &ids, const QStringList &propertyNames = QStringList(),
+                   const QString &requestId = QString(), double maxRateHz = -1.0);
+    void unsubscribe(const QVector<NodeId> &ids, const QString &requestId = QString());
+    // The helper's own counters and latency histograms; see ProbeStats.
+    void requestStats(const QString &requestId = QString());
     void sendRaw(const QJsonObject &message);
 
+    // Correlated requests: each call tags the message with a fresh requestId
+    // and returns the reply that collects the answer, so callers can keep
+    // many requests in flight instead of matching requestIds by hand. The
+    // signals above still fire for every answer.
+    BridgeReply *sendRequest(const QJsonObject &message);
+    BridgeReply *sendSnapshotRequest(const SnapshotOptions &options = SnapshotOptions());
+    BridgeReply *sendPropertiesRequest(NodeId id, const FieldMask &mask = FieldMask());
+    BridgeReply *sendSelectNode(NodeId id);
+    BridgeReply *sendSubscribe(const QVector<NodeId> &ids,
+                               const QStringList &propertyNames = QStringList(),
+                               double maxRateHz = -1.0);
+    BridgeReply *sendUnsubscribe(const QVector<NodeId> &ids);
+    BridgeReply *sendStatsRequest();
+    // Timeout given to each new reply; 0 or less waits indefinitely.
+    void setRequestTimeout(int msecs);
+    int requestTimeout() const;
+    int pendingRequestCount() const;
+
 signals:
     void socketConnected();
     void socketDisconnected();
@@ -34,29 +132,73 @@ signals:
 
     void helloReceived(const QJsonObject &message);
     void snapshotReceived(const QJsonObject &message);
+    // Chunked snapshots: begin carries rootIds and selection, each chunk a
+    // slice of nodes in parent-before-child order, end the totals.
+    void snapshotBegun(const QJsonObject &message);
+    void snapshotChunkReceived(const QJsonObject &message);
+    void snapshotFinished(const QJsonObject &message);
     void propertiesReceived(const QJsonObject &message);
     void selectionAckReceived(const QJsonObject &message);
+    void subscriptionAckReceived(const QJsonObject &message);
     void nodeAdded(const QJsonObject &message);
     void nodeRemoved(const QJsonObject &message);
+    // One per changed object, carrying only the changed values in
+    // "properties" (dynamic ones under "__dynamic") and their names in "changed".
     void propertiesChanged(const QJsonObject &message);
+    // The helper dropped updates for this client; only a new snapshot brings
+    // the view back in sync.
+    void resyncRequired(const QJsonObject &message);
+    void statsReceived(const QJsonObject &message);
     void errorReceived(const QJsonObject &message);
     void goodbyeReceived(const QJsonObject &message);
     void genericMessageReceived(const QJsonObject &message);
 
-private slots:
+private:
+    class Io;
+
+    // Reported by the Io object, directly or queued from the worker.
     void handleConnected();
     void handleDisconnected();
-    void handleError(QLocalSocket::LocalSocketError error);
-    void handleReadyRead();
+    void handleStateChanged(QLocalSocket::LocalSocketState state);
+    void handleError(QLocalSocket::LocalSocketError error, const QString &errorString);
+    void dispatchMessage(protocol::MessageType type, const QJsonObject &message);
+    void noteSequence(const QJsonObject &message);
 
-private:
     void writeMessage(const QJsonObject &message);
-    void processIncomingBuffer();
-    void dispatchMessage(const QJsonObject &message);
+    void routeReply(protocol::MessageType type, const QJsonObject &message);
+    void failPendingReplies(BridgeReply::Status status, const QString &errorString);
+    // Request messages without a requestId; empty when the arguments do not
+    // make a valid request.
+    static QJsonObject snapshotRequestMessage(const SnapshotOptions &options);
+    static QJsonObject propertiesRequestMessage(NodeId id, const FieldMask &mask);
+    static QJsonObject selectNodeMessage(NodeId id);
+    static QJsonObject subscriptionMessage(const char *type, const QVector<NodeId> &ids);
+    static QJsonObject subscribeMessage(const QVector<NodeId> &ids,
+                                        const QStringList &propertyNames, double maxRateHz);
+    static QJsonObject withRequestId(QJsonObject message, const QString &requestId);
+    static void applyFieldMask(QJsonObject &message, const FieldMask &mask);
 
     QString m_serverName;
-    QLocalSocket m_socket;
-    QByteArray m_buffer;
+    IoMode m_ioMode = IoMode::SameThread;
+    QThread *m_ioThread = nullptr;
+    Io *m_io = nullptr;
+    // Last state the socket reported; behind the socket in WorkerThread mode.
+    QLocalSocket::LocalSocketState m_state = QLocalSocket::UnconnectedState;
+    protocol::Encoding m_preferredEncoding = protocol::Encoding::Json;
+    protocol::Encoding m_encoding = protocol::Encoding::Json;
+    bool m_offerCompression = true;
+    bool m_compressionNegotiated = false;
+    bool m_resumeEnabled = false;
+    bool m_resumed = false;
+    QString m_session;
+    quint64 m_lastSeq = 0;
+    // A full snapshot of the session was received and no update lost since,
+    // so everything up to m_lastSeq is known and the session can be resumed.
+    bool m_inSync = false;
+    bool m_fullSnapshotStreaming = false;
+    QHash<QString, BridgeReply *> m_pendingReplies;
+    quint64 m_lastRequestSerial = 0;
+    int m_requestTimeout = kDefaultRequestTimeoutMs;
 };
 
 } // namespace qt_spy
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "qt_spy/protocol.h"
+
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+namespace qt_spy {
+
+class BridgeClient;
+
+// The answer to one request sent with BridgeClient::sendRequest() or one of
+// its typed wrappers. Replies are matched on a requestId the client assigns, so
+// any number can be in flight on one connection. A reply finishes exactly
+// once: with the answer, with an error the helper raised for the request, or
+// when it times out, is canceled or loses its connection. The client owns it;
+// release it with deleteLater() once finished, as with QNetworkReply.
+class BridgeReply : public QObject {
+    Q_OBJECT
+public:
+    enum class Status {
+        Pending,
+        Finished,     // message() holds the answer
+        Error,        // message() holds the helper's error, if it sent one
+        TimedOut,
+        Canceled,
+        Disconnected, // the connection closed first, or was never open
+    };
+    Q_ENUM(Status)
+
+    QString requestId() const;
+    protocol::MessageType requestType() const;
+    Status status() const;
+    bool isFinished() const;
+    QJsonObject message() const;
+    // Why a reply did not finish with Finished; empty otherwise.
+    QString errorString() const;
+
+    // Restarts the countdown from now; 0 or less waits indefinitely.
+    void setTimeout(int msecs);
+    // Finishes as Canceled. The helper still answers, but the answer is no
+    // longer routed here.
+    void cancel();
+
+signals:
+    // snapshotBegin and each snapshotChunk of a chunked snapshot, which
+    // finishes with snapshotEnd.
+    void partReceived(const QJsonObject &message);
+    void finished();
+
+private:
+    friend class BridgeClient;
+
+    BridgeReply(const QString &requestId, protocol::MessageType requestType, QObject *parent);
+    void finish(Status status, const QJsonObject &message = QJsonObject(),
+                const QString &errorString = QString());
+
+    QString m_requestId;
+    protocol::MessageType m_requestType;
+    Status m_status = Status::Pending;
+    QJsonObject m_message;
+    QString m_errorString;
+    QTimer m_timeout;
+};
+
+} // namespace qt_spy
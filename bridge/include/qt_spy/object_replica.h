@@ -0,0 +1,142 @@
+#pragma once
+
+#include "qt_spy/protocol.h"
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace qt_spy {
+
+class BridgeClient;
+
+// One object as the replica holds it.
+struct ReplicaNode {
+    NodeId id = protocol::kInvalidNodeId;
+    NodeId parentId = protocol::kInvalidNodeId;
+    QString className;
+    QString objectName;
+    QVector<NodeId> childIds;
+    // Children the helper did not send because of a snapshot's depth limit;
+    // childIds is empty until a subtree snapshot fills them in.
+    int childCount = 0;
+    QJsonObject properties;
+    // The rest of the node as sent: address and the widget/window block.
+    QJsonObject details;
+
+    bool isValid() const { return id != protocol::kInvalidNodeId; }
+};
+
+// A client-side copy of the helper's object tree, kept current by applying
+// snapshots, chunked snapshots, subtree snapshots, nodeAdded, nodeRemoved and
+// propertiesChanged as they arrive. Nodes live in parallel arrays indexed by
+// slot, with class names interned and indexes by id, class and objectName, so
+// lookups do not walk the tree or touch JSON.
+class ObjectReplica : public QObject {
+    Q_OBJECT
+public:
+    explicit ObjectReplica(QObject *parent = nullptr);
+
+    // Applies everything the client receives from now on; nullptr detaches.
+    // The replica does not request snapshots itself.
+    void attach(BridgeClient *client);
+
+    void applySnapshot(const QJsonObject &snapshot);
+    void applySnapshotBegin(const QJsonObject &begin);
+    void applySnapshotChunk(const QJsonObject &chunk);
+    void applySnapshotEnd(const QJsonObject &end);
+    void applyNodeAdded(const QJsonObject &message);
+    void applyNodeRemoved(const QJsonObject &message);
+    // One change per call as BridgeClient::propertiesChanged emits them, or a
+    // batch with "changes". Properties replies are merged the same way.
+    void applyPropertiesChanged(const QJsonObject &message);
+    void clear();
+
+    int size() const;
+    bool contains(NodeId id) const;
+    QVector<NodeId> rootIds() const;
+    // A default ReplicaNode if the id is unknown.
+    ReplicaNode node(NodeId id) const;
+    NodeId parentId(NodeId id) const;
+    QVector<NodeId> childIds(NodeId id) const;
+    // The known children, or as many as the helper reported for a node cut
+    // off by a depth limit.
+    int childCount(NodeId id) const;
+    QString className(NodeId id) const;
+    QString objectName(NodeId id) const;
+    QJsonObject properties(NodeId id) const;
+
+    // Ascending ids. Unnamed objects are not indexed by name.
+    QVector<NodeId> findByClass(const QString &className) const;
+    QVector<NodeId> findByObjectName(const QString &objectName) const;
+
+    // False from snapshotBegin until snapshotEnd of a full chunked snapshot.
+    bool isComplete() const;
+
+signals:
+    // A full snapshot is replacing the contents: emitted for a snapshot once
+    // it is applied and at snapshotBegin, with the chunks still to come.
+    void reset();
+    // A full snapshot has been applied in its entirety.
+    void snapshotApplied();
+    void nodeAdded(qt_spy::NodeId id, qt_spy::NodeId parentId);
+    // A known node was sent again, by a subtree snapshot or nodeAdded.
+    void nodeUpdated(qt_spy::NodeId id);
+    // Once per removed subtree, for its root, after the descendants are gone.
+    void nodeRemoved(qt_spy::NodeId id, qt_spy::NodeId parentId);
+    void propertiesChanged(qt_spy::NodeId id, const QStringList &names);
+
+private:
+    static constexpr int kNoSlot = -1;
+
+    void clearStore();
+    int slotOf(NodeId id) const;
+    int allocateSlot(NodeId id);
+    void releaseSlot(int slot);
+    int internClass(const QString &className);
+    void indexClass(int slot, int classIndex);
+    void unindexClass(int slot);
+    void indexName(int slot);
+    void unindexName(int slot);
+    void applyNodes(const QJsonArray &nodes, bool notify);
+    void applyPropertyChange(const QJsonObject &change);
+    // Inserts or refreshes one node from its wire form; returns its slot.
+    int storeNode(const QJsonObject &json, bool *added);
+    void removeSubtree(int slot);
+    void detachFromParent(NodeId id, NodeId parentId);
+    QStringList mergeProperties(int slot, const QJsonObject &properties);
+
+    // Per slot.
+    QVector<NodeId> m_ids;
+    QVector<NodeId> m_parents;
+    QVector<int> m_classes;
+    QVector<QString> m_objectNames;
+    QVector<QVector<NodeId>> m_children;
+    QVector<int> m_childCounts;
+    QVector<QJsonObject> m_properties;
+    QVector<QJsonObject> m_details;
+    // Where each slot sits in its class and name buckets, for O(1) removal.
+    QVector<int> m_classPositions;
+    QVector<int> m_namePositions;
+    QVector<int> m_freeSlots;
+
+    QHash<NodeId, int> m_slotById;
+    QVector<QString> m_classNames;
+    QHash<QString, int> m_classIndex;
+    QVector<QVector<int>> m_slotsByClass;
+    QHash<QString, QVector<int>> m_slotsByName;
+    QVector<NodeId> m_rootIds;
+
+    QPointer<BridgeClient> m_client;
+
+    // Chunked snapshot in progress: full (the replica was cleared) or subtree.
+    bool m_streaming = false;
+    bool m_streamingSubtree = false;
+};
+
+} // namespace qt_spy
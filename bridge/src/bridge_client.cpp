@@ -1,42 +1,218 @@
 #include "qt_spy/bridge_client.h"
 
-#include <QJsonDocument>
-#include <QJsonParseError>
-#include <QtEndian>
+#include <QJsonArray>
+#include <QThread>
 
 namespace qt_spy {
 
+namespace {
+
+struct DecodedMessage {
+    protocol::MessageType type = protocol::MessageType::Unknown;
+    QJsonObject message;
+};
+
+DecodedMessage frameError(const QString &code, const QString &text)
+{
+    DecodedMessage decoded;
+    decoded.type = protocol::MessageType::Error;
+    decoded.message[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kError);
+    decoded.message[QStringLiteral("code")] = code;
+    decoded.message[QStringLiteral("message")] = text;
+    return decoded;
+}
+
+DecodedMessage decodeFrame(quint32 header, QByteArray payload)
+{
+    QString parseError;
+    if (protocol::isCompressedFrame(header)
+        && !protocol::inflatePayload(payload, &payload, &parseError)) {
+        return frameError(QStringLiteral("invalidFrame"),
+                          QStringLiteral("Bridge client failed to inflate helper message: %1")
+                              .arg(parseError));
+    }
+
+    DecodedMessage decoded;
+    if (!protocol::decodePayload(payload, &decoded.message, &parseError)) {
+        const bool isCbor = protocol::detectEncoding(payload) == protocol::Encoding::Cbor;
+        return frameError(isCbor ? QStringLiteral("invalidCbor") : QStringLiteral("invalidJson"),
+                          QStringLiteral("Bridge client failed to parse helper message: %1")
+                              .arg(parseError));
+    }
+    decoded.type = protocol::messageTypeFromName(
+        decoded.message.value(QLatin1String(protocol::keys::kType)).toString());
+    return decoded;
+}
+
+} // namespace
+
+// Owns the socket and turns its bytes into messages, on the client's thread or
+// on the I/O worker. Everything it reports goes through report(), which calls
+// the client directly when both share a thread and queues the call otherwise.
+class BridgeClient::Io : public QObject {
+public:
+    explicit Io(BridgeClient *client)
+        : m_client(client)
+        , m_socket(new QLocalSocket(this))
+    {
+        connect(m_socket, &QLocalSocket::stateChanged, this,
+                [this](QLocalSocket::LocalSocketState state) {
+                    report([state](BridgeClient *client) { client->handleStateChanged(state); });
+                });
+        connect(m_socket, &QLocalSocket::connected, this, [this]() {
+            report([](BridgeClient *client) { client->handleConnected(); });
+        });
+        connect(m_socket, &QLocalSocket::disconnected, this, [this]() {
+            m_reader.clear();
+            report([](BridgeClient *client) { client->handleDisconnected(); });
+        });
+        connect(m_socket, &QLocalSocket::errorOccurred, this,
+                [this](QLocalSocket::LocalSocketError error) {
+                    const QString errorString = m_socket->errorString();
+                    report([error, errorString](BridgeClient *client) {
+                        client->handleError(error, errorString);
+                    });
+                });
+        connect(m_socket, &QLocalSocket::readyRead, this, &Io::readFrames);
+    }
+
+    ~Io() override
+    {
+        // Closing the socket on the way out is not news to the client.
+        disconnect(m_socket, nullptr, this, nullptr);
+    }
+
+    void connectToServer(const QString &serverName)
+    {
+        if (m_socket->state() == QLocalSocket::UnconnectedState) {
+            m_socket->connectToServer(serverName);
+        }
+    }
+
+    void disconnectFromServer()
+    {
+        if (m_socket->state() != QLocalSocket::UnconnectedState) {
+            m_socket->disconnectFromServer();
+        }
+    }
+
+    void write(const QByteArray &frame)
+    {
+        if (m_socket->state() != QLocalSocket::ConnectedState) {
+            return;
+        }
+        m_socket->write(frame);
+        m_socket->flush();
+    }
+
+private:
+    template <typename Func>
+    void report(Func func)
+    {
+        BridgeClient *client = m_client;
+        QMetaObject::invokeMethod(
+            client, [client, func]() { func(client); }, Qt::AutoConnection);
+    }
+
+    void readFrames()
+    {
+        m_reader.readFrom(m_socket);
+
+        quint32 header = 0;
+        QByteArray payload;
+        if (m_client->thread() == QThread::currentThread()) {
+            // Dispatch as each frame is decoded, so a handler that disconnects
+            // stops the rest of the burst.
+            while (m_reader.next(&header, &payload)) {
+                const DecodedMessage decoded = decodeFrame(header, payload);
+                m_client->dispatchMessage(decoded.type, decoded.message);
+            }
+            return;
+        }
+
+        // One queued call per read rather than per frame.
+        QVector<DecodedMessage> batch;
+        while (m_reader.next(&header, &payload)) {
+            batch.append(decodeFrame(header, payload));
+        }
+        if (batch.isEmpty()) {
+            return;
+        }
+        report([batch = std::move(batch)](BridgeClient *client) {
+            for (const DecodedMessage &decoded : batch) {
+                client->dispatchMessage(decoded.type, decoded.message);
+            }
+        });
+    }
+
+    BridgeClient *m_client;
+    QLocalSocket *m_socket;
+    protocol::FrameReader m_reader;
+};
+
 BridgeClient::BridgeClient(QObject *parent)
+    : BridgeClient(IoMode::SameThread, parent)
+{
+}
+
+BridgeClient::BridgeClient(IoMode ioMode, QObject *parent)
     : QObject(parent)
+    , m_ioMode(ioMode)
+    , m_io(new Io(this))
+{
+    if (m_ioMode == IoMode::WorkerThread) {
+        m_ioThread = new QThread(this);
+        m_ioThread->setObjectName(QStringLiteral("qt-spy bridge I/O"));
+        m_io->moveToThread(m_ioThread);
+        connect(m_ioThread, &QThread::finished, m_io, &QObject::deleteLater);
+        m_ioThread->start();
+    } else {
+        m_io->setParent(this);
+    }
+}
+
+BridgeClient::~BridgeClient()
 {
-    connect(&m_socket, &QLocalSocket::connected, this, &BridgeClient::handleConnected);
-    connect(&m_socket, &QLocalSocket::disconnected, this, &BridgeClient::handleDisconnected);
-    connect(&m_socket, &QLocalSocket::readyRead, this, &BridgeClient::handleReadyRead);
-    connect(&m_socket, &QLocalSocket::errorOccurred, this, &BridgeClient::handleError);
+    if (m_ioThread) {
+        // The Io object, and the socket with it, is deleted as the thread
+        // finishes; whatever it still reports is dropped with this object.
+        m_ioThread->quit();
+        m_ioThread->wait();
+    } else {
+        delete m_io;
+    }
+}
+
+BridgeClient::IoMode BridgeClient::ioMode() const
+{
+    return m_ioMode;
 }
 
 void BridgeClient::connectToServer(const QString &serverName)
 {
-    if (m_socket.state() != QLocalSocket::UnconnectedState) {
+    // The Io object ignores this while its socket is still open. In
+    // WorkerThread mode the state seen here can lag behind a
+    // disconnectFromServer() that has not been carried out yet.
+    if (m_ioMode == IoMode::SameThread && m_state != QLocalSocket::UnconnectedState) {
         return;
     }
 
     m_serverName = serverName;
-    m_socket.connectToServer(serverName);
+    Io *io = m_io;
+    QMetaObject::invokeMethod(
+        io, [io, serverName]() { io->connectToServer(serverName); }, Qt::AutoConnection);
 }
 
 void BridgeClient::disconnectFromServer()
 {
     m_serverName.clear();
-    if (m_socket.state() == QLocalSocket::UnconnectedState) {
-        return;
-    }
-    m_socket.disconnectFromServer();
+    Io *io = m_io;
+    QMetaObject::invokeMethod(io, [io]() { io->disconnectFromServer(); }, Qt::AutoConnection);
 }
 
 QLocalSocket::LocalSocketState BridgeClient::state() const
 {
-    return m_socket.state();
+    return m_state;
 }
 
 QString BridgeClient::serverName() const
@@ -44,6 +220,61 @@ QString BridgeClient::serverName() const
     return m_serverName;
 }
 
+void BridgeClient::setPreferredEncoding(protocol::Encoding encoding)
+{
+    m_preferredEncoding = encoding;
+}
+
+protocol::Encoding BridgeClient::preferredEncoding() const
+{
+    return m_preferredEncoding;
+}
+
+protocol::Encoding BridgeClient::encoding() const
+{
+    return m_encoding;
+}
+
+void BridgeClient::setFrameCompression(bool offered)
+{
+    m_offerCompression = offered;
+}
+
+bool BridgeClient::frameCompressionNegotiated() const
+{
+    return m_compressionNegotiated;
+}
+
+void BridgeClient::setResumeEnabled(bool enabled)
+{
+    m_resumeEnabled = enabled;
+}
+
+bool BridgeClient::resumeEnabled() const
+{
+    return m_resumeEnabled;
+}
+
+bool BridgeClient::resumed() const
+{
+    return m_resumed;
+}
+
+void BridgeClient::forgetSession()
+{
+    m_inSync = false;
+}
+
+QString BridgeClient::session() const
+{
+    return m_session;
+}
+
+quint64 BridgeClient::lastSequence() const
+{
+    return m_lastSeq;
+}
+
 void BridgeClient::sendAttach(const QString &clientName, int protocolVersion)
 {
     QJsonObject message;
@@ -52,11 +283,28 @@ void BridgeClient::sendAttach(const QString &clientName, int protocolVersion)
     if (!clientName.isEmpty()) {
         message[QLatin1String(protocol::keys::kClientName)] = clientName;
     }
+    if (m_preferredEncoding != protocol::Encoding::Json) {
+        QJsonArray encodings;
+        encodings.append(protocol::encodingName(m_preferredEncoding));
+        encodings.append(protocol::encodingName(protocol::Encoding::Json));
+        message[QLatin1String(protocol::keys::kEncodings)] = encodings;
+    }
+    if (m_offerCompression) {
+        message[QLatin1String(protocol::keys::kCompressions)] =
+            QJsonArray{QLatin1String(protocol::compressions::kZlib)};
+    }
+    if (m_resumeEnabled && m_inSync && !m_session.isEmpty()) {
+        message[QLatin1String(protocol::keys::kSession)] = m_session;
+        message[QLatin1String(protocol::keys::kResumeFrom)] = static_cast<qint64>(m_lastSeq);
+    }
     sendRaw(message);
 }
 
 void BridgeClient::sendDetach(const QString &requestId)
 {
+    // The helper forgets a client that detached; the next attach starts over.
+    forgetSession();
+
     QJsonObject message;
     message[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kDetach);
     if (!requestId.isEmpty()) {
@@ -66,50 +314,238 @@ void BridgeClient::sendDetach(const QString &requestId)
 }
 
 void BridgeClient::requestSnapshot(const QString &requestId)
+{
+    requestSnapshot(requestId, SnapshotOptions{});
+}
+
+void BridgeClient::requestSnapshot(const QString &requestId, const SnapshotOptions &options)
+{
+    sendRaw(withRequestId(snapshotRequestMessage(options), requestId));
+}
+
+void BridgeClient::requestProperties(NodeId id, const QString &requestId,
+                                     const FieldMask &mask)
+{
+    const QJsonObject message = propertiesRequestMessage(id, mask);
+    if (message.isEmpty()) {
+        return;
+    }
+    sendRaw(withRequestId(message, requestId));
+}
+
+void BridgeClient::selectNode(NodeId id, const QString &requestId)
+{
+    const QJsonObject message = selectNodeMessage(id);
+    if (message.isEmpty()) {
+        return;
+    }
+    sendRaw(withRequestId(message, requestId));
+}
+
+void BridgeClient::subscribe(const QVector<NodeId> &ids, const QStringList &propertyNames,
+                             const QString &requestId, double maxRateHz)
+{
+    const QJsonObject message = subscribeMessage(ids, propertyNames, maxRateHz);
+    if (message.isEmpty()) {
+        return;
+    }
+    sendRaw(withRequestId(message, requestId));
+}
+
+void BridgeClient::unsubscribe(const QVector<NodeId> &ids, const QString &requestId)
+{
+    const QJsonObject message = subscriptionMessage(protocol::types::kUnsubscribe, ids);
+    if (message.isEmpty()) {
+        return;
+    }
+    sendRaw(withRequestId(message, requestId));
+}
+
+void BridgeClient::requestStats(const QString &requestId)
+{
+    QJsonObject message;
+    message[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kStatsRequest);
+    sendRaw(withRequestId(message, requestId));
+}
+
+void BridgeClient::sendRaw(const QJsonObject &message)
+{
+    writeMessage(message);
+}
+
+BridgeReply *BridgeClient::sendRequest(const QJsonObject &message)
+{
+    const QString requestId = QStringLiteral("bridge-%1").arg(++m_lastRequestSerial);
+    const protocol::MessageType type = protocol::messageTypeFromName(
+        message.value(QLatin1String(protocol::keys::kType)).toString());
+    auto *reply = new BridgeReply(requestId, type, this);
+
+    // Failures known up front are reported from the event loop, once the
+    // caller has had a chance to connect to finished().
+    const auto failLater = [reply](BridgeReply::Status status, const QString &errorString) {
+        QMetaObject::invokeMethod(
+            reply, [reply, status, errorString]() { reply->finish(status, QJsonObject(), errorString); },
+            Qt::QueuedConnection);
+    };
+    if (message.isEmpty()) {
+        failLater(BridgeReply::Status::Error, QStringLiteral("Invalid request"));
+        return reply;
+    }
+    if (m_state != QLocalSocket::ConnectedState) {
+        failLater(BridgeReply::Status::Disconnected, QStringLiteral("Not connected"));
+        return reply;
+    }
+
+    m_pendingReplies.insert(requestId, reply);
+    const auto release = [this, requestId](QObject *object) {
+        const auto it = m_pendingReplies.constFind(requestId);
+        if (it != m_pendingReplies.constEnd() && it.value() == object) {
+            m_pendingReplies.erase(it);
+        }
+    };
+    connect(reply, &BridgeReply::finished, this, [release, reply]() { release(reply); });
+    connect(reply, &QObject::destroyed, this, release);
+    reply->setTimeout(m_requestTimeout);
+
+    writeMessage(withRequestId(message, requestId));
+    return reply;
+}
+
+BridgeReply *BridgeClient::sendSnapshotRequest(const SnapshotOptions &options)
+{
+    return sendRequest(snapshotRequestMessage(options));
+}
+
+BridgeReply *BridgeClient::sendPropertiesRequest(NodeId id, const FieldMask &mask)
+{
+    return sendRequest(propertiesRequestMessage(id, mask));
+}
+
+BridgeReply *BridgeClient::sendSelectNode(NodeId id)
+{
+    return sendRequest(selectNodeMessage(id));
+}
+
+BridgeReply *BridgeClient::sendSubscribe(const QVector<NodeId> &ids,
+                                         const QStringList &propertyNames, double maxRateHz)
+{
+    return sendRequest(subscribeMessage(ids, propertyNames, maxRateHz));
+}
+
+BridgeReply *BridgeClient::sendUnsubscribe(const QVector<NodeId> &ids)
+{
+    return sendRequest(subscriptionMessage(protocol::types::kUnsubscribe, ids));
+}
+
+BridgeReply *BridgeClient::sendStatsRequest()
+{
+    QJsonObject message;
+    message[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kStatsRequest);
+    return sendRequest(message);
+}
+
+void BridgeClient::setRequestTimeout(int msecs)
+{
+    m_requestTimeout = msecs;
+}
+
+int BridgeClient::requestTimeout() const
+{
+    return m_requestTimeout;
+}
+
+int BridgeClient::pendingRequestCount() const
+{
+    return m_pendingReplies.size();
+}
+
+QJsonObject BridgeClient::snapshotRequestMessage(const SnapshotOptions &options)
 {
     QJsonObject message;
     message[QLatin1String(protocol::keys::kType)] =
         QLatin1String(protocol::types::kSnapshotRequest);
-    if (!requestId.isEmpty()) {
-        message[QLatin1String(protocol::keys::kRequestId)] = requestId;
+    if (options.chunked) {
+        message[QLatin1String(protocol::keys::kChunked)] = true;
+        if (options.chunkSize > 0) {
+            message[QLatin1String(protocol::keys::kChunkSize)] = options.chunkSize;
+        }
     }
-    sendRaw(message);
+    if (options.rootId != protocol::kInvalidNodeId) {
+        message[QLatin1String(protocol::keys::kRootId)] = protocol::nodeIdToJson(options.rootId);
+    }
+    if (options.maxDepth >= 0) {
+        message[QLatin1String(protocol::keys::kMaxDepth)] = options.maxDepth;
+    }
+    applyFieldMask(message, options.mask);
+    return message;
 }
 
-void BridgeClient::requestProperties(const QString &id, const QString &requestId)
+QJsonObject BridgeClient::propertiesRequestMessage(NodeId id, const FieldMask &mask)
 {
-    if (id.isEmpty()) {
-        return;
+    if (id == protocol::kInvalidNodeId) {
+        return {};
     }
 
     QJsonObject message;
     message[QLatin1String(protocol::keys::kType)] =
         QLatin1String(protocol::types::kPropertiesRequest);
-    message[QLatin1String(protocol::keys::kId)] = id;
-    if (!requestId.isEmpty()) {
-        message[QLatin1String(protocol::keys::kRequestId)] = requestId;
-    }
-    sendRaw(message);
+    message[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+    applyFieldMask(message, mask);
+    return message;
 }
 
-void BridgeClient::selectNode(const QString &id, const QString &requestId)
+QJsonObject BridgeClient::selectNodeMessage(NodeId id)
 {
-    if (id.isEmpty()) {
-        return;
+    if (id == protocol::kInvalidNodeId) {
+        return {};
     }
 
     QJsonObject message;
     message[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSelectNode);
-    message[QLatin1String(protocol::keys::kId)] = id;
-    if (!requestId.isEmpty()) {
-        message[QLatin1String(protocol::keys::kRequestId)] = requestId;
+    message[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+    return message;
+}
+
+QJsonObject BridgeClient::subscriptionMessage(const char *type, const QVector<NodeId> &ids)
+{
+    if (ids.isEmpty()) {
+        return {};
     }
-    sendRaw(message);
+
+    QJsonArray idValues;
+    for (const NodeId id : ids) {
+        idValues.append(protocol::nodeIdToJson(id));
+    }
+
+    QJsonObject message;
+    message[QLatin1String(protocol::keys::kType)] = QLatin1String(type);
+    message[QLatin1String(protocol::keys::kIds)] = idValues;
+    return message;
 }
 
-void BridgeClient::sendRaw(const QJsonObject &message)
+QJsonObject BridgeClient::subscribeMessage(const QVector<NodeId> &ids,
+                                           const QStringList &propertyNames, double maxRateHz)
 {
-    writeMessage(message);
+    QJsonObject message = subscriptionMessage(protocol::types::kSubscribe, ids);
+    if (message.isEmpty()) {
+        return message;
+    }
+    if (!propertyNames.isEmpty()) {
+        message[QLatin1String(protocol::keys::kPropertyNames)] =
+            QJsonArray::fromStringList(propertyNames);
+    }
+    if (maxRateHz >= 0.0) {
+        message[QLatin1String(protocol::keys::kMaxRateHz)] = maxRateHz;
+    }
+    return message;
+}
+
+QJsonObject BridgeClient::withRequestId(QJsonObject message, const QString &requestId)
+{
+    if (!requestId.isEmpty()) {
+        message[QLatin1String(protocol::keys::kRequestId)] = requestId;
+    }
+    return message;
 }
 
 void BridgeClient::handleConnected()
@@ -119,109 +555,200 @@ void BridgeClient::handleConnected()
 
 void BridgeClient::handleDisconnected()
 {
-    m_buffer.clear();
+    m_state = QLocalSocket::UnconnectedState;
+    m_encoding = protocol::Encoding::Json;
+    m_compressionNegotiated = false;
+    // The session and last seq are kept for the next attach to resume from;
+    // a full snapshot cut short leaves nothing to resume.
+    m_fullSnapshotStreaming = false;
+    failPendingReplies(BridgeReply::Status::Disconnected, QStringLiteral("Connection closed"));
     emit socketDisconnected();
 }
 
-void BridgeClient::handleError(QLocalSocket::LocalSocketError error)
+void BridgeClient::handleStateChanged(QLocalSocket::LocalSocketState state)
 {
-    emit socketError(error, m_socket.errorString());
+    m_state = state;
 }
 
-void BridgeClient::handleReadyRead()
+void BridgeClient::handleError(QLocalSocket::LocalSocketError error, const QString &errorString)
 {
-    m_buffer += m_socket.readAll();
-    processIncomingBuffer();
+    emit socketError(error, errorString);
 }
 
 void BridgeClient::writeMessage(const QJsonObject &message)
 {
-    if (m_socket.state() != QLocalSocket::ConnectedState) {
+    if (m_state != QLocalSocket::ConnectedState) {
         return;
     }
 
-    const QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::Compact);
-
-    QByteArray frame;
-    frame.resize(4);
-    qToBigEndian(static_cast<quint32>(payload.size()), reinterpret_cast<uchar *>(frame.data()));
-    frame.append(payload);
-
-    m_socket.write(frame);
-    m_socket.flush();
+    Io *io = m_io;
+    const QByteArray frame = protocol::encodeFrame(message, m_encoding);
+    QMetaObject::invokeMethod(io, [io, frame]() { io->write(frame); }, Qt::AutoConnection);
 }
 
-void BridgeClient::processIncomingBuffer()
+void BridgeClient::dispatchMessage(protocol::MessageType type, const QJsonObject &message)
 {
-    while (m_buffer.size() >= 4) {
-        const quint32 length = qFromBigEndian<quint32>(
-            reinterpret_cast<const uchar *>(m_buffer.constData()));
-        if (m_buffer.size() < static_cast<int>(length) + 4) {
-            return;
-        }
-
-        const QByteArray payload = m_buffer.mid(4, static_cast<int>(length));
-        m_buffer.remove(0, static_cast<int>(length) + 4);
-
-        QJsonParseError parseError{};
-        const QJsonDocument document = QJsonDocument::fromJson(payload, &parseError);
-        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
-            QJsonObject errorPayload;
-            errorPayload[QLatin1String(protocol::keys::kType)] =
-                QLatin1String(protocol::types::kError);
-            errorPayload[QStringLiteral("code")] = QStringLiteral("invalidJson");
-            errorPayload[QStringLiteral("message")] =
-                QStringLiteral("Bridge client failed to parse helper message: %1")
-                    .arg(parseError.errorString());
-            emit errorReceived(errorPayload);
-            continue;
-        }
-
-        dispatchMessage(document.object());
+    if (!m_pendingReplies.isEmpty()) {
+        routeReply(type, message);
     }
-}
 
-void BridgeClient::dispatchMessage(const QJsonObject &message)
-{
-    const QString type = message.value(QLatin1String(protocol::keys::kType)).toString();
-    if (type == QLatin1String(protocol::types::kHello)) {
+    switch (type) {
+    case protocol::MessageType::Hello: {
+        // Helpers that predate encoding negotiation omit the key: stay on JSON.
+        protocol::Encoding negotiated = protocol::Encoding::Json;
+        protocol::encodingFromName(
+            message.value(QLatin1String(protocol::keys::kEncoding)).toString(), &negotiated);
+        m_encoding = negotiated;
+        m_compressionNegotiated =
+            message.value(QLatin1String(protocol::keys::kCompression)).toString()
+            == QLatin1String(protocol::compressions::kZlib);
+        m_session = message.value(QLatin1String(protocol::keys::kSession)).toString();
+        m_resumed = message.value(QLatin1String(protocol::keys::kResumed)).toBool();
+        if (!m_resumed) {
+            m_lastSeq = 0;
+            m_inSync = false;
+        }
         emit helloReceived(message);
         return;
     }
-    if (type == QLatin1String(protocol::types::kSnapshot)) {
+    case protocol::MessageType::Snapshot:
+        noteSequence(message);
+        if (!message.contains(QLatin1String(protocol::keys::kRootId))) {
+            m_inSync = true;
+        }
         emit snapshotReceived(message);
         return;
-    }
-    if (type == QLatin1String(protocol::types::kProperties)) {
+    case protocol::MessageType::SnapshotBegin:
+        noteSequence(message);
+        if (!message.contains(QLatin1String(protocol::keys::kRootId))) {
+            m_inSync = false;
+            m_fullSnapshotStreaming = true;
+        }
+        emit snapshotBegun(message);
+        return;
+    case protocol::MessageType::SnapshotChunk:
+        emit snapshotChunkReceived(message);
+        return;
+    case protocol::MessageType::SnapshotEnd:
+        if (m_fullSnapshotStreaming) {
+            m_fullSnapshotStreaming = false;
+            m_inSync = true;
+        }
+        emit snapshotFinished(message);
+        return;
+    case protocol::MessageType::Properties:
         emit propertiesReceived(message);
         return;
-    }
-    if (type == QLatin1String(protocol::types::kSelectionAck)) {
+    case protocol::MessageType::SelectionAck:
         emit selectionAckReceived(message);
         return;
-    }
-    if (type == QLatin1String(protocol::types::kNodeAdded)) {
+    case protocol::MessageType::SubscriptionAck:
+        emit subscriptionAckReceived(message);
+        return;
+    case protocol::MessageType::NodeAdded:
+        noteSequence(message);
         emit nodeAdded(message);
         return;
-    }
-    if (type == QLatin1String(protocol::types::kNodeRemoved)) {
+    case protocol::MessageType::NodeRemoved:
+        noteSequence(message);
         emit nodeRemoved(message);
         return;
-    }
-    if (type == QLatin1String(protocol::types::kPropertiesChanged)) {
-        emit propertiesChanged(message);
+    case protocol::MessageType::PropertiesChanged: {
+        noteSequence(message);
+        const QJsonValue changes = message.value(QLatin1String(protocol::keys::kChanges));
+        if (!changes.isArray()) {
+            emit propertiesChanged(message);
+            return;
+        }
+        // The helper batches one event-loop pass worth of changes; consumers
+        // still see one propertiesChanged per object.
+        const QJsonArray changeArray = changes.toArray();
+        for (const QJsonValue &changeValue : changeArray) {
+            QJsonObject change = changeValue.toObject();
+            change[QLatin1String(protocol::keys::kType)] =
+                QLatin1String(protocol::types::kPropertiesChanged);
+            change[QLatin1String(protocol::keys::kTimestampMs)] =
+                message.value(QLatin1String(protocol::keys::kTimestampMs));
+            change[QLatin1String(protocol::keys::kSeq)] =
+                message.value(QLatin1String(protocol::keys::kSeq));
+            emit propertiesChanged(change);
+        }
         return;
     }
-    if (type == QLatin1String(protocol::types::kError)) {
+    case protocol::MessageType::ResyncRequired:
+        m_inSync = false;
+        emit resyncRequired(message);
+        return;
+    case protocol::MessageType::Stats:
+        emit statsReceived(message);
+        return;
+    case protocol::MessageType::Error:
         emit errorReceived(message);
         return;
-    }
-    if (type == QLatin1String(protocol::types::kGoodbye)) {
+    case protocol::MessageType::Goodbye:
         emit goodbyeReceived(message);
         return;
+    default:
+        break;
     }
 
     emit genericMessageReceived(message);
 }
 
+void BridgeClient::noteSequence(const QJsonObject &message)
+{
+    // Seqs never decrease along a connection; the highest one seen is where a
+    // resumed session picks up.
+    const double seq = message.value(QLatin1String(protocol::keys::kSeq)).toDouble(0.0);
+    if (seq > 0.0) {
+        m_lastSeq = qMax(m_lastSeq, static_cast<quint64>(seq));
+    }
+}
+
+void BridgeClient::routeReply(protocol::MessageType type, const QJsonObject &message)
+{
+    const QJsonValue requestId = message.value(QLatin1String(protocol::keys::kRequestId));
+    if (!requestId.isString()) {
+        return;
+    }
+    BridgeReply *reply = m_pendingReplies.value(requestId.toString());
+    if (!reply) {
+        return;
+    }
+
+    switch (type) {
+    case protocol::MessageType::SnapshotBegin:
+    case protocol::MessageType::SnapshotChunk:
+        emit reply->partReceived(message);
+        break;
+    case protocol::MessageType::Error:
+        reply->finish(BridgeReply::Status::Error, message,
+                      message.value(QStringLiteral("message")).toString());
+        break;
+    default:
+        reply->finish(BridgeReply::Status::Finished, message);
+        break;
+    }
+}
+
+void BridgeClient::failPendingReplies(BridgeReply::Status status, const QString &errorString)
+{
+    // Finishing a reply takes it out of the map.
+    const QList<BridgeReply *> replies = m_pendingReplies.values();
+    for (BridgeReply *reply : replies) {
+        reply->finish(status, QJsonObject(), errorString);
+    }
+}
+
+void BridgeClient::applyFieldMask(QJsonObject &message, const FieldMask &mask)
+{
+    if (!mask.fields.isEmpty()) {
+        message[QLatin1String(protocol::keys::kFields)] = QJsonArray::fromStringList(mask.fields);
+    }
+    if (!mask.propertyNames.isEmpty()) {
+        message[QLatin1String(protocol::keys::kPropertyNames)] =
+            QJsonArray::fromStringList(mask.propertyNames);
+    }
+}
+
 } // namespace qt_spy
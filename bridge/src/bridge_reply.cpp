@@ -0,0 +1,79 @@
+#include "qt_spy/bridge_reply.h"
+
+namespace qt_spy {
+
+BridgeReply::BridgeReply(const QString &requestId, protocol::MessageType requestType,
+                         QObject *parent)
+    : QObject(parent)
+    , m_requestId(requestId)
+    , m_requestType(requestType)
+{
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, [this]() {
+        finish(Status::TimedOut, QJsonObject(),
+               QStringLiteral("No reply to '%1' within %2 ms")
+                   .arg(m_requestId)
+                   .arg(m_timeout.interval()));
+    });
+}
+
+QString BridgeReply::requestId() const
+{
+    return m_requestId;
+}
+
+protocol::MessageType BridgeReply::requestType() const
+{
+    return m_requestType;
+}
+
+BridgeReply::Status BridgeReply::status() const
+{
+    return m_status;
+}
+
+bool BridgeReply::isFinished() const
+{
+    return m_status != Status::Pending;
+}
+
+QJsonObject BridgeReply::message() const
+{
+    return m_message;
+}
+
+QString BridgeReply::errorString() const
+{
+    return m_errorString;
+}
+
+void BridgeReply::setTimeout(int msecs)
+{
+    if (isFinished()) {
+        return;
+    }
+    if (msecs > 0) {
+        m_timeout.start(msecs);
+    } else {
+        m_timeout.stop();
+    }
+}
+
+void BridgeReply::cancel()
+{
+    finish(Status::Canceled, QJsonObject(), QStringLiteral("Request canceled"));
+}
+
+void BridgeReply::finish(Status status, const QJsonObject &message, const QString &errorString)
+{
+    if (isFinished()) {
+        return;
+    }
+    m_timeout.stop();
+    m_status = status;
+    m_message = message;
+    m_errorString = errorString;
+    emit finished();
+}
+
+} // namespace qt_spy
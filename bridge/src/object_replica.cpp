@@ -0,0 +1,607 @@
+#include "qt_spy/object_replica.h"
+
+#include "qt_spy/bridge_client.h"
+
+#include <QJsonValue>
+#include <QMetaType>
+
+#include <algorithm>
+#include <utility>
+
+namespace qt_spy {
+
+namespace {
+
+const QLatin1String kClassNameKey("className");
+const QLatin1String kObjectNameKey("objectName");
+const QLatin1String kDynamicPropertiesKey("__dynamic");
+
+NodeId nodeIdOf(const QJsonObject &json, const char *key)
+{
+    return protocol::nodeIdFromJson(json.value(QLatin1String(key)));
+}
+
+bool isSubtreeSnapshot(const QJsonObject &message)
+{
+    return nodeIdOf(message, protocol::keys::kRootId) != protocol::kInvalidNodeId;
+}
+
+QVector<NodeId> idsOf(const QJsonArray &values)
+{
+    QVector<NodeId> ids;
+    ids.reserve(values.size());
+    for (const QJsonValue &value : values) {
+        const NodeId id = protocol::nodeIdFromJson(value);
+        if (id != protocol::kInvalidNodeId) {
+            ids.append(id);
+        }
+    }
+    return ids;
+}
+
+} // namespace
+
+ObjectReplica::ObjectReplica(QObject *parent)
+    : QObject(parent)
+{
+    // The notifications carry ids under their typedef name; registering it
+    // lets them cross threads and be recorded by QSignalSpy.
+    qRegisterMetaType<NodeId>("qt_spy::NodeId");
+}
+
+void ObjectReplica::attach(BridgeClient *client)
+{
+    if (m_client) {
+        disconnect(m_client, nullptr, this, nullptr);
+    }
+    m_client = client;
+    if (!client) {
+        return;
+    }
+
+    connect(client, &BridgeClient::snapshotReceived, this, &ObjectReplica::applySnapshot);
+    connect(client, &BridgeClient::snapshotBegun, this, &ObjectReplica::applySnapshotBegin);
+    connect(client, &BridgeClient::snapshotChunkReceived, this,
+            &ObjectReplica::applySnapshotChunk);
+    connect(client, &BridgeClient::snapshotFinished, this, &ObjectReplica::applySnapshotEnd);
+    connect(client, &BridgeClient::nodeAdded, this, &ObjectReplica::applyNodeAdded);
+    connect(client, &BridgeClient::nodeRemoved, this, &ObjectReplica::applyNodeRemoved);
+    connect(client, &BridgeClient::propertiesChanged, this,
+            &ObjectReplica::applyPropertiesChanged);
+    connect(client, &BridgeClient::propertiesReceived, this,
+            &ObjectReplica::applyPropertiesChanged);
+}
+
+void ObjectReplica::applySnapshot(const QJsonObject &snapshot)
+{
+    const QJsonArray nodes = snapshot.value(QLatin1String(protocol::keys::kNodes)).toArray();
+    if (isSubtreeSnapshot(snapshot)) {
+        applyNodes(nodes, true);
+        return;
+    }
+
+    clearStore();
+    m_rootIds = idsOf(snapshot.value(QLatin1String(protocol::keys::kRootIds)).toArray());
+    applyNodes(nodes, false);
+    emit reset();
+    emit snapshotApplied();
+}
+
+void ObjectReplica::applySnapshotBegin(const QJsonObject &begin)
+{
+    if (isSubtreeSnapshot(begin)) {
+        m_streaming = true;
+        m_streamingSubtree = true;
+        return;
+    }
+
+    clearStore();
+    m_streaming = true;
+    m_rootIds = idsOf(begin.value(QLatin1String(protocol::keys::kRootIds)).toArray());
+    emit reset();
+}
+
+void ObjectReplica::applySnapshotChunk(const QJsonObject &chunk)
+{
+    applyNodes(chunk.value(QLatin1String(protocol::keys::kNodes)).toArray(), true);
+}
+
+void ObjectReplica::applySnapshotEnd(const QJsonObject &end)
+{
+    Q_UNUSED(end)
+    const bool full = m_streaming && !m_streamingSubtree;
+    m_streaming = false;
+    m_streamingSubtree = false;
+    if (full) {
+        emit snapshotApplied();
+    }
+}
+
+void ObjectReplica::applyNodeAdded(const QJsonObject &message)
+{
+    QJsonObject json = message.value(QLatin1String(protocol::keys::kNode)).toObject();
+    if (!json.contains(QLatin1String(protocol::keys::kParentId))
+        && message.contains(QLatin1String(protocol::keys::kParentId))) {
+        json.insert(QLatin1String(protocol::keys::kParentId),
+                    message.value(QLatin1String(protocol::keys::kParentId)));
+    }
+
+    bool added = false;
+    const int slot = storeNode(json, &added);
+    if (slot == kNoSlot) {
+        return;
+    }
+    const NodeId id = m_ids.at(slot);
+    const NodeId parentId = m_parents.at(slot);
+    if (!added) {
+        emit nodeUpdated(id);
+        return;
+    }
+
+    if (parentId == protocol::kInvalidNodeId) {
+        if (!m_rootIds.contains(id)) {
+            m_rootIds.append(id);
+        }
+    } else {
+        const int parentSlot = slotOf(parentId);
+        if (parentSlot != kNoSlot) {
+            QVector<NodeId> &siblings = m_children[parentSlot];
+            if (siblings.isEmpty() && m_childCounts.at(parentSlot) > 0) {
+                ++m_childCounts[parentSlot]; // children not loaded yet
+            } else if (!siblings.contains(id)) {
+                siblings.append(id);
+            }
+        }
+    }
+    emit nodeAdded(id, parentId);
+}
+
+void ObjectReplica::applyNodeRemoved(const QJsonObject &message)
+{
+    const NodeId id = nodeIdOf(message, protocol::keys::kId);
+    const int slot = slotOf(id);
+    if (slot == kNoSlot) {
+        // Never sent to us, most likely below a depth limit.
+        const int parentSlot = slotOf(nodeIdOf(message, protocol::keys::kParentId));
+        if (parentSlot != kNoSlot && m_children.at(parentSlot).isEmpty()
+            && m_childCounts.at(parentSlot) > 0) {
+            --m_childCounts[parentSlot];
+        }
+        return;
+    }
+
+    const NodeId parentId = m_parents.at(slot);
+    removeSubtree(slot);
+    detachFromParent(id, parentId);
+    emit nodeRemoved(id, parentId);
+}
+
+void ObjectReplica::applyPropertiesChanged(const QJsonObject &message)
+{
+    const QJsonValue changes = message.value(QLatin1String(protocol::keys::kChanges));
+    if (!changes.isArray()) {
+        applyPropertyChange(message);
+        return;
+    }
+    const QJsonArray changeArray = changes.toArray();
+    for (const QJsonValue &change : changeArray) {
+        applyPropertyChange(change.toObject());
+    }
+}
+
+void ObjectReplica::clear()
+{
+    clearStore();
+    emit reset();
+}
+
+int ObjectReplica::size() const
+{
+    return m_slotById.size();
+}
+
+bool ObjectReplica::contains(NodeId id) const
+{
+    return m_slotById.contains(id);
+}
+
+QVector<NodeId> ObjectReplica::rootIds() const
+{
+    return m_rootIds;
+}
+
+ReplicaNode ObjectReplica::node(NodeId id) const
+{
+    ReplicaNode node;
+    const int slot = slotOf(id);
+    if (slot == kNoSlot) {
+        return node;
+    }
+    node.id = id;
+    node.parentId = m_parents.at(slot);
+    node.className = m_classNames.at(m_classes.at(slot));
+    node.objectName = m_objectNames.at(slot);
+    node.childIds = m_children.at(slot);
+    node.childCount = m_childCounts.at(slot);
+    node.properties = m_properties.at(slot);
+    node.details = m_details.at(slot);
+    return node;
+}
+
+NodeId ObjectReplica::parentId(NodeId id) const
+{
+    const int slot = slotOf(id);
+    return slot == kNoSlot ? protocol::kInvalidNodeId : m_parents.at(slot);
+}
+
+QVector<NodeId> ObjectReplica::childIds(NodeId id) const
+{
+    const int slot = slotOf(id);
+    return slot == kNoSlot ? QVector<NodeId>() : m_children.at(slot);
+}
+
+int ObjectReplica::childCount(NodeId id) const
+{
+    const int slot = slotOf(id);
+    if (slot == kNoSlot) {
+        return 0;
+    }
+    return m_children.at(slot).isEmpty() ? m_childCounts.at(slot) : m_children.at(slot).size();
+}
+
+QString ObjectReplica::className(NodeId id) const
+{
+    const int slot = slotOf(id);
+    return slot == kNoSlot ? QString() : m_classNames.at(m_classes.at(slot));
+}
+
+QString ObjectReplica::objectName(NodeId id) const
+{
+    const int slot = slotOf(id);
+    return slot == kNoSlot ? QString() : m_objectNames.at(slot);
+}
+
+QJsonObject ObjectReplica::properties(NodeId id) const
+{
+    const int slot = slotOf(id);
+    return slot == kNoSlot ? QJsonObject() : m_properties.at(slot);
+}
+
+QVector<NodeId> ObjectReplica::findByClass(const QString &className) const
+{
+    QVector<NodeId> ids;
+    const auto found = m_classIndex.constFind(className);
+    if (found == m_classIndex.constEnd()) {
+        return ids;
+    }
+    const QVector<int> &bucket = m_slotsByClass.at(found.value());
+    ids.reserve(bucket.size());
+    for (int slot : bucket) {
+        ids.append(m_ids.at(slot));
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+QVector<NodeId> ObjectReplica::findByObjectName(const QString &objectName) const
+{
+    QVector<NodeId> ids;
+    const auto found = m_slotsByName.constFind(objectName);
+    if (found == m_slotsByName.constEnd()) {
+        return ids;
+    }
+    ids.reserve(found->size());
+    for (int slot : found.value()) {
+        ids.append(m_ids.at(slot));
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+bool ObjectReplica::isComplete() const
+{
+    return !m_streaming || m_streamingSubtree;
+}
+
+void ObjectReplica::clearStore()
+{
+    m_ids.clear();
+    m_parents.clear();
+    m_classes.clear();
+    m_objectNames.clear();
+    m_children.clear();
+    m_childCounts.clear();
+    m_properties.clear();
+    m_details.clear();
+    m_classPositions.clear();
+    m_namePositions.clear();
+    m_freeSlots.clear();
+    m_slotById.clear();
+    m_slotsByName.clear();
+    m_rootIds.clear();
+    // Interned class names outlive the nodes; the next snapshot of the same
+    // process uses the same classes.
+    for (QVector<int> &bucket : m_slotsByClass) {
+        bucket.clear();
+    }
+    m_streaming = false;
+    m_streamingSubtree = false;
+}
+
+int ObjectReplica::slotOf(NodeId id) const
+{
+    return m_slotById.value(id, kNoSlot);
+}
+
+int ObjectReplica::allocateSlot(NodeId id)
+{
+    int slot = kNoSlot;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+        m_ids[slot] = id;
+    } else {
+        slot = m_ids.size();
+        m_ids.append(id);
+        m_parents.append(protocol::kInvalidNodeId);
+        m_classes.append(0);
+        m_objectNames.append(QString());
+        m_children.append(QVector<NodeId>());
+        m_childCounts.append(0);
+        m_properties.append(QJsonObject());
+        m_details.append(QJsonObject());
+        m_classPositions.append(kNoSlot);
+        m_namePositions.append(kNoSlot);
+    }
+    m_slotById.insert(id, slot);
+    return slot;
+}
+
+void ObjectReplica::releaseSlot(int slot)
+{
+    unindexClass(slot);
+    unindexName(slot);
+    m_slotById.remove(m_ids.at(slot));
+    m_ids[slot] = protocol::kInvalidNodeId;
+    m_parents[slot] = protocol::kInvalidNodeId;
+    m_objectNames[slot].clear();
+    m_children[slot].clear();
+    m_childCounts[slot] = 0;
+    m_properties[slot] = QJsonObject();
+    m_details[slot] = QJsonObject();
+    m_freeSlots.append(slot);
+}
+
+int ObjectReplica::internClass(const QString &className)
+{
+    const auto found = m_classIndex.constFind(className);
+    if (found != m_classIndex.constEnd()) {
+        return found.value();
+    }
+    const int index = m_classNames.size();
+    m_classNames.append(className);
+    m_slotsByClass.append(QVector<int>());
+    m_classIndex.insert(className, index);
+    return index;
+}
+
+void ObjectReplica::indexClass(int slot, int classIndex)
+{
+    QVector<int> &bucket = m_slotsByClass[classIndex];
+    m_classes[slot] = classIndex;
+    m_classPositions[slot] = bucket.size();
+    bucket.append(slot);
+}
+
+void ObjectReplica::unindexClass(int slot)
+{
+    QVector<int> &bucket = m_slotsByClass[m_classes.at(slot)];
+    const int position = m_classPositions.at(slot);
+    const int moved = bucket.last();
+    bucket[position] = moved;
+    m_classPositions[moved] = position;
+    bucket.removeLast();
+    m_classPositions[slot] = kNoSlot;
+}
+
+void ObjectReplica::indexName(int slot)
+{
+    const QString &name = m_objectNames.at(slot);
+    if (name.isEmpty()) {
+        m_namePositions[slot] = kNoSlot;
+        return;
+    }
+    QVector<int> &bucket = m_slotsByName[name];
+    m_namePositions[slot] = bucket.size();
+    bucket.append(slot);
+}
+
+void ObjectReplica::unindexName(int slot)
+{
+    const int position = m_namePositions.at(slot);
+    if (position == kNoSlot) {
+        return;
+    }
+    const auto found = m_slotsByName.find(m_objectNames.at(slot));
+    QVector<int> &bucket = found.value();
+    const int moved = bucket.last();
+    bucket[position] = moved;
+    m_namePositions[moved] = position;
+    bucket.removeLast();
+    if (bucket.isEmpty()) {
+        m_slotsByName.erase(found);
+    }
+    m_namePositions[slot] = kNoSlot;
+}
+
+void ObjectReplica::applyNodes(const QJsonArray &nodes, bool notify)
+{
+    for (const QJsonValue &value : nodes) {
+        bool added = false;
+        const int slot = storeNode(value.toObject(), &added);
+        if (!notify || slot == kNoSlot) {
+            continue;
+        }
+        if (added) {
+            emit nodeAdded(m_ids.at(slot), m_parents.at(slot));
+        } else {
+            emit nodeUpdated(m_ids.at(slot));
+        }
+    }
+}
+
+void ObjectReplica::applyPropertyChange(const QJsonObject &change)
+{
+    const NodeId id = nodeIdOf(change, protocol::keys::kId);
+    const int slot = slotOf(id);
+    if (slot == kNoSlot) {
+        return;
+    }
+    QStringList names =
+        mergeProperties(slot, change.value(QLatin1String(protocol::keys::kProperties)).toObject());
+    const QJsonValue changed = change.value(QLatin1String(protocol::keys::kChanged));
+    if (changed.isArray()) {
+        names.clear();
+        const QJsonArray changedNames = changed.toArray();
+        for (const QJsonValue &name : changedNames) {
+            names.append(name.toString());
+        }
+    }
+    if (!names.isEmpty()) {
+        emit propertiesChanged(id, names);
+    }
+}
+
+int ObjectReplica::storeNode(const QJsonObject &json, bool *added)
+{
+    *added = false;
+    const NodeId id = nodeIdOf(json, protocol::keys::kId);
+    if (id == protocol::kInvalidNodeId) {
+        return kNoSlot;
+    }
+
+    const QJsonValue childIdsValue = json.value(QLatin1String(protocol::keys::kChildIds));
+    const bool truncated = childIdsValue.isUndefined()
+                           && json.value(QLatin1String(protocol::keys::kChildCount)).toInt() > 0;
+    const QString className = json.value(kClassNameKey).toString();
+    const QString objectName = json.value(kObjectNameKey).toString();
+
+    QJsonObject details = json;
+    details.remove(QLatin1String(protocol::keys::kId));
+    details.remove(QLatin1String(protocol::keys::kParentId));
+    details.remove(kClassNameKey);
+    details.remove(kObjectNameKey);
+    details.remove(QLatin1String(protocol::keys::kChildIds));
+    details.remove(QLatin1String(protocol::keys::kChildCount));
+    details.remove(QLatin1String(protocol::keys::kProperties));
+
+    int slot = slotOf(id);
+    if (slot == kNoSlot) {
+        *added = true;
+        slot = allocateSlot(id);
+        indexClass(slot, internClass(className));
+        m_objectNames[slot] = objectName;
+        indexName(slot);
+    } else {
+        if (m_classNames.at(m_classes.at(slot)) != className) {
+            unindexClass(slot);
+            indexClass(slot, internClass(className));
+        }
+        if (m_objectNames.at(slot) != objectName) {
+            unindexName(slot);
+            m_objectNames[slot] = objectName;
+            indexName(slot);
+        }
+    }
+
+    m_parents[slot] = nodeIdOf(json, protocol::keys::kParentId);
+    if (!truncated) {
+        const QVector<NodeId> previous = m_children.at(slot);
+        m_children[slot] = idsOf(childIdsValue.toArray());
+        m_childCounts[slot] = 0;
+        // Children the node no longer lists are gone, unless they have been
+        // reparented in the meantime.
+        for (const NodeId childId : previous) {
+            if (m_children.at(slot).contains(childId)) {
+                continue;
+            }
+            const int childSlot = slotOf(childId);
+            if (childSlot != kNoSlot && m_parents.at(childSlot) == id) {
+                removeSubtree(childSlot);
+                emit nodeRemoved(childId, id);
+            }
+        }
+    } else if (m_children.at(slot).isEmpty()) {
+        // A depth-limited resend does not forget children already loaded.
+        m_childCounts[slot] = json.value(QLatin1String(protocol::keys::kChildCount)).toInt();
+    }
+
+    if (*added || json.contains(QLatin1String(protocol::keys::kProperties))) {
+        m_properties[slot] = json.value(QLatin1String(protocol::keys::kProperties)).toObject();
+    }
+    if (*added || !details.isEmpty()) {
+        m_details[slot] = details;
+    }
+    return slot;
+}
+
+void ObjectReplica::removeSubtree(int slot)
+{
+    QVector<int> pending{slot};
+    while (!pending.isEmpty()) {
+        const int current = pending.takeLast();
+        const NodeId currentId = m_ids.at(current);
+        for (const NodeId childId : std::as_const(m_children.at(current))) {
+            const int child = slotOf(childId);
+            if (child != kNoSlot && m_parents.at(child) == currentId) {
+                pending.append(child);
+            }
+        }
+        releaseSlot(current);
+    }
+}
+
+void ObjectReplica::detachFromParent(NodeId id, NodeId parentId)
+{
+    if (parentId == protocol::kInvalidNodeId) {
+        m_rootIds.removeOne(id);
+        return;
+    }
+    const int parentSlot = slotOf(parentId);
+    if (parentSlot != kNoSlot) {
+        m_children[parentSlot].removeOne(id);
+    }
+}
+
+QStringList ObjectReplica::mergeProperties(int slot, const QJsonObject &properties)
+{
+    QStringList names;
+    QJsonObject &merged = m_properties[slot];
+    for (auto it = properties.begin(); it != properties.end(); ++it) {
+        names.append(it.key());
+        if (it.key() != kDynamicPropertiesKey) {
+            merged.insert(it.key(), it.value());
+            continue;
+        }
+        // Only changed dynamic properties are sent; null marks a removed one.
+        QJsonObject dynamicProperties = merged.value(it.key()).toObject();
+        const QJsonObject changedDynamic = it.value().toObject();
+        for (auto dynamic = changedDynamic.begin(); dynamic != changedDynamic.end(); ++dynamic) {
+            if (dynamic.value().isNull()) {
+                dynamicProperties.remove(dynamic.key());
+            } else {
+                dynamicProperties.insert(dynamic.key(), dynamic.value());
+            }
+        }
+        merged.insert(it.key(), dynamicProperties);
+    }
+
+    const QJsonValue objectName = properties.value(kObjectNameKey);
+    if (objectName.isString() && objectName.toString() != m_objectNames.at(slot)) {
+        unindexName(slot);
+        m_objectNames[slot] = objectName.toString();
+        indexName(slot);
+    }
+    return names;
+}
+
+} // namespace qt_spy
@@ -1,6 +1,8 @@
 #include "qt_spy/bridge_client.h"
+#include "qt_spy/object_replica.h"
 #include "qt_spy/probe.h"
 #include "qt_spy/protocol.h"
+#include "qt_spy/wire_format.h"
 
 #include <QCommandLineOption>
 #include <QCommandLineParser>
@@ -34,6 +36,7 @@
 namespace {
 
 namespace protocol = qt_spy::protocol;
+using qt_spy::NodeId;
 
 struct QtProcessInfo {
     qint64 pid = 0;
@@ -458,14 +461,17 @@ ResolvedServerName resolveServerNameEnhanced(const QCommandLineParser &parser,
 }
 
 struct ActionTarget {
-    enum class Kind { None, Id, FirstRoot };
+    enum class Kind { None, Id, FirstRoot, ObjectName, ClassName };
 
     Kind kind = Kind::None;
-    QString value;   // used when kind == Id
+    NodeId value = protocol::kInvalidNodeId; // used when kind == Id
+    QString query;                           // used when kind == ObjectName or ClassName
     bool sticky = false;
     bool completed = false;
 
     bool pending() const { return kind != Kind::None && !completed; }
+    // Looked up in the replica once a snapshot has arrived.
+    bool isQuery() const { return kind == Kind::ObjectName || kind == Kind::ClassName; }
 
     void markCompleted()
     {
@@ -474,7 +480,8 @@ struct ActionTarget {
             return;
         }
         kind = Kind::None;
-        value.clear();
+        value = protocol::kInvalidNodeId;
+        query.clear();
         completed = false;
     }
 
@@ -488,7 +495,8 @@ struct ActionTarget {
     void clear()
     {
         kind = Kind::None;
-        value.clear();
+        value = protocol::kInvalidNodeId;
+        query.clear();
         sticky = false;
         completed = false;
     }
@@ -499,9 +507,17 @@ struct ClientOptions {
     int maxRetries = -1; // -1 == infinite
     ActionTarget selectTarget;
     ActionTarget propertiesTarget;
+    ActionTarget subscribeTarget;
     bool snapshotOnce = false;
+    bool statsOnly = false; // print the helper's stats instead of a snapshot, then exit
     qint64 targetPid = -1;
     bool enableInjection = true;
+    protocol::Encoding encoding = protocol::Encoding::Cbor;
+    int snapshotChunkSize = 0; // > 0 requests a chunked snapshot
+    qt_spy::FieldMask fieldMask;
+    NodeId subtreeRoot = protocol::kInvalidNodeId; // snapshot only this node's subtree
+    int snapshotDepth = -1;                        // >= 0 limits the levels below the root
+    double maxRateHz = -1.0;                       // --subscribe update cap; < 0 = probe default
 };
 
 class Client : public QObject {
@@ -527,14 +543,20 @@ private slots:
 private:
     void sendAttach();
     void sendSnapshotRequest();
-    void requestProperties(const QString &id);
-    void sendSelect(const QString &id);
+    void requestProperties(NodeId id);
+    void sendSelect(NodeId id);
+    void sendSubscribe(NodeId id);
     void handleHello(const QJsonObject &message);
+    void handleStats(const QJsonObject &message);
     void handleSnapshot(const QJsonObject &message);
+    void handleSnapshotBegin(const QJsonObject &message);
+    void handleSnapshotChunk(const QJsonObject &message);
+    void handleSnapshotEnd(const QJsonObject &message);
     void handlePropertiesMessage(const QJsonObject &message);
     void handleSelectionAck(const QJsonObject &message);
     void handleGenericMessage(const QJsonObject &message);
     void handleErrorMessage(const QJsonObject &message);
+    void handleResyncRequired(const QJsonObject &message);
     void handleGoodbye(const QJsonObject &message);
     void scheduleReconnect();
     void resetConnectionState();
@@ -543,6 +565,8 @@ private:
     bool attemptInjection();
     QString nextRequestId();
     void resolveDeferredTargets(const QJsonArray &rootIds);
+    void resolveQueryTargets();
+    NodeId findQueryTarget(const ActionTarget &target, const char *action);
     void completeTarget(ActionTarget &target);
     void exitWithCode(int code);
     void beginDetachHandshake();
@@ -551,6 +575,7 @@ private:
 
     ClientOptions m_options;
     qt_spy::BridgeClient m_bridge;
+    qt_spy::ObjectReplica m_replica;
     QTextStream m_stdout;
     QTextStream m_stderr;
     QTimer m_retryTimer;
@@ -573,12 +598,22 @@ Client::Client(ClientOptions options, QObject *parent)
     : QObject(parent)
     , m_options(std::move(options))
     , m_bridge(this)
+    , m_replica(this)
     , m_stdout(stdout)
     , m_stderr(stderr)
 {
     m_retryTimer.setSingleShot(true);
     m_detachTimer.setSingleShot(true);
 
+    // Output is always printed as JSON; the wire encoding only affects transfer.
+    m_bridge.setPreferredEncoding(m_options.encoding);
+    // A reconnect after a brief drop replays the missed events instead of
+    // printing the whole tree again.
+    m_bridge.setResumeEnabled(true);
+
+    // Attached first, so the handlers below see the replica already updated.
+    m_replica.attach(&m_bridge);
+
     connect(&m_bridge, &qt_spy::BridgeClient::socketConnected, this, &Client::onConnected);
     connect(&m_bridge, &qt_spy::BridgeClient::socketDisconnected, this, &Client::onDisconnected);
     connect(&m_bridge,
@@ -587,6 +622,12 @@ Client::Client(ClientOptions options, QObject *parent)
             &Client::onSocketError);
     connect(&m_bridge, &qt_spy::BridgeClient::helloReceived, this, &Client::handleHello);
     connect(&m_bridge, &qt_spy::BridgeClient::snapshotReceived, this, &Client::handleSnapshot);
+    connect(&m_bridge, &qt_spy::BridgeClient::snapshotBegun, this, &Client::handleSnapshotBegin);
+    connect(&m_bridge,
+            &qt_spy::BridgeClient::snapshotChunkReceived,
+            this,
+            &Client::handleSnapshotChunk);
+    connect(&m_bridge, &qt_spy::BridgeClient::snapshotFinished, this, &Client::handleSnapshotEnd);
     connect(&m_bridge,
             &qt_spy::BridgeClient::propertiesReceived,
             this,
@@ -595,13 +636,22 @@ Client::Client(ClientOptions options, QObject *parent)
             &qt_spy::BridgeClient::selectionAckReceived,
             this,
             &Client::handleSelectionAck);
+    connect(&m_bridge,
+            &qt_spy::BridgeClient::subscriptionAckReceived,
+            this,
+            &Client::handleGenericMessage);
     connect(&m_bridge, &qt_spy::BridgeClient::nodeAdded, this, &Client::handleGenericMessage);
     connect(&m_bridge, &qt_spy::BridgeClient::nodeRemoved, this, &Client::handleGenericMessage);
     connect(&m_bridge,
             &qt_spy::BridgeClient::propertiesChanged,
             this,
             &Client::handleGenericMessage);
+    connect(&m_bridge, &qt_spy::BridgeClient::statsReceived, this, &Client::handleStats);
     connect(&m_bridge, &qt_spy::BridgeClient::errorReceived, this, &Client::handleErrorMessage);
+    connect(&m_bridge,
+            &qt_spy::BridgeClient::resyncRequired,
+            this,
+            &Client::handleResyncRequired);
     connect(&m_bridge,
             &qt_spy::BridgeClient::genericMessageReceived,
             this,
@@ -738,27 +788,43 @@ void Client::sendAttach()
 
 void Client::sendSnapshotRequest()
 {
-    m_bridge.requestSnapshot(nextRequestId());
+    qt_spy::SnapshotOptions snapshotOptions;
+    snapshotOptions.chunked = m_options.snapshotChunkSize > 0;
+    snapshotOptions.chunkSize = m_options.snapshotChunkSize;
+    snapshotOptions.mask = m_options.fieldMask;
+    snapshotOptions.rootId = m_options.subtreeRoot;
+    snapshotOptions.maxDepth = m_options.snapshotDepth;
+    m_bridge.requestSnapshot(nextRequestId(), snapshotOptions);
 }
 
-void Client::requestProperties(const QString &id)
+void Client::requestProperties(NodeId id)
 {
-    if (id.isEmpty()) {
+    if (id == protocol::kInvalidNodeId) {
         return;
     }
 
-    m_bridge.requestProperties(id, nextRequestId());
+    m_bridge.requestProperties(id, nextRequestId(), m_options.fieldMask);
 }
 
-void Client::sendSelect(const QString &id)
+void Client::sendSelect(NodeId id)
 {
-    if (id.isEmpty()) {
+    if (id == protocol::kInvalidNodeId) {
         return;
     }
 
     m_bridge.selectNode(id, nextRequestId());
 }
 
+void Client::sendSubscribe(NodeId id)
+{
+    if (id == protocol::kInvalidNodeId) {
+        return;
+    }
+
+    const QStringList names(m_options.fieldMask.propertyNames);
+    m_bridge.subscribe({id}, names, nextRequestId(), m_options.maxRateHz);
+}
+
 void Client::handleHello(const QJsonObject &message)
 {
     m_attached = true;
@@ -766,9 +832,22 @@ void Client::handleHello(const QJsonObject &message)
     m_stderr << "qt-spy cli: handshake complete. app='"
              << message.value(QLatin1String(protocol::keys::kApplicationName)).toString()
              << "' pid=" << message.value(QLatin1String(protocol::keys::kApplicationPid)).toInt()
-             << Qt::endl;
+             << " encoding=" << protocol::encodingName(m_bridge.encoding())
+             << (m_bridge.resumed() ? " (resumed)" : "") << Qt::endl;
 
-    sendSnapshotRequest();
+    if (m_options.statsOnly) {
+        // A snapshot would show up in the numbers being asked for.
+        m_bridge.requestStats(nextRequestId());
+        return;
+    }
+
+    // A resumed session replays what was missed onto the replica; anything
+    // else may be a restarted process and needs a new snapshot.
+    const bool resumed = m_bridge.resumed();
+    if (!resumed) {
+        m_replica.clear();
+        sendSnapshotRequest();
+    }
 
     if (m_options.selectTarget.pending() && m_options.selectTarget.kind == ActionTarget::Kind::Id) {
         sendSelect(m_options.selectTarget.value);
@@ -780,6 +859,21 @@ void Client::handleHello(const QJsonObject &message)
         requestProperties(m_options.propertiesTarget.value);
         completeTarget(m_options.propertiesTarget);
     }
+
+    if (m_options.subscribeTarget.pending() &&
+        m_options.subscribeTarget.kind == ActionTarget::Kind::Id) {
+        sendSubscribe(m_options.subscribeTarget.value);
+        completeTarget(m_options.subscribeTarget);
+    }
+
+    if (resumed) {
+        QJsonArray rootIds;
+        for (const NodeId rootId : m_replica.rootIds()) {
+            rootIds.append(protocol::nodeIdToJson(rootId));
+        }
+        resolveDeferredTargets(rootIds);
+        resolveQueryTargets();
+    }
 }
 
 void Client::handleSnapshot(const QJsonObject &message)
@@ -789,6 +883,53 @@ void Client::handleSnapshot(const QJsonObject &message)
 
     const QJsonArray rootIds = message.value(QLatin1String(protocol::keys::kRootIds)).toArray();
     resolveDeferredTargets(rootIds);
+    resolveQueryTargets();
+
+    if (m_options.snapshotOnce) {
+        exitWithCode(EXIT_SUCCESS);
+    }
+}
+
+void Client::handleStats(const QJsonObject &message)
+{
+    m_stdout << "--- stats ---" << Qt::endl;
+    m_stdout << QJsonDocument(message.value(QLatin1String(protocol::keys::kStats)).toObject())
+                    .toJson(QJsonDocument::Indented)
+             << Qt::endl;
+
+    if (m_options.statsOnly) {
+        exitWithCode(EXIT_SUCCESS);
+    }
+}
+
+void Client::handleSnapshotBegin(const QJsonObject &message)
+{
+    m_stdout << "--- snapshot begin ---" << Qt::endl;
+    m_stdout << QJsonDocument(message).toJson(QJsonDocument::Indented) << Qt::endl;
+
+    // Root ids arrive up front, so deferred targets do not wait for the last chunk.
+    const QJsonArray rootIds = message.value(QLatin1String(protocol::keys::kRootIds)).toArray();
+    resolveDeferredTargets(rootIds);
+}
+
+void Client::handleSnapshotChunk(const QJsonObject &message)
+{
+    m_stdout << "--- snapshot chunk "
+             << message.value(QLatin1String(protocol::keys::kChunkIndex)).toInt() << " ---"
+             << Qt::endl;
+    m_stdout << QJsonDocument(message.value(QLatin1String(protocol::keys::kNodes)).toArray())
+                    .toJson(QJsonDocument::Indented)
+             << Qt::endl;
+}
+
+void Client::handleSnapshotEnd(const QJsonObject &message)
+{
+    m_stdout << "--- snapshot end (nodes="
+             << message.value(QLatin1String(protocol::keys::kNodeCount)).toInt() << ", chunks="
+             << message.value(QLatin1String(protocol::keys::kChunkCount)).toInt() << ") ---"
+             << Qt::endl;
+
+    resolveQueryTargets();
 
     if (m_options.snapshotOnce) {
         exitWithCode(EXIT_SUCCESS);
@@ -797,12 +938,12 @@ void Client::handleSnapshot(const QJsonObject &message)
 
 void Client::handlePropertiesMessage(const QJsonObject &message)
 {
-    const QString id = message.value(QLatin1String(protocol::keys::kId)).toString();
+    const NodeId id = protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId)));
     const QJsonObject props = message.value(QLatin1String(protocol::keys::kProperties)).toObject();
     const QString requestId = message.value(QLatin1String(protocol::keys::kRequestId)).toString();
 
     m_stdout << "--- properties";
-    if (!id.isEmpty()) {
+    if (id != protocol::kInvalidNodeId) {
         m_stdout << " (id=" << id << ")";
     }
     if (!requestId.isEmpty()) {
@@ -814,11 +955,11 @@ void Client::handlePropertiesMessage(const QJsonObject &message)
 
 void Client::handleSelectionAck(const QJsonObject &message)
 {
-    const QString id = message.value(QLatin1String(protocol::keys::kId)).toString();
+    const NodeId id = protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId)));
     const QString requestId = message.value(QLatin1String(protocol::keys::kRequestId)).toString();
 
     m_stderr << "qt-spy cli: selection acknowledged for id='"
-             << (id.isEmpty() ? QStringLiteral("<unknown>") : id) << "'";
+             << (id == protocol::kInvalidNodeId ? QStringLiteral("<unknown>") : QString::number(id)) << "'";
     if (!requestId.isEmpty()) {
         m_stderr << " (requestId=" << requestId << ")";
     }
@@ -844,6 +985,16 @@ void Client::handleErrorMessage(const QJsonObject &message)
     }
 }
 
+void Client::handleResyncRequired(const QJsonObject &message)
+{
+    m_stderr << "qt-spy cli: helper dropped "
+             << message.value(QLatin1String(protocol::keys::kDropped)).toInt()
+             << " update(s); requesting a fresh snapshot." << Qt::endl;
+    if (!m_exiting && !m_detachRequested) {
+        sendSnapshotRequest();
+    }
+}
+
 void Client::handleGoodbye(const QJsonObject &message)
 {
     if (!m_exiting || !m_detachRequested) {
@@ -890,6 +1041,7 @@ void Client::resetConnectionState()
     m_attached = false;
     m_options.selectTarget.resetForReconnect();
     m_options.propertiesTarget.resetForReconnect();
+    m_options.subscribeTarget.resetForReconnect();
     if (!m_exiting) {
         m_detachTimer.stop();
         m_detachRequested = false;
@@ -1003,17 +1155,17 @@ QString Client::nextRequestId()
 
 void Client::resolveDeferredTargets(const QJsonArray &rootIds)
 {
-    auto resolveRoot = [&rootIds]() -> QString {
+    auto resolveRoot = [&rootIds]() -> NodeId {
         if (rootIds.isEmpty()) {
-            return {};
+            return protocol::kInvalidNodeId;
         }
-        return rootIds.first().toString();
+        return protocol::nodeIdFromJson(rootIds.first());
     };
 
     if (m_options.selectTarget.pending() &&
         m_options.selectTarget.kind == ActionTarget::Kind::FirstRoot) {
-        const QString id = resolveRoot();
-        if (id.isEmpty()) {
+        const NodeId id = resolveRoot();
+        if (id == protocol::kInvalidNodeId) {
             m_stderr << "qt-spy cli: no root nodes available for selection." << Qt::endl;
         } else {
             sendSelect(id);
@@ -1023,14 +1175,72 @@ void Client::resolveDeferredTargets(const QJsonArray &rootIds)
 
     if (m_options.propertiesTarget.pending() &&
         m_options.propertiesTarget.kind == ActionTarget::Kind::FirstRoot) {
-        const QString id = resolveRoot();
-        if (id.isEmpty()) {
+        const NodeId id = resolveRoot();
+        if (id == protocol::kInvalidNodeId) {
             m_stderr << "qt-spy cli: no root nodes available for property request." << Qt::endl;
         } else {
             requestProperties(id);
             completeTarget(m_options.propertiesTarget);
         }
     }
+
+    if (m_options.subscribeTarget.pending() &&
+        m_options.subscribeTarget.kind == ActionTarget::Kind::FirstRoot) {
+        const NodeId id = resolveRoot();
+        if (id == protocol::kInvalidNodeId) {
+            m_stderr << "qt-spy cli: no root nodes available for subscription." << Qt::endl;
+        } else {
+            sendSubscribe(id);
+            completeTarget(m_options.subscribeTarget);
+        }
+    }
+}
+
+void Client::resolveQueryTargets()
+{
+    if (m_options.selectTarget.pending() && m_options.selectTarget.isQuery()) {
+        const NodeId id = findQueryTarget(m_options.selectTarget, "selection");
+        if (id != protocol::kInvalidNodeId) {
+            sendSelect(id);
+            completeTarget(m_options.selectTarget);
+        }
+    }
+
+    if (m_options.propertiesTarget.pending() && m_options.propertiesTarget.isQuery()) {
+        const NodeId id = findQueryTarget(m_options.propertiesTarget, "property request");
+        if (id != protocol::kInvalidNodeId) {
+            requestProperties(id);
+            completeTarget(m_options.propertiesTarget);
+        }
+    }
+
+    if (m_options.subscribeTarget.pending() && m_options.subscribeTarget.isQuery()) {
+        const NodeId id = findQueryTarget(m_options.subscribeTarget, "subscription");
+        if (id != protocol::kInvalidNodeId) {
+            sendSubscribe(id);
+            completeTarget(m_options.subscribeTarget);
+        }
+    }
+}
+
+NodeId Client::findQueryTarget(const ActionTarget &target, const char *action)
+{
+    const bool byName = target.kind == ActionTarget::Kind::ObjectName;
+    const QVector<NodeId> ids =
+        byName ? m_replica.findByObjectName(target.query) : m_replica.findByClass(target.query);
+    const char *what = byName ? "objectName" : "class";
+    if (ids.isEmpty()) {
+        m_stderr << "qt-spy cli: no object with " << what << " '" << target.query << "' for "
+                 << action << "." << Qt::endl;
+        return protocol::kInvalidNodeId;
+    }
+    // Ids are handed out in creation order, so the oldest match wins.
+    if (ids.size() > 1) {
+        m_stderr << "qt-spy cli: " << ids.size() << " objects with " << what << " '"
+                 << target.query << "'; using id=" << ids.first() << " for " << action << "."
+                 << Qt::endl;
+    }
+    return ids.first();
 }
 
 void Client::completeTarget(ActionTarget &target)
@@ -1153,20 +1363,76 @@ int main(int argc, char *argv[])
                                           QStringLiteral("Exit after the first snapshot is printed."));
     parser.addOption(snapshotOnceOption);
 
+    QCommandLineOption statsOption(QStringLiteral("stats"),
+                                   QStringLiteral("Print the probe's counters and latency histograms "
+                                                  "and exit."));
+    parser.addOption(statsOption);
+
     QCommandLineOption selectOption(QStringLiteral("select"),
-                                    QStringLiteral("Send a selectNode request (use an id or 'first-root')."),
+                                    QStringLiteral("Send a selectNode request (use an id, 'first-root', "
+                                                   "'name:<objectName>' or 'class:<className>')."),
                                     QStringLiteral("id"));
     parser.addOption(selectOption);
 
     QCommandLineOption propsOption(QStringLiteral("properties"),
-                                   QStringLiteral("Request properties (use an id or 'first-root')."),
+                                   QStringLiteral("Request properties (use an id, 'first-root', "
+                                                  "'name:<objectName>' or 'class:<className>')."),
                                    QStringLiteral("id"));
     parser.addOption(propsOption);
 
+    QCommandLineOption subscribeOption(QStringLiteral("subscribe"),
+                                       QStringLiteral("Print property changes of a node (use an id, 'first-root', "
+                                                      "'name:<objectName>' or 'class:<className>'); "
+                                                      "--property-names narrows it."),
+                                       QStringLiteral("id"));
+    parser.addOption(subscribeOption);
+
+    QCommandLineOption maxRateOption(QStringLiteral("max-rate"),
+                                     QStringLiteral("Limit --subscribe updates to this many per second "
+                                                    "and property (0 = unlimited)."),
+                                     QStringLiteral("hz"));
+    parser.addOption(maxRateOption);
+
     QCommandLineOption noInjectOption(QStringLiteral("no-inject"),
                                       QStringLiteral("Disable automatic probe injection."));
     parser.addOption(noInjectOption);
 
+    QCommandLineOption encodingOption(QStringLiteral("encoding"),
+                                      QStringLiteral("Wire encoding to request from the probe ('cbor' or 'json'). "
+                                                     "Output is printed as JSON either way."),
+                                      QStringLiteral("encoding"),
+                                      QLatin1String(protocol::encodings::kCbor));
+    parser.addOption(encodingOption);
+
+    QCommandLineOption chunkSizeOption(QStringLiteral("chunk-size"),
+                                       QStringLiteral("Stream snapshots in chunks of this many nodes "
+                                                      "and print each chunk as it arrives."),
+                                       QStringLiteral("nodes"));
+    parser.addOption(chunkSizeOption);
+
+    QCommandLineOption fieldsOption(QStringLiteral("fields"),
+                                    QStringLiteral("Comma-separated field groups to request: all, structure, "
+                                                   "geometry, properties, dynamic ('-' prefix removes one)."),
+                                    QStringLiteral("list"));
+    parser.addOption(fieldsOption);
+
+    QCommandLineOption propertyNamesOption(QStringLiteral("property-names"),
+                                           QStringLiteral("Comma-separated property names to include; "
+                                                          "all other properties are skipped."),
+                                           QStringLiteral("list"));
+    parser.addOption(propertyNamesOption);
+
+    QCommandLineOption subtreeOption(QStringLiteral("subtree"),
+                                     QStringLiteral("Snapshot only the node with this id and its descendants."),
+                                     QStringLiteral("id"));
+    parser.addOption(subtreeOption);
+
+    QCommandLineOption depthOption(QStringLiteral("depth"),
+                                   QStringLiteral("Include at most this many levels below the snapshot roots; "
+                                                  "deeper nodes are reported by childCount only."),
+                                   QStringLiteral("levels"));
+    parser.addOption(depthOption);
+
     parser.process(app);
 
     QTextStream out(stdout);
@@ -1182,13 +1448,30 @@ int main(int argc, char *argv[])
 
     const int maxRetries = parser.value(retriesOption).toInt();
 
-    auto parseTarget = [](const QString &value) -> ActionTarget {
+    protocol::Encoding encoding = protocol::Encoding::Cbor;
+    if (!protocol::encodingFromName(parser.value(encodingOption).toLower(), &encoding)) {
+        err << "Unknown encoding '" << parser.value(encodingOption)
+            << "' (expected 'cbor' or 'json')." << Qt::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto parseTarget = [](const QString &value, bool *ok) -> ActionTarget {
         ActionTarget target;
+        *ok = true;
         if (value.compare(QStringLiteral("first-root"), Qt::CaseInsensitive) == 0) {
             target.kind = ActionTarget::Kind::FirstRoot;
+        } else if (value.startsWith(QLatin1String("name:"))) {
+            target.kind = ActionTarget::Kind::ObjectName;
+            target.query = value.mid(5);
+            *ok = !target.query.isEmpty();
+        } else if (value.startsWith(QLatin1String("class:"))) {
+            target.kind = ActionTarget::Kind::ClassName;
+            target.query = value.mid(6);
+            *ok = !target.query.isEmpty();
         } else if (!value.isEmpty()) {
             target.kind = ActionTarget::Kind::Id;
-            target.value = value;
+            target.value = value.toULongLong(ok);
+            *ok = *ok && target.value != protocol::kInvalidNodeId;
         }
         if (target.kind != ActionTarget::Kind::None) {
             target.sticky = true;
@@ -1200,10 +1483,73 @@ int main(int argc, char *argv[])
     options.serverNames = resolved.names;
     options.maxRetries = maxRetries;
     options.snapshotOnce = parser.isSet(snapshotOnceOption);
-    options.selectTarget = parseTarget(parser.value(selectOption));
-    options.propertiesTarget = parseTarget(parser.value(propsOption));
+    options.statsOnly = parser.isSet(statsOption);
+    bool targetOk = false;
+    options.selectTarget = parseTarget(parser.value(selectOption), &targetOk);
+    if (!targetOk) {
+        err << "Invalid --select '" << parser.value(selectOption)
+            << "' (expected a numeric node id, 'first-root', 'name:<objectName>' or 'class:<className>')." << Qt::endl;
+        return EXIT_FAILURE;
+    }
+    options.propertiesTarget = parseTarget(parser.value(propsOption), &targetOk);
+    if (!targetOk) {
+        err << "Invalid --properties '" << parser.value(propsOption)
+            << "' (expected a numeric node id, 'first-root', 'name:<objectName>' or 'class:<className>')." << Qt::endl;
+        return EXIT_FAILURE;
+    }
+    options.subscribeTarget = parseTarget(parser.value(subscribeOption), &targetOk);
+    if (!targetOk) {
+        err << "Invalid --subscribe '" << parser.value(subscribeOption)
+            << "' (expected a numeric node id, 'first-root', 'name:<objectName>' or 'class:<className>')." << Qt::endl;
+        return EXIT_FAILURE;
+    }
     options.targetPid = resolved.pid;
     options.enableInjection = !parser.isSet(noInjectOption);
+    options.encoding = encoding;
+    if (parser.isSet(chunkSizeOption)) {
+        bool ok = false;
+        options.snapshotChunkSize = parser.value(chunkSizeOption).toInt(&ok);
+        if (!ok || options.snapshotChunkSize <= 0) {
+            err << "Invalid --chunk-size '" << parser.value(chunkSizeOption)
+                << "' (expected a positive node count)." << Qt::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (parser.isSet(fieldsOption)) {
+        options.fieldMask.fields =
+            parser.value(fieldsOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    }
+    if (parser.isSet(propertyNamesOption)) {
+        options.fieldMask.propertyNames =
+            parser.value(propertyNamesOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    }
+    if (parser.isSet(subtreeOption)) {
+        bool ok = false;
+        options.subtreeRoot = parser.value(subtreeOption).toULongLong(&ok);
+        if (!ok || options.subtreeRoot == protocol::kInvalidNodeId) {
+            err << "Invalid --subtree '" << parser.value(subtreeOption)
+                << "' (expected a numeric node id)." << Qt::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (parser.isSet(depthOption)) {
+        bool ok = false;
+        options.snapshotDepth = parser.value(depthOption).toInt(&ok);
+        if (!ok || options.snapshotDepth < 0) {
+            err << "Invalid --depth '" << parser.value(depthOption)
+                << "' (expected a non-negative level count)." << Qt::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (parser.isSet(maxRateOption)) {
+        bool ok = false;
+        options.maxRateHz = parser.value(maxRateOption).toDouble(&ok);
+        if (!ok || options.maxRateHz < 0.0) {
+            err << "Invalid --max-rate '" << parser.value(maxRateOption)
+                << "' (expected a non-negative rate in Hz)." << Qt::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
     if (options.serverNames.size() > 1) {
         QTextStream(stderr) << "qt-spy cli: server name candidates: "
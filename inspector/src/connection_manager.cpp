@@ -16,14 +16,23 @@ namespace qt_spy {
 
 ConnectionManager::ConnectionManager(QObject *parent)
     : QObject(parent)
-    , m_bridge(new BridgeClient(this))
+    , m_bridge(new BridgeClient(BridgeClient::IoMode::WorkerThread, this))
     , m_state(Disconnected)
     , m_pid(0)
     , m_currentServerIndex(0)
     , m_retryTimer(new QTimer(this))
     , m_retryCount(0)
+    , m_interrupted(false)
 {
     m_retryTimer->setSingleShot(true);
+
+    // The inspector only consumes decoded messages, so use the binary encoding
+    // whenever the probe supports it. Frames are read and decoded on the
+    // bridge's I/O thread, so large snapshots do not stall the UI.
+    m_bridge->setPreferredEncoding(protocol::Encoding::Cbor);
+    // After a brief drop the probe replays the missed updates instead of
+    // sending the whole tree again.
+    m_bridge->setResumeEnabled(true);
     
     // Connect bridge client signals
     connect(m_bridge, &BridgeClient::socketConnected, this, &ConnectionManager::onSocketConnected);
@@ -100,12 +109,21 @@ void ConnectionManager::connectToProcess(const QtProcessInfo &processInfo) {
 void ConnectionManager::disconnect() {
     stopRetryTimer();
     resetConnectionState();
+    const bool wasOpen = (m_state == Connected || m_state == Attached || m_interrupted);
+    m_interrupted = false;
     
-    if (m_bridge->state() != QLocalSocket::UnconnectedState) {
-        m_bridge->disconnectFromServer();
-    }
+    // Also covers a connect the bridge's I/O thread has not reported yet.
+    // The view is cleared, so the next attach must not resume.
+    m_bridge->disconnectFromServer();
+    m_bridge->forgetSession();
     
     setState(Disconnected);
+    
+    // The socket closing is reported later, from the I/O thread, and ignored
+    // by then
+    if (wasOpen) {
+        emit detached();
+    }
 }
 
 void ConnectionManager::reconnect() {
@@ -140,14 +158,20 @@ void ConnectionManager::onSocketDisconnected() {
     if (m_state == Disconnected) {
         return; // Already handled
     }
+    if (m_state == Connecting) {
+        return; // The previous connection closing after a reconnect
+    }
     
     setState(Disconnected);
-    emit detached();
     
     // Try to reconnect if not intentionally disconnected
     if (m_retryCount < MaxRetries && !m_serverNames.isEmpty()) {
+        m_interrupted = true;
+        emit interrupted();
         startRetryTimer();
+        return;
     }
+    emit detached();
 }
 
 void ConnectionManager::onSocketError(QLocalSocket::LocalSocketError error, const QString &message) {
@@ -164,6 +188,8 @@ void ConnectionManager::onSocketError(QLocalSocket::LocalSocketError error, cons
     // Schedule retry
     if (m_retryCount < MaxRetries) {
         startRetryTimer();
+    } else {
+        endInterruption();
     }
 }
 
@@ -178,12 +204,14 @@ void ConnectionManager::onHelloReceived(const QJsonObject &message) {
     m_processName = appName.isEmpty() ? m_processName : appName;
     m_pid = appPid > 0 ? appPid : m_pid;
     
+    m_interrupted = false;
     setState(Attached);
-    emit attached(m_processName, m_pid);
+    emit attached(m_processName, m_pid, m_bridge->resumed());
 }
 
 void ConnectionManager::onGoodbyeReceived(const QJsonObject &message) {
     Q_UNUSED(message)
+    m_interrupted = false;
     setState(Disconnected);
     emit detached();
 }
@@ -194,6 +222,7 @@ void ConnectionManager::onRetryTimer() {
     if (m_retryCount >= MaxRetries) {
         setState(Error);
         emit connectionError("Maximum retry attempts exceeded");
+        endInterruption();
         return;
     }
     
@@ -273,6 +302,14 @@ void ConnectionManager::resetConnectionState() {
     m_serverNames.clear();
 }
 
+void ConnectionManager::endInterruption() {
+    // Reconnecting gave up; the view kept since the drop goes now.
+    if (m_interrupted) {
+        m_interrupted = false;
+        emit detached();
+    }
+}
+
 bool ConnectionManager::injectProbe(const QtProcessInfo &processInfo) {
 #if defined(Q_OS_UNIX)
     // Use the exact same injection script that works with CLI
@@ -43,7 +43,12 @@ public slots:
 signals:
     void stateChanged(ConnectionState state);
     void statusChanged(const QString &status);
-    void attached(const QString &applicationName, qint64 pid);
+    // resumed: the probe picked up the previous session, so the view is
+    // still current and only the missed updates follow.
+    void attached(const QString &applicationName, qint64 pid, bool resumed);
+    // The connection dropped and a reconnect is scheduled; the view is kept
+    // until it resumes or detached() follows.
+    void interrupted();
     void detached();
     void connectionError(const QString &error);
     
@@ -62,6 +67,7 @@ private:
     QStringList generateServerNames(const QtProcessInfo &processInfo);
     bool tryNextServerName();
     void resetConnectionState();
+    void endInterruption();
 
     BridgeClient *m_bridge;
     ConnectionState m_state;
@@ -72,6 +78,7 @@ private:
     int m_currentServerIndex;
     QTimer *m_retryTimer;
     int m_retryCount;
+    bool m_interrupted;
     static constexpr int MaxRetries = 3;
 };
 
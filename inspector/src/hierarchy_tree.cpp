@@ -5,11 +5,17 @@
 #include <QJsonArray>
 #include <QJsonValue>
 #include <QHeaderView>
-#include <QDateTime>
 #include <QDebug>
 
 namespace qt_spy {
 
+namespace {
+
+// Levels fetched below a node expanded past the snapshot's depth limit.
+constexpr int kSubtreeFetchDepth = 4;
+
+} // namespace
+
 HierarchyTreeModel::HierarchyTreeModel(QObject *parent)
     : QAbstractItemModel(parent)
     , m_bridge(nullptr)
@@ -25,13 +31,13 @@ void HierarchyTreeModel::setBridgeClient(BridgeClient *bridge) {
     m_bridge = bridge;
     
     if (m_bridge) {
-        connect(m_bridge, &BridgeClient::propertiesReceived, 
-                this, &HierarchyTreeModel::onPropertiesReceived);
         connect(m_bridge, &BridgeClient::nodeAdded,
-                this, [this](const QJsonObject &msg) { addNode(msg); });
+                this, [this](const QJsonObject &msg) {
+                    addNode(msg.value(QLatin1String(protocol::keys::kNode)).toObject());
+                });
         connect(m_bridge, &BridgeClient::nodeRemoved,
                 this, [this](const QJsonObject &msg) { 
-                    const QString nodeId = msg.value(QLatin1String(protocol::keys::kId)).toString();
+                    const NodeId nodeId = protocol::nodeIdFromJson(msg.value(QLatin1String(protocol::keys::kId)));
                     removeNode(nodeId);
                 });
         connect(m_bridge, &BridgeClient::propertiesChanged,
@@ -48,105 +54,130 @@ void HierarchyTreeModel::loadSnapshot(const QJsonObject &snapshot) {
     delete m_rootItem;
     m_rootItem = new TreeItem;
     m_itemMap.clear();
-    m_nodesMap.clear();
+    m_pendingRootIds.clear();
+    m_pendingSubtrees.clear();
     
-    // Parse root node IDs
-    const QJsonArray rootIds = snapshot.value(QLatin1String(protocol::keys::kRootIds)).toArray();
+    // The replica keeps every node for lazy loading of children
+    m_replica.applySnapshot(snapshot);
     
-    // Parse nodes - check if it's an array or object
-    QJsonValue nodesValue = snapshot.value(QLatin1String(protocol::keys::kNodes));
-    QHash<QString, QJsonObject> nodesMap;
-    
-    if (nodesValue.isArray()) {
-        // Nodes sent as array - convert to map by ID
-        const QJsonArray nodesArray = nodesValue.toArray();
-        qDebug() << "HierarchyTreeModel: Found" << rootIds.size() << "root IDs and" << nodesArray.size() << "nodes (array format)";
-        
-        for (const QJsonValue &nodeValue : nodesArray) {
-            const QJsonObject nodeObj = nodeValue.toObject();
-            const QString nodeId = nodeObj.value(QLatin1String(protocol::keys::kId)).toString();
-            if (!nodeId.isEmpty()) {
-                nodesMap.insert(nodeId, nodeObj);
-            }
-        }
-    } else {
-        // Nodes sent as object (legacy format)
-        const QJsonObject nodesObject = nodesValue.toObject();
-        qDebug() << "HierarchyTreeModel: Found" << rootIds.size() << "root IDs and" << nodesObject.size() << "nodes (object format)";
-        
-        for (auto it = nodesObject.begin(); it != nodesObject.end(); ++it) {
-            nodesMap.insert(it.key(), it.value().toObject());
-        }
-    }
-    
-    qDebug() << "HierarchyTreeModel: Created nodes map with" << nodesMap.size() << "entries";
+    const QVector<NodeId> rootIds = m_replica.rootIds();
+    qDebug() << "HierarchyTreeModel: Found" << rootIds.size() << "root IDs and" << m_replica.size() << "nodes";
     
     // Create root items
-    for (const QJsonValue &rootIdValue : rootIds) {
-        const QString rootId = rootIdValue.toString();
-        if (rootId.isEmpty()) continue;
-        
+    for (const NodeId rootId : rootIds) {
         qDebug() << "HierarchyTreeModel: Processing root ID:" << rootId;
         
-        const QJsonObject nodeJson = nodesMap.value(rootId);
-        if (nodeJson.isEmpty()) {
+        if (!m_replica.contains(rootId)) {
             qDebug() << "HierarchyTreeModel: No node data found for root ID:" << rootId;
             continue;
         }
         
-        NodeData nodeData = NodeData::fromJson(nodeJson);
-        nodeData.id = rootId;
+        NodeData nodeData = NodeData::fromReplica(m_replica.node(rootId));
         
-        // For root nodes, be very restrictive - only show actual UI containers
-        const QString displayName = nodeData.displayName();
-        const QString className = nodeData.className;
-        
-        // Only allow top-level UI container classes as roots
-        bool isUIContainer = (className == "QQuickView" || 
-                             className == "QMainWindow" || 
-                             className == "QWidget" || 
-                             className == "QWindow" ||
-                             className == "QDialog" ||
-                             (className.endsWith("Widget") && className.startsWith("Q")) ||
-                             (className.endsWith("Window") && className.startsWith("Q")) ||
-                             (className.endsWith("View") && className.startsWith("Q")));
+        if (!acceptRootNode(nodeData)) {
+            continue;
+        }
         
-        if (!isUIContainer) {
-            qDebug() << "HierarchyTreeModel: Skipping non-UI container root item:" << rootId << "className:" << className << "displayName:" << displayName;
+        qDebug() << "HierarchyTreeModel: Creating root item for:" << nodeData.displayName();
+        addChildToItem(m_rootItem, nodeData);
+    }
+    
+    qDebug() << "HierarchyTreeModel: Final tree has" << m_rootItem->children.size() << "root items";
+    
+    endResetModel();
+}
+
+void HierarchyTreeModel::beginSnapshot(const QJsonObject &begin) {
+    beginResetModel();
+    
+    delete m_rootItem;
+    m_rootItem = new TreeItem;
+    m_itemMap.clear();
+    m_pendingRootIds.clear();
+    m_pendingSubtrees.clear();
+    
+    m_replica.applySnapshotBegin(begin);
+    const QVector<NodeId> rootIds = m_replica.rootIds();
+    for (const NodeId rootId : rootIds) {
+        m_pendingRootIds.insert(rootId);
+    }
+    
+    qDebug() << "HierarchyTreeModel: Streaming snapshot with" << m_pendingRootIds.size() << "root IDs";
+    
+    endResetModel();
+}
+
+void HierarchyTreeModel::appendSnapshotNodes(const QJsonArray &nodes) {
+    QJsonObject chunk;
+    chunk[QLatin1String(protocol::keys::kNodes)] = nodes;
+    m_replica.applySnapshotChunk(chunk);
+    
+    for (const QJsonValue &nodeValue : nodes) {
+        const NodeId nodeId = protocol::nodeIdFromJson(nodeValue.toObject().value(QLatin1String(protocol::keys::kId)));
+        if (nodeId == protocol::kInvalidNodeId || m_itemMap.contains(nodeId)) {
             continue;
         }
         
-        qDebug() << "HierarchyTreeModel: Including UI container root item:" << className << "for root ID:" << rootId;
+        NodeData nodeData = NodeData::fromReplica(m_replica.node(nodeId));
         
-        // Use className as display name if no better option
-        if (displayName.isEmpty() || displayName.trimmed().isEmpty()) {
-            if (nodeData.objectName.isEmpty()) {
-                nodeData.objectName = className;
+        TreeItem *parentItem = nullptr;
+        if (m_pendingRootIds.remove(nodeId)) {
+            if (!acceptRootNode(nodeData)) {
+                continue;
             }
+            parentItem = m_rootItem;
+        } else {
+            // Children normally arrive before their parent is expanded and are
+            // picked up by fetchMore(); only parents that were already
+            // expanded need the late arrival inserted directly.
+            TreeItem *candidate = m_itemMap.value(nodeData.parentId);
+            if (!candidate || !candidate->childrenRequested || !acceptChildNode(nodeData)) {
+                continue;
+            }
+            parentItem = candidate;
         }
         
-        qDebug() << "HierarchyTreeModel: Creating root item for:" << displayName;
-        addChildToItem(m_rootItem, nodeData);
+        const int row = parentItem->children.size();
+        beginInsertRows(indexForItem(parentItem), row, row);
+        addChildToItem(parentItem, nodeData);
+        endInsertRows();
+    }
+}
+
+void HierarchyTreeModel::endSnapshot(const QJsonObject &end) {
+    m_replica.applySnapshotEnd(end);
+}
+
+void HierarchyTreeModel::mergeSubtree(const QJsonObject &snapshot) {
+    const NodeId rootId = protocol::nodeIdFromJson(snapshot.value(QLatin1String(protocol::keys::kRootId)));
+    if (!m_pendingSubtrees.remove(rootId)) {
+        return; // not ours, or from before the last full snapshot
     }
     
-    // Store the full nodes map for lazy loading of children
-    m_nodesMap = nodesMap;
-    
-    qDebug() << "HierarchyTreeModel: Final tree has" << m_rootItem->children.size() << "root items";
+    m_replica.applySnapshot(snapshot);
     
-    endResetModel();
+    // The root's entry now lists its children; load them like any other.
+    TreeItem *item = m_itemMap.value(rootId);
+    if (item && !item->childrenRequested) {
+        fetchMore(indexForItem(item));
+    }
 }
 
 void HierarchyTreeModel::addNode(const QJsonObject &nodeData) {
-    const QString nodeId = nodeData.value(QLatin1String(protocol::keys::kId)).toString();
-    const QString parentId = nodeData.value(QLatin1String(protocol::keys::kParentId)).toString();
+    const NodeId nodeId = protocol::nodeIdFromJson(nodeData.value(QLatin1String(protocol::keys::kId)));
+    const NodeId parentId = protocol::nodeIdFromJson(nodeData.value(QLatin1String(protocol::keys::kParentId)));
     
-    if (nodeId.isEmpty()) return;
+    if (nodeId == protocol::kInvalidNodeId) return;
     
-    NodeData data = NodeData::fromJson(nodeData);
-    data.id = nodeId;
+    // Lazily attached probes announce new nodes with only a childCount;
+    // fetchMore() needs the node data to request them
+    QJsonObject added;
+    added[QLatin1String(protocol::keys::kNode)] = nodeData;
+    m_replica.applyNodeAdded(added);
     
-    TreeItem *parentItem = parentId.isEmpty() ? m_rootItem : m_itemMap.value(parentId);
+    NodeData data = NodeData::fromReplica(m_replica.node(nodeId));
+    
+    TreeItem *parentItem = parentId == protocol::kInvalidNodeId ? m_rootItem : m_itemMap.value(parentId);
     if (!parentItem) {
         // Parent not found, might need to request it
         return;
@@ -166,7 +197,11 @@ void HierarchyTreeModel::addNode(const QJsonObject &nodeData) {
     endInsertRows();
 }
 
-void HierarchyTreeModel::removeNode(const QString &nodeId) {
+void HierarchyTreeModel::removeNode(NodeId nodeId) {
+    QJsonObject removed;
+    removed[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(nodeId);
+    m_replica.applyNodeRemoved(removed);
+    
     TreeItem *item = m_itemMap.value(nodeId);
     if (!item || !item->parent) return;
     
@@ -182,18 +217,19 @@ void HierarchyTreeModel::removeNode(const QString &nodeId) {
 }
 
 void HierarchyTreeModel::updateNodeProperties(const QJsonObject &propertiesData) {
-    const QString nodeId = propertiesData.value(QLatin1String(protocol::keys::kId)).toString();
+    const NodeId nodeId = protocol::nodeIdFromJson(propertiesData.value(QLatin1String(protocol::keys::kId)));
     TreeItem *item = m_itemMap.value(nodeId);
     
     if (!item) return;
     
-    // Update properties
-    const QJsonObject properties = propertiesData.value(QLatin1String(protocol::keys::kProperties)).toObject();
-    item->data.properties = properties;
+    // propertiesChanged carries only the changed values; the replica merges
+    // them into what the node already has.
+    m_replica.applyPropertiesChanged(propertiesData);
+    item->data.properties = m_replica.properties(nodeId);
     
     // Update display info if available
-    const QString className = properties.value("className").toString();
-    const QString objectName = properties.value("objectName").toString();
+    const QString className = m_replica.className(nodeId);
+    const QString objectName = m_replica.objectName(nodeId);
     
     if (!className.isEmpty()) {
         item->data.className = className;
@@ -212,12 +248,12 @@ NodeData HierarchyTreeModel::nodeData(const QModelIndex &index) const {
     return item ? item->data : NodeData{};
 }
 
-QString HierarchyTreeModel::nodeId(const QModelIndex &index) const {
+NodeId HierarchyTreeModel::nodeId(const QModelIndex &index) const {
     TreeItem *item = itemFromIndex(index);
-    return item ? item->id : QString();
+    return item ? item->id : protocol::kInvalidNodeId;
 }
 
-QModelIndex HierarchyTreeModel::findNodeIndex(const QString &nodeId) const {
+QModelIndex HierarchyTreeModel::findNodeIndex(NodeId nodeId) const {
     TreeItem *item = m_itemMap.value(nodeId);
     if (!item || !item->parent) {
         return QModelIndex();
@@ -226,6 +262,10 @@ QModelIndex HierarchyTreeModel::findNodeIndex(const QString &nodeId) const {
     return createIndex(item->parent->childIndex(item), 0, item);
 }
 
+const ObjectReplica &HierarchyTreeModel::replica() const {
+    return m_replica;
+}
+
 QModelIndex HierarchyTreeModel::index(int row, int column, const QModelIndex &parent) const {
     if (!hasIndex(row, column, parent)) {
         return QModelIndex();
@@ -325,11 +365,7 @@ bool HierarchyTreeModel::hasChildren(const QModelIndex &parent) const {
     
     // If children haven't been loaded yet, check the snapshot data
     if (!parentItem->childrenRequested) {
-        const QJsonObject nodeData = m_nodesMap.value(parentItem->id);
-        if (!nodeData.isEmpty()) {
-            const QJsonArray childIds = nodeData.value(QLatin1String(protocol::keys::kChildIds)).toArray();
-            return !childIds.isEmpty();
-        }
+        return hasSnapshotChildren(parentItem->id);
     }
     
     return false;
@@ -342,18 +378,12 @@ bool HierarchyTreeModel::canFetchMore(const QModelIndex &parent) const {
     }
     
     // Can fetch more if we haven't loaded children yet and node has childIds in the snapshot
-    if (parentItem->childrenRequested) {
+    if (parentItem->childrenRequested || m_pendingSubtrees.contains(parentItem->id)) {
         return false;
     }
     
     // Check if this node has children in the stored snapshot data
-    const QJsonObject nodeData = m_nodesMap.value(parentItem->id);
-    if (nodeData.isEmpty()) {
-        return false;
-    }
-    
-    const QJsonArray childIds = nodeData.value(QLatin1String(protocol::keys::kChildIds)).toArray();
-    return !childIds.isEmpty();
+    return hasSnapshotChildren(parentItem->id);
 }
 
 void HierarchyTreeModel::fetchMore(const QModelIndex &parent) {
@@ -363,13 +393,18 @@ void HierarchyTreeModel::fetchMore(const QModelIndex &parent) {
     }
     
     // Load children from stored snapshot data
-    const QJsonObject nodeData = m_nodesMap.value(parentItem->id);
-    if (nodeData.isEmpty()) {
+    const ReplicaNode node = m_replica.node(parentItem->id);
+    if (!node.isValid()) {
         return;
     }
     
-    const QJsonArray childIds = nodeData.value(QLatin1String(protocol::keys::kChildIds)).toArray();
+    const QVector<NodeId> &childIds = node.childIds;
     if (childIds.isEmpty()) {
+        if (node.childCount > 0) {
+            // Cut off by the snapshot's depth limit; fetched on demand.
+            requestSubtree(parentItem);
+            return;
+        }
         parentItem->childrenRequested = true;
         return;
     }
@@ -378,41 +413,15 @@ void HierarchyTreeModel::fetchMore(const QModelIndex &parent) {
     
     // Create child nodes from snapshot data
     QVector<NodeData> childrenData;
-    for (const QJsonValue &childIdValue : childIds) {
-        const QString childId = childIdValue.toString();
-        if (childId.isEmpty() || m_itemMap.contains(childId)) {
-            continue;
-        }
-        
-        const QJsonObject childNodeData = m_nodesMap.value(childId);
-        if (childNodeData.isEmpty()) {
+    for (const NodeId childId : childIds) {
+        if (m_itemMap.contains(childId) || !m_replica.contains(childId)) {
             continue;
         }
         
-        NodeData childData = NodeData::fromJson(childNodeData);
-        childData.id = childId;
+        NodeData childData = NodeData::fromReplica(m_replica.node(childId));
         
-        // Skip children with empty display names, but include UI-related children
-        const QString displayName = childData.displayName();
-        if (displayName.isEmpty() || displayName.trimmed().isEmpty()) {
-            // For child nodes, accept UI-related classes and QML items
-            const QString className = childData.className;
-            if (className.startsWith("QQuick") ||  // QML items (QQuickItem, QQuickRectangle, etc.)
-                className.startsWith("QWidget") ||
-                className.startsWith("QWindow") ||
-                className.startsWith("QDialog") ||
-                className.endsWith("Widget") ||
-                className.endsWith("Item") ||
-                className.endsWith("_QMLTYPE_")) {  // QML types
-                qDebug() << "HierarchyTreeModel: Including UI child with className:" << className << "for child ID:" << childId;
-                // Use className as display name if no better option
-                if (childData.objectName.isEmpty()) {
-                    childData.objectName = className;
-                }
-            } else {
-                qDebug() << "HierarchyTreeModel: Skipping non-UI child with empty display name:" << childId << "className:" << className;
-                continue;
-            }
+        if (!acceptChildNode(childData)) {
+            continue;
         }
         
         childrenData.append(childData);
@@ -436,11 +445,7 @@ void HierarchyTreeModel::fetchMore(const QModelIndex &parent) {
 }
 
 void HierarchyTreeModel::onPropertiesReceived(const QJsonObject &message) {
-    const QString nodeId = message.value(QLatin1String(protocol::keys::kId)).toString();
-    const QString requestId = message.value(QLatin1String(protocol::keys::kRequestId)).toString();
-    
-    // Remove from pending requests
-    m_pendingRequests.removeAll(requestId);
+    const NodeId nodeId = protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId)));
     
     TreeItem *item = m_itemMap.value(nodeId);
     if (!item) return;
@@ -455,8 +460,8 @@ void HierarchyTreeModel::onPropertiesReceived(const QJsonObject &message) {
         beginInsertRows(createIndex(item->parent->childIndex(item), 0, item), 0, childIds.size() - 1);
         
         for (const QJsonValue &childIdValue : childIds) {
-            const QString childId = childIdValue.toString();
-            if (childId.isEmpty() || m_itemMap.contains(childId)) continue;
+            const NodeId childId = protocol::nodeIdFromJson(childIdValue);
+            if (childId == protocol::kInvalidNodeId || m_itemMap.contains(childId)) continue;
             
             NodeData childData;
             childData.id = childId;
@@ -479,7 +484,7 @@ HierarchyTreeModel::TreeItem *HierarchyTreeModel::itemFromIndex(const QModelInde
     return static_cast<TreeItem *>(index.internalPointer());
 }
 
-HierarchyTreeModel::TreeItem *HierarchyTreeModel::findItem(const QString &nodeId, TreeItem *root) const {
+HierarchyTreeModel::TreeItem *HierarchyTreeModel::findItem(NodeId nodeId, TreeItem *root) const {
     if (!root) {
         root = m_rootItem;
     }
@@ -507,7 +512,73 @@ void HierarchyTreeModel::addChildToItem(TreeItem *parentItem, const NodeData &no
     m_itemMap.insert(nodeData.id, childItem);
 }
 
-void HierarchyTreeModel::removeChildFromItem(TreeItem *parentItem, const QString &childId) {
+bool HierarchyTreeModel::acceptRootNode(NodeData &nodeData) const {
+    // For root nodes, be very restrictive - only show actual UI containers
+    const QString displayName = nodeData.displayName();
+    const QString className = nodeData.className;
+    
+    // Only allow top-level UI container classes as roots
+    bool isUIContainer = (className == "QQuickView" || 
+                         className == "QMainWindow" || 
+                         className == "QWidget" || 
+                         className == "QWindow" ||
+                         className == "QDialog" ||
+                         (className.endsWith("Widget") && className.startsWith("Q")) ||
+                         (className.endsWith("Window") && className.startsWith("Q")) ||
+                         (className.endsWith("View") && className.startsWith("Q")));
+    
+    if (!isUIContainer) {
+        qDebug() << "HierarchyTreeModel: Skipping non-UI container root item:" << nodeData.id << "className:" << className << "displayName:" << displayName;
+        return false;
+    }
+    
+    qDebug() << "HierarchyTreeModel: Including UI container root item:" << className << "for root ID:" << nodeData.id;
+    
+    // Use className as display name if no better option
+    if (displayName.isEmpty() || displayName.trimmed().isEmpty()) {
+        if (nodeData.objectName.isEmpty()) {
+            nodeData.objectName = className;
+        }
+    }
+    return true;
+}
+
+bool HierarchyTreeModel::acceptChildNode(NodeData &nodeData) const {
+    // Skip children with empty display names, but include UI-related children
+    const QString displayName = nodeData.displayName();
+    if (!displayName.isEmpty() && !displayName.trimmed().isEmpty()) {
+        return true;
+    }
+    
+    // For child nodes, accept UI-related classes and QML items
+    const QString className = nodeData.className;
+    if (className.startsWith("QQuick") ||  // QML items (QQuickItem, QQuickRectangle, etc.)
+        className.startsWith("QWidget") ||
+        className.startsWith("QWindow") ||
+        className.startsWith("QDialog") ||
+        className.endsWith("Widget") ||
+        className.endsWith("Item") ||
+        className.endsWith("_QMLTYPE_")) {  // QML types
+        qDebug() << "HierarchyTreeModel: Including UI child with className:" << className << "for child ID:" << nodeData.id;
+        // Use className as display name if no better option
+        if (nodeData.objectName.isEmpty()) {
+            nodeData.objectName = className;
+        }
+        return true;
+    }
+    
+    qDebug() << "HierarchyTreeModel: Skipping non-UI child with empty display name:" << nodeData.id << "className:" << className;
+    return false;
+}
+
+QModelIndex HierarchyTreeModel::indexForItem(TreeItem *item) const {
+    if (!item || item == m_rootItem || !item->parent) {
+        return QModelIndex();
+    }
+    return createIndex(item->parent->childIndex(item), 0, item);
+}
+
+void HierarchyTreeModel::removeChildFromItem(TreeItem *parentItem, NodeId childId) {
     for (int i = 0; i < parentItem->children.size(); ++i) {
         TreeItem *child = parentItem->children.at(i);
         if (child->id == childId) {
@@ -524,12 +595,43 @@ void HierarchyTreeModel::requestPropertiesForItem(TreeItem *item) {
         return;
     }
     
-    const QString requestId = QString("tree_req_%1").arg(QDateTime::currentMSecsSinceEpoch());
-    m_pendingRequests.append(requestId);
-    m_bridge->requestProperties(item->id, requestId);
+    // Only the answer to this request may add children; properties fetched
+    // for other views leave the tree alone.
+    BridgeReply *reply = m_bridge->sendPropertiesRequest(item->id);
+    connect(reply, &BridgeReply::finished, this, [this, reply]() {
+        if (reply->status() == BridgeReply::Status::Finished) {
+            onPropertiesReceived(reply->message());
+        }
+        reply->deleteLater();
+    });
     item->childrenRequested = true;
 }
 
+void HierarchyTreeModel::requestSubtree(TreeItem *item) {
+    if (!m_bridge || m_pendingSubtrees.contains(item->id)) {
+        return;
+    }
+    
+    SnapshotOptions options;
+    options.rootId = item->id;
+    options.maxDepth = kSubtreeFetchDepth;
+    const NodeId rootId = item->id;
+    m_pendingSubtrees.insert(rootId);
+    BridgeReply *reply = m_bridge->sendSnapshotRequest(options);
+    connect(reply, &BridgeReply::finished, this, [this, reply, rootId]() {
+        if (reply->status() == BridgeReply::Status::Finished) {
+            mergeSubtree(reply->message());
+        } else {
+            m_pendingSubtrees.remove(rootId); // expanding again retries
+        }
+        reply->deleteLater();
+    });
+}
+
+bool HierarchyTreeModel::hasSnapshotChildren(NodeId nodeId) const {
+    return m_replica.childCount(nodeId) > 0;
+}
+
 // HierarchyTreeView implementation
 
 HierarchyTreeView::HierarchyTreeView(QWidget *parent)
@@ -552,8 +654,8 @@ void HierarchyTreeView::selectionChanged(const QItemSelection &selected,
     const QModelIndexList indexes = selected.indexes();
     if (!indexes.isEmpty()) {
         if (auto *treeModel = qobject_cast<HierarchyTreeModel *>(model())) {
-            const QString nodeId = treeModel->nodeId(indexes.first());
-            if (!nodeId.isEmpty()) {
+            const NodeId nodeId = treeModel->nodeId(indexes.first());
+            if (nodeId != protocol::kInvalidNodeId) {
                 emit nodeSelected(nodeId);
             }
         }
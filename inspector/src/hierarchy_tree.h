@@ -1,12 +1,15 @@
 #pragma once
 
 #include "node_data.h"
+#include "qt_spy/object_replica.h"
 
 #include <QAbstractItemModel>
 #include <QTreeView>
 #include <QHash>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QItemSelection>
+#include <QSet>
 
 namespace qt_spy {
 
@@ -20,13 +23,23 @@ public:
     
     void setBridgeClient(BridgeClient *bridge);
     void loadSnapshot(const QJsonObject &snapshot);
+    // Chunked snapshots: reset on begin, then grow the tree as chunks arrive.
+    void beginSnapshot(const QJsonObject &begin);
+    void appendSnapshotNodes(const QJsonArray &nodes);
+    void endSnapshot(const QJsonObject &end);
+    // Reply to a subtree request made by fetchMore() for a node whose
+    // children were cut off by the snapshot's depth limit; the model routes
+    // it here itself.
+    void mergeSubtree(const QJsonObject &snapshot);
     void addNode(const QJsonObject &nodeData);
-    void removeNode(const QString &nodeId);
+    void removeNode(NodeId nodeId);
     void updateNodeProperties(const QJsonObject &propertiesData);
     
     NodeData nodeData(const QModelIndex &index) const;
-    QString nodeId(const QModelIndex &index) const;
-    QModelIndex findNodeIndex(const QString &nodeId) const;
+    NodeId nodeId(const QModelIndex &index) const;
+    QModelIndex findNodeIndex(NodeId nodeId) const;
+    // Every node received, including those not shown or not loaded yet.
+    const ObjectReplica &replica() const;
     
     // QAbstractItemModel interface
     QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
@@ -44,7 +57,7 @@ private slots:
     
 private:
     struct TreeItem {
-        QString id;
+        NodeId id = protocol::kInvalidNodeId;
         NodeData data;
         TreeItem *parent = nullptr;
         QVector<TreeItem *> children;
@@ -54,7 +67,7 @@ private:
             qDeleteAll(children);
         }
         
-        TreeItem *findChild(const QString &childId) const {
+        TreeItem *findChild(NodeId childId) const {
             for (TreeItem *child : children) {
                 if (child->id == childId) {
                     return child;
@@ -69,16 +82,22 @@ private:
     };
     
     TreeItem *itemFromIndex(const QModelIndex &index) const;
-    TreeItem *findItem(const QString &nodeId, TreeItem *root = nullptr) const;
+    TreeItem *findItem(NodeId nodeId, TreeItem *root = nullptr) const;
     void addChildToItem(TreeItem *parentItem, const NodeData &nodeData);
-    void removeChildFromItem(TreeItem *parentItem, const QString &childId);
+    bool acceptRootNode(NodeData &nodeData) const;
+    bool acceptChildNode(NodeData &nodeData) const;
+    QModelIndex indexForItem(TreeItem *item) const;
+    void removeChildFromItem(TreeItem *parentItem, NodeId childId);
     void requestPropertiesForItem(TreeItem *item);
+    void requestSubtree(TreeItem *item);
+    bool hasSnapshotChildren(NodeId nodeId) const;
     
     BridgeClient *m_bridge;
     TreeItem *m_rootItem;
-    QHash<QString, TreeItem *> m_itemMap;
-    QHash<QString, QJsonObject> m_nodesMap; // Full nodes data for lazy loading
-    QStringList m_pendingRequests;
+    QHash<NodeId, TreeItem *> m_itemMap;
+    ObjectReplica m_replica; // Full nodes data for lazy loading
+    QSet<NodeId> m_pendingRootIds; // roots announced by snapshotBegin, not yet received
+    QSet<NodeId> m_pendingSubtrees; // truncated nodes whose subtree was requested
 };
 
 class HierarchyTreeView : public QTreeView {
@@ -88,7 +107,7 @@ public:
     explicit HierarchyTreeView(QWidget *parent = nullptr);
     
 signals:
-    void nodeSelected(const QString &nodeId);
+    void nodeSelected(qt_spy::NodeId nodeId);
     
 protected:
     void selectionChanged(const QItemSelection &selected,
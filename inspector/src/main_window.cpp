@@ -17,6 +17,7 @@
 #include <QLabel>
 #include <QMessageBox>
 #include <QCloseEvent>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QDateTime>
@@ -25,6 +26,26 @@
 
 namespace qt_spy {
 
+namespace {
+
+// Levels sent in the initial snapshot; anything deeper is fetched when its
+// parent is expanded.
+constexpr int kInitialSnapshotDepth = 8;
+
+// The property grid cannot show animated values any faster than this.
+constexpr double kSelectionUpdateRateHz = 30.0;
+
+// Stream the tree so large applications populate progressively instead of
+// stalling on one giant snapshot message.
+SnapshotOptions chunkedSnapshotOptions() {
+    SnapshotOptions options;
+    options.chunked = true;
+    options.maxDepth = kInitialSnapshotDepth;
+    return options;
+}
+
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_connectionManager(new ConnectionManager(this))
@@ -68,7 +89,7 @@ void MainWindow::onRefreshClicked() {
         // Request a new snapshot
         const QString requestId = QString("refresh_req_%1").arg(QDateTime::currentMSecsSinceEpoch());
     
-        m_connectionManager->bridgeClient()->requestSnapshot(requestId);
+        m_connectionManager->bridgeClient()->requestSnapshot(requestId, chunkedSnapshotOptions());
     }
 }
 
@@ -80,20 +101,39 @@ void MainWindow::onStatusChanged(const QString &status) {
     m_statusLabel->setText(status);
 }
 
-void MainWindow::onAttached(const QString &applicationName, qint64 pid) {
+void MainWindow::onAttached(const QString &applicationName, qint64 pid, bool resumed) {
     m_connectionLabel->setText(QString("Connected to: %1 (PID: %2)").arg(applicationName).arg(pid));
     
+    if (resumed) {
+        // The tree is current once the replayed updates are applied and the
+        // probe carried the subscription over; only the selection belonged to
+        // the old connection
+        if (m_subscribedNodeId != protocol::kInvalidNodeId) {
+            m_connectionManager->bridgeClient()->selectNode(m_subscribedNodeId);
+        }
+        return;
+    }
+    
+    // Ids from an interrupted session mean nothing to this one
+    m_subscribedNodeId = protocol::kInvalidNodeId;
+    m_propertyGrid->clearProperties();
+    
     // Request initial snapshot after successful attachment
     const QString requestId = QString("snapshot_req_%1").arg(QDateTime::currentMSecsSinceEpoch());
     
     // Add a small delay before requesting snapshot to ensure probe is ready
     QTimer::singleShot(500, [this, requestId]() {
-        m_connectionManager->bridgeClient()->requestSnapshot(requestId);
+        m_connectionManager->bridgeClient()->requestSnapshot(requestId, chunkedSnapshotOptions());
     });
 }
 
+void MainWindow::onInterrupted() {
+    m_connectionLabel->setText("Connection lost, reconnecting...");
+}
+
 void MainWindow::onDetached() {
     m_connectionLabel->setText("Not connected");
+    m_subscribedNodeId = protocol::kInvalidNodeId;
     m_treeModel->loadSnapshot(QJsonObject()); // Clear tree
     m_propertyGrid->clearProperties();
 }
@@ -103,24 +143,51 @@ void MainWindow::onConnectionError(const QString &error) {
                         QString("Failed to connect to Qt process:\n%1").arg(error));
 }
 
-void MainWindow::onNodeSelected(const QString &nodeId) {
-    if (!nodeId.isEmpty()) {
+void MainWindow::onNodeSelected(NodeId nodeId) {
+    if (nodeId != protocol::kInvalidNodeId) {
         m_propertyGrid->showNodeProperties(nodeId);
         
         // Also send selection notification to the target app
         if (m_connectionManager->state() == ConnectionManager::Attached) {
-            m_connectionManager->bridgeClient()->selectNode(nodeId);
+            BridgeClient *bridge = m_connectionManager->bridgeClient();
+            bridge->selectNode(nodeId);
+            
+            // Only the selected node's property changes are of interest
+            if (nodeId != m_subscribedNodeId) {
+                if (m_subscribedNodeId != protocol::kInvalidNodeId) {
+                    bridge->unsubscribe({m_subscribedNodeId});
+                }
+                bridge->subscribe({nodeId}, QStringList(), QString(), kSelectionUpdateRateHz);
+                m_subscribedNodeId = nodeId;
+            }
         }
     }
 }
 
 void MainWindow::onSnapshotReceived(const QJsonObject &snapshot) {
-    // Process the snapshot
+    // Subtrees answer the model's own expansion requests, which it collects
+    // through their replies
+    if (snapshot.contains(QLatin1String(protocol::keys::kRootId))) {
+        return;
+    }
     
     m_treeModel->loadSnapshot(snapshot);
     m_treeView->expandAll(); // Expand root level items initially
 }
 
+void MainWindow::onSnapshotBegun(const QJsonObject &message) {
+    m_treeModel->beginSnapshot(message);
+}
+
+void MainWindow::onSnapshotChunkReceived(const QJsonObject &message) {
+    m_treeModel->appendSnapshotNodes(message.value(QLatin1String(protocol::keys::kNodes)).toArray());
+}
+
+void MainWindow::onSnapshotFinished(const QJsonObject &message) {
+    m_treeModel->endSnapshot(message);
+    m_treeView->expandAll(); // Expand root level items initially
+}
+
 void MainWindow::setupUi() {
     // Create central splitter
     m_splitter = new QSplitter(Qt::Horizontal, this);
@@ -214,6 +281,8 @@ void MainWindow::setupConnections() {
             this, &MainWindow::onStatusChanged);
     connect(m_connectionManager, &ConnectionManager::attached,
             this, &MainWindow::onAttached);
+    connect(m_connectionManager, &ConnectionManager::interrupted,
+            this, &MainWindow::onInterrupted);
     connect(m_connectionManager, &ConnectionManager::detached,
             this, &MainWindow::onDetached);
     connect(m_connectionManager, &ConnectionManager::connectionError,
@@ -222,6 +291,15 @@ void MainWindow::setupConnections() {
     // Bridge client signals
     connect(m_connectionManager->bridgeClient(), &BridgeClient::snapshotReceived,
             this, &MainWindow::onSnapshotReceived);
+    connect(m_connectionManager->bridgeClient(), &BridgeClient::snapshotBegun,
+            this, &MainWindow::onSnapshotBegun);
+    connect(m_connectionManager->bridgeClient(), &BridgeClient::snapshotChunkReceived,
+            this, &MainWindow::onSnapshotChunkReceived);
+    connect(m_connectionManager->bridgeClient(), &BridgeClient::snapshotFinished,
+            this, &MainWindow::onSnapshotFinished);
+    // Updates were dropped while we were behind; reload the tree.
+    connect(m_connectionManager->bridgeClient(), &BridgeClient::resyncRequired,
+            this, &MainWindow::onRefreshClicked);
     
     // Bridge client error handling
     connect(m_connectionManager->bridgeClient(), &BridgeClient::errorReceived, [this](const QJsonObject &msg) {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "qt_spy/protocol.h"
+
 #include <QMainWindow>
 
 QT_BEGIN_NAMESPACE
@@ -33,11 +35,15 @@ private slots:
     void onRefreshClicked();
     void onConnectionStateChanged();
     void onStatusChanged(const QString &status);
-    void onAttached(const QString &applicationName, qint64 pid);
+    void onAttached(const QString &applicationName, qint64 pid, bool resumed);
+    void onInterrupted();
     void onDetached();
     void onConnectionError(const QString &error);
-    void onNodeSelected(const QString &nodeId);
+    void onNodeSelected(qt_spy::NodeId nodeId);
     void onSnapshotReceived(const QJsonObject &snapshot);
+    void onSnapshotBegun(const QJsonObject &message);
+    void onSnapshotChunkReceived(const QJsonObject &message);
+    void onSnapshotFinished(const QJsonObject &message);
     
 private:
     void setupUi();
@@ -61,6 +67,9 @@ private:
     QLabel *m_statusLabel;
     QLabel *m_connectionLabel;
     
+    // Node whose property changes the probe currently pushes to us
+    NodeId m_subscribedNodeId = protocol::kInvalidNodeId;
+    
     // Actions
     QAction *m_attachAction;
     QAction *m_detachAction;
@@ -10,8 +10,8 @@ namespace qt_spy {
 
 NodeData NodeData::fromJson(const QJsonObject &json) {
     NodeData node;
-    node.id = json.value(QLatin1String(protocol::keys::kId)).toString();
-    node.parentId = json.value(QLatin1String(protocol::keys::kParentId)).toString();
+    node.id = protocol::nodeIdFromJson(json.value(QLatin1String(protocol::keys::kId)));
+    node.parentId = protocol::nodeIdFromJson(json.value(QLatin1String(protocol::keys::kParentId)));
     
     // Extract className and objectName - try multiple sources
     // 1. First try directly from the json object (snapshot format)
@@ -47,13 +47,25 @@ NodeData NodeData::fromJson(const QJsonObject &json) {
     const QJsonArray childArray = json.value(QLatin1String(protocol::keys::kChildIds)).toArray();
     node.childIds.reserve(childArray.size());
     for (const QJsonValue &childValue : childArray) {
-        node.childIds.append(childValue.toString());
+        node.childIds.append(protocol::nodeIdFromJson(childValue));
     }
     node.childrenLoaded = !node.childIds.isEmpty() || json.contains(QLatin1String(protocol::keys::kChildIds));
     
     return node;
 }
 
+NodeData NodeData::fromReplica(const ReplicaNode &replicaNode) {
+    NodeData node;
+    node.id = replicaNode.id;
+    node.parentId = replicaNode.parentId;
+    node.className = replicaNode.className;
+    node.objectName = replicaNode.objectName;
+    node.properties = replicaNode.properties;
+    node.childIds = replicaNode.childIds;
+    node.childrenLoaded = !node.childIds.isEmpty();
+    return node;
+}
+
 QString PropertyInfo::formatValue(const QVariant &value, const QString &type) {
     Q_UNUSED(type)
     
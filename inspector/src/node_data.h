@@ -1,5 +1,8 @@
 #pragma once
 
+#include "qt_spy/object_replica.h"
+#include "qt_spy/protocol.h"
+
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QString>
@@ -25,12 +28,12 @@ struct QtProcessInfo {
 };
 
 struct NodeData {
-    QString id;
-    QString parentId;
+    NodeId id = protocol::kInvalidNodeId;
+    NodeId parentId = protocol::kInvalidNodeId;
     QString className;
     QString objectName;
     QJsonObject properties;
-    QVector<QString> childIds;
+    QVector<NodeId> childIds;
     bool childrenLoaded = false;
     
     QString displayName() const {
@@ -41,6 +44,7 @@ struct NodeData {
     }
     
     static NodeData fromJson(const QJsonObject &json);
+    static NodeData fromReplica(const ReplicaNode &replicaNode);
 };
 
 struct PropertyInfo {
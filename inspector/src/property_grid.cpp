@@ -27,7 +27,7 @@ void PropertyTableModel::setProperties(const QJsonObject &properties) {
     endResetModel();
 }
 
-void PropertyTableModel::setNodeInfo(const QString &nodeId, const QString &className, const QString &objectName) {
+void PropertyTableModel::setNodeInfo(NodeId nodeId, const QString &className, const QString &objectName) {
     m_nodeId = nodeId;
     m_className = className;
     m_objectName = objectName;
@@ -36,7 +36,7 @@ void PropertyTableModel::setNodeInfo(const QString &nodeId, const QString &class
 void PropertyTableModel::clear() {
     beginResetModel();
     m_properties.clear();
-    m_nodeId.clear();
+    m_nodeId = protocol::kInvalidNodeId;
     m_className.clear();
     m_objectName.clear();
     endResetModel();
@@ -189,12 +189,12 @@ void PropertyTableView::setBridgeClient(BridgeClient *bridge) {
     }
 }
 
-void PropertyTableView::setCurrentNodeId(const QString &nodeId) {
+void PropertyTableView::setCurrentNodeId(NodeId nodeId) {
     m_currentNodeId = nodeId;
 }
 
 void PropertyTableView::refreshProperties() {
-    if (!m_currentNodeId.isEmpty()) {
+    if (m_currentNodeId != protocol::kInvalidNodeId) {
         emit nodePropertiesRequested(m_currentNodeId);
     }
 }
@@ -227,7 +227,7 @@ void PropertyTableView::contextMenuEvent(QContextMenuEvent *event) {
 }
 
 void PropertyTableView::onPropertiesReceived(const QJsonObject &message) {
-    const QString nodeId = message.value(QLatin1String(protocol::keys::kId)).toString();
+    const NodeId nodeId = protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId)));
     
     if (nodeId != m_currentNodeId) {
         return; // Not for the currently selected node
@@ -325,7 +325,7 @@ void PropertyGridWidget::setBridgeClient(BridgeClient *bridge) {
     
     // Connect property requests to bridge
     connect(m_view, &PropertyTableView::nodePropertiesRequested,
-            [bridge](const QString &nodeId) {
+            [bridge](NodeId nodeId) {
                 if (bridge) {
                     const QString requestId = QString("prop_req_%1").arg(QDateTime::currentMSecsSinceEpoch());
                     bridge->requestProperties(nodeId, requestId);
@@ -333,14 +333,14 @@ void PropertyGridWidget::setBridgeClient(BridgeClient *bridge) {
             });
 }
 
-void PropertyGridWidget::showNodeProperties(const QString &nodeId) {
+void PropertyGridWidget::showNodeProperties(NodeId nodeId) {
     m_view->setCurrentNodeId(nodeId);
     m_view->refreshProperties();
 }
 
 void PropertyGridWidget::clearProperties() {
     m_model->clear();
-    m_view->setCurrentNodeId(QString());
+    m_view->setCurrentNodeId(protocol::kInvalidNodeId);
 }
 
 void PropertyGridWidget::setupUi() {
@@ -23,7 +23,7 @@ public:
     explicit PropertyTableModel(QObject *parent = nullptr);
     
     void setProperties(const QJsonObject &properties);
-    void setNodeInfo(const QString &nodeId, const QString &className, const QString &objectName);
+    void setNodeInfo(NodeId nodeId, const QString &className, const QString &objectName);
     void clear();
     
     PropertyInfo propertyAt(int row) const;
@@ -37,7 +37,7 @@ public:
 private:
     void parseProperties(const QJsonObject &properties);
     
-    QString m_nodeId;
+    NodeId m_nodeId = protocol::kInvalidNodeId;
     QString m_className;
     QString m_objectName;
     QVector<PropertyInfo> m_properties;
@@ -50,7 +50,7 @@ public:
     explicit PropertyTableView(QWidget *parent = nullptr);
     
     void setBridgeClient(BridgeClient *bridge);
-    void setCurrentNodeId(const QString &nodeId);
+    void setCurrentNodeId(qt_spy::NodeId nodeId);
     
 public slots:
     void refreshProperties();
@@ -59,7 +59,7 @@ public slots:
     void copyAllProperties();
     
 signals:
-    void nodePropertiesRequested(const QString &nodeId);
+    void nodePropertiesRequested(qt_spy::NodeId nodeId);
     
 protected:
     void contextMenuEvent(QContextMenuEvent *event) override;
@@ -74,7 +74,7 @@ private:
     QString allPropertiesText() const;
     
     BridgeClient *m_bridge;
-    QString m_currentNodeId;
+    NodeId m_currentNodeId = protocol::kInvalidNodeId;
     QMenu *m_contextMenu;
 };
 
@@ -89,7 +89,7 @@ public:
     PropertyTableView *view() const { return m_view; }
     
 public slots:
-    void showNodeProperties(const QString &nodeId);
+    void showNodeProperties(qt_spy::NodeId nodeId);
     void clearProperties();
     
 private:
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <array>
 #include <functional>
 #include <memory>
 
+#include <QHash>
 #include <QObject>
 #include <QLocalServer>
 #include <QString>
@@ -18,6 +20,111 @@ namespace qt_spy {
 struct ProbeOptions {
     QString serverName;           // optional override for server name
     bool autoStart = true;        // start listening immediately when constructed
+    // Per-client outbound queue, counting queued events only; replies and
+    // snapshots are always delivered. Past the high-water mark queued
+    // propertiesChanged updates are merged; past the limit pending updates are
+    // dropped and the client is sent resyncRequired.
+    qint64 sendQueueHighWater = 1024 * 1024;
+    qint64 sendQueueLimit = 8 * 1024 * 1024;
+    // Encode snapshot replies on a probe-owned thread; the GUI thread only
+    // reads the objects.
+    bool offThreadEncoding = true;
+    // Track only the roots on attach and instrument deeper objects once a
+    // snapshot reports them, so attaching costs the same for any tree size.
+    // Nodes whose children are not tracked yet carry childCount instead of
+    // childIds in nodeAdded.
+    bool lazyAttach = false;
+    // Serialize properties through the per-class layout cache and its scalar
+    // converters; off reads every property through the QMetaObject and
+    // QJsonValue::fromVariant(), which only benchmarks want.
+    bool propertyLayoutCache = true;
+    // Rate limit for subscriptions that do not set maxRateHz; 0 = unlimited.
+    double maxNotifyRateHz = 0.0;
+    // Walk the tree for a snapshot in slices of at most this many ms of GUI
+    // thread time, one per event-loop pass; 0 walks it in one go.
+    int snapshotTimeBudgetMs = 0;
+    // Compress frames of at least this many bytes for clients that offer it;
+    // 0 never compresses.
+    int compressFramesAbove = 16 * 1024;
+    // Recent events kept for clients that reconnect with resumeFrom; a client
+    // that missed more than this gets a fresh snapshot instead. 0 disables
+    // resuming.
+    int eventJournalSize = 4096;
+    // How long a client whose connection dropped without a detach can come
+    // back and resume, with tracking kept alive for it meanwhile; 0 disables
+    // resuming and tears tracking down once the last client is gone.
+    int resumeWindowMs = 0;
+};
+
+// Durations in power-of-two buckets: bucket 0 holds samples under 1 us, bucket
+// i those from 2^(i + 9) ns up to twice that, and the last one everything
+// longer.
+struct LatencyHistogram {
+    static constexpr int kBucketCount = 24;
+
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    std::array<quint64, kBucketCount> buckets{};
+
+    void record(qint64 ns);
+    void merge(const LatencyHistogram &other);
+    // Upper bound of the bucket holding the given fraction of the samples.
+    qint64 percentileNs(double fraction) const;
+    static qint64 bucketUpperNs(int bucket);
+};
+
+struct MessageTraffic {
+    quint64 frames = 0;
+    qint64 bytes = 0;
+};
+
+// Property subscriptions held by one attached connection.
+struct ConnectionStats {
+    QString clientName;
+    QVector<quint64> subscribedIds;  // node ids, ascending
+    int subscribedPropertyNames = 0; // names over the nodes subscribed by name
+    int allPropertiesNodes = 0;      // nodes subscribed to every property
+};
+
+// Bookkeeping counters of the probe's object registry, which is shared by all
+// attached connections, plus outbound queue counters summed over connections
+// and the slowest connection's latest snapshot timings.
+struct ProbeStats {
+    quint64 refreshCount = 0;        // discovery passes run since attach
+    int lastRefreshVisited = 0;      // objects visited by the most recent pass
+    quint64 totalRefreshVisited = 0; // objects visited by all passes
+    int trackedObjects = 0;          // objects currently tracked
+    int notifyConnections = 0;       // property notify signals connected
+    int propertySubscriptions = 0;   // (connection, node) property subscriptions
+    qint64 objectTableBytes = 0;     // memory held by the per-object table
+    int bytesPerTrackedObject = 0;   // objectTableBytes / trackedObjects
+    qint64 queuedBytes = 0;          // bytes waiting in outbound queues
+    int queuedFrames = 0;            // frames waiting in outbound queues
+    quint64 coalescedChanges = 0;    // propertiesChanged entries merged while queued
+    quint64 rateLimitedChanges = 0;  // notifications folded into a rate-limited delivery
+    quint64 droppedFrames = 0;       // updates dropped for clients that fell behind
+    quint64 resyncCount = 0;         // resyncRequired messages sent
+    qint64 lastSnapshotCaptureNs = 0; // GUI-thread time of the latest snapshot
+    qint64 lastSnapshotEncodeNs = 0;  // time spent encoding it into frames
+    int lastSnapshotSlices = 0;       // event-loop passes its walk took
+    int connections = 0;              // attached client connections
+    quint64 compressedFrames = 0;      // frames sent compressed
+    qint64 compressionInputBytes = 0;  // their payloads before compression
+    qint64 compressionOutputBytes = 0; // and after
+    qint64 compressionNs = 0;          // time spent compressing, on any thread
+
+    // Where the probe spends the host's time. Installing counts each
+    // outermost call, the event filter the one on tracked objects.
+    LatencyHistogram snapshotCaptureLatency; // GUI-thread walk of each snapshot
+    LatencyHistogram snapshotEncodeLatency;  // encoding each snapshot into frames
+    LatencyHistogram propertiesLatency;      // serializing properties of one object
+    LatencyHistogram installLatency;         // instrumenting objects
+    LatencyHistogram eventFilterLatency;     // handling one event of a tracked object
+    // Frames and bytes written to the attached connections, by message type.
+    QHash<QString, MessageTraffic> sentByType;
+    // One entry per attached connection, in attach order.
+    QVector<ConnectionStats> perConnection;
 };
 
 class Probe : public QObject {
@@ -27,6 +134,7 @@ public:
 
     QString serverName() const;
     bool isListening() const;
+    ProbeStats stats() const;
 
 public slots:
     void start();
@@ -39,7 +147,13 @@ private:
 
     QString m_serverName;
     bool m_autoStart = true;
+    qint64 m_sendQueueHighWater = 0;
+    qint64 m_sendQueueLimit = 0;
+    int m_snapshotTimeBudgetMs = 0;
+    int m_compressFramesAbove = 0;
     std::unique_ptr<QLocalServer> m_server;
+    class ObjectRegistry *m_registry = nullptr;
+    class SnapshotEncoder *m_encoder = nullptr;
     QVector<class ProbeConnection *> m_connections;
 };
 
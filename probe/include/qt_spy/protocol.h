@@ -1,11 +1,49 @@
 #pragma once
 
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QString>
 #include <QtGlobal>
 
 namespace qt_spy {
+
+// Node ids come from a probe-wide counter starting at 1 and are never reused
+// while the probe lives, so a recycled object address cannot alias a dead
+// node. 0 means "no node".
+using NodeId = quint64;
+
 namespace protocol {
 
-inline constexpr int kVersion = 1;
+// 2: node ids are JSON numbers instead of "node_<address>" strings.
+// 3: propertiesChanged is only sent for nodes the client subscribed to.
+// 4: events carry seq; hello carries session and resumed; attach may resume.
+inline constexpr int kVersion = 4;
+
+inline constexpr NodeId kInvalidNodeId = 0;
+// Largest id that survives a round trip through a JSON number.
+inline constexpr NodeId kMaxNodeId = (NodeId(1) << 53);
+
+inline QJsonValue nodeIdToJson(NodeId id)
+{
+    return QJsonValue(static_cast<qint64>(id));
+}
+
+inline NodeId nodeIdFromJson(const QJsonValue &value)
+{
+    if (!value.isDouble()) {
+        return kInvalidNodeId;
+    }
+    const double number = value.toDouble();
+    if (!(number >= 1.0 && number <= static_cast<double>(kMaxNodeId))) {
+        return kInvalidNodeId;
+    }
+    const NodeId id = static_cast<NodeId>(number);
+    return static_cast<double>(id) == number ? id : kInvalidNodeId;
+}
+
+// Nodes per snapshotChunk when a chunked snapshotRequest does not specify one.
+inline constexpr int kDefaultSnapshotChunkSize = 256;
+inline constexpr int kMaxSnapshotChunkSize = 65536;
 
 namespace keys {
 inline constexpr char kType[] = "type";
@@ -20,13 +58,62 @@ inline constexpr char kRootIds[] = "rootIds";
 inline constexpr char kChildIds[] = "childIds";
 inline constexpr char kProperties[] = "properties";
 inline constexpr char kChanged[] = "changed";
+inline constexpr char kChanges[] = "changes";
 inline constexpr char kSelection[] = "selection";
 inline constexpr char kServerName[] = "serverName";
 inline constexpr char kApplicationName[] = "applicationName";
 inline constexpr char kApplicationPid[] = "applicationPid";
 inline constexpr char kClientName[] = "clientName";
+inline constexpr char kEncodings[] = "encodings";
+inline constexpr char kEncoding[] = "encoding";
+inline constexpr char kChunked[] = "chunked";
+inline constexpr char kChunkSize[] = "chunkSize";
+inline constexpr char kChunkIndex[] = "chunkIndex";
+inline constexpr char kChunkCount[] = "chunkCount";
+inline constexpr char kNodeCount[] = "nodeCount";
+inline constexpr char kFields[] = "fields";
+inline constexpr char kPropertyNames[] = "propertyNames";
+inline constexpr char kDropped[] = "dropped";
+inline constexpr char kRootId[] = "rootId";
+inline constexpr char kMaxDepth[] = "maxDepth";
+inline constexpr char kChildCount[] = "childCount";
+inline constexpr char kIds[] = "ids";
+inline constexpr char kUnknownIds[] = "unknownIds";
+inline constexpr char kMaxRateHz[] = "maxRateHz";
+inline constexpr char kStats[] = "stats";
+// attach lists the frame compressions a client can inflate; hello names the
+// one the helper will use for large frames, if any.
+inline constexpr char kCompressions[] = "compressions";
+inline constexpr char kCompression[] = "compression";
+// nodeAdded, nodeRemoved and propertiesChanged carry a "seq" that grows by one
+// per event the helper emits; snapshot and snapshotBegin carry the seq of the
+// last event they already reflect. hello gives the client a "session". After
+// its connection drops, an attach with that "session" and "resumeFrom", the
+// last seq the client applied, is answered with "resumed": true followed by
+// the events it missed, as long as the helper still holds all of them. The
+// client keeps its subscriptions, and the missed propertiesChanged are
+// narrowed to them. Otherwise "resumed" is false, the session is a new one
+// and the client needs a fresh snapshot.
+inline constexpr char kSeq[] = "seq";
+inline constexpr char kSession[] = "session";
+inline constexpr char kResumeFrom[] = "resumeFrom";
+inline constexpr char kResumed[] = "resumed";
 } // namespace keys
 
+// Tokens accepted in the "fields" mask of snapshotRequest/propertiesRequest.
+// A "-" prefix removes a group, so ["all", "-dynamic"] drops dynamic
+// properties only. A list that starts with a removal starts from everything,
+// so ["-dynamic"] means the same. Identity and hierarchy (id, parentId, className,
+// objectName, address, childIds) are always sent, except that a node at the
+// maxDepth of a snapshotRequest carries childCount instead of childIds.
+namespace fields {
+inline constexpr char kAll[] = "all";
+inline constexpr char kStructure[] = "structure";
+inline constexpr char kGeometry[] = "geometry";
+inline constexpr char kProperties[] = "properties";
+inline constexpr char kDynamic[] = "dynamic";
+} // namespace fields
+
 namespace types {
 inline constexpr char kAttach[] = "attach";
 inline constexpr char kDetach[] = "detach";
@@ -34,6 +121,9 @@ inline constexpr char kHello[] = "hello";
 inline constexpr char kGoodbye[] = "goodbye";
 inline constexpr char kSnapshotRequest[] = "snapshotRequest";
 inline constexpr char kSnapshot[] = "snapshot";
+inline constexpr char kSnapshotBegin[] = "snapshotBegin";
+inline constexpr char kSnapshotChunk[] = "snapshotChunk";
+inline constexpr char kSnapshotEnd[] = "snapshotEnd";
 inline constexpr char kPropertiesRequest[] = "propertiesRequest";
 inline constexpr char kProperties[] = "properties";
 inline constexpr char kSelectNode[] = "selectNode";
@@ -41,8 +131,153 @@ inline constexpr char kSelectionAck[] = "selectionAck";
 inline constexpr char kNodeAdded[] = "nodeAdded";
 inline constexpr char kNodeRemoved[] = "nodeRemoved";
 inline constexpr char kPropertiesChanged[] = "propertiesChanged";
+// subscribe/unsubscribe carry "ids" and, for subscribe, optional
+// "propertyNames" and "maxRateHz" (0 = unlimited); both are answered with
+// subscriptionAck. A rate-limited property is sent at once, then at most
+// maxRateHz times per second with the latest value at the end of each window.
+inline constexpr char kSubscribe[] = "subscribe";
+inline constexpr char kUnsubscribe[] = "unsubscribe";
+inline constexpr char kSubscriptionAck[] = "subscriptionAck";
+// Sent instead of further updates once a client has fallen too far behind;
+// the client should request a fresh snapshot, which resumes the updates.
+inline constexpr char kResyncRequired[] = "resyncRequired";
+// statsRequest is answered with stats, whose "stats" object holds the probe's
+// counters, latency histograms, per-type traffic and, under "perConnection",
+// what each attached client is subscribed to.
+inline constexpr char kStatsRequest[] = "statsRequest";
+inline constexpr char kStats[] = "stats";
+// An error raised while handling a request carries the request's requestId.
 inline constexpr char kError[] = "error";
 } // namespace types
 
+// Message types as a dense enum, so dispatchers can switch instead of running a
+// chain of string comparisons. Unknown stands for any name this build does not
+// know.
+enum class MessageType : quint8 {
+    Unknown,
+    Attach,
+    Detach,
+    Hello,
+    Goodbye,
+    SnapshotRequest,
+    Snapshot,
+    SnapshotBegin,
+    SnapshotChunk,
+    SnapshotEnd,
+    PropertiesRequest,
+    Properties,
+    SelectNode,
+    SelectionAck,
+    NodeAdded,
+    NodeRemoved,
+    PropertiesChanged,
+    Subscribe,
+    Unsubscribe,
+    SubscriptionAck,
+    ResyncRequired,
+    StatsRequest,
+    Stats,
+    Error,
+};
+
+inline constexpr int kMessageTypeCount = static_cast<int>(MessageType::Error) + 1;
+
+// Wire names, indexed by MessageType.
+inline constexpr const char *kMessageTypeNames[kMessageTypeCount] = {
+    "",
+    types::kAttach,
+    types::kDetach,
+    types::kHello,
+    types::kGoodbye,
+    types::kSnapshotRequest,
+    types::kSnapshot,
+    types::kSnapshotBegin,
+    types::kSnapshotChunk,
+    types::kSnapshotEnd,
+    types::kPropertiesRequest,
+    types::kProperties,
+    types::kSelectNode,
+    types::kSelectionAck,
+    types::kNodeAdded,
+    types::kNodeRemoved,
+    types::kPropertiesChanged,
+    types::kSubscribe,
+    types::kUnsubscribe,
+    types::kSubscriptionAck,
+    types::kResyncRequired,
+    types::kStatsRequest,
+    types::kStats,
+    types::kError,
+};
+
+namespace detail {
+
+inline constexpr unsigned kMessageTypeTableSize = 64;
+
+// Length, first and last character are enough to tell every type name apart;
+// the table below is checked at compile time, so a new name that collides
+// means picking new multipliers here.
+constexpr unsigned messageTypeHash(int length, unsigned first, unsigned last)
+{
+    return (2u * static_cast<unsigned>(length) + 17u * first + last)
+           & (kMessageTypeTableSize - 1);
+}
+
+constexpr int nameLength(const char *name)
+{
+    int length = 0;
+    while (name[length] != '\0') {
+        ++length;
+    }
+    return length;
+}
+
+struct MessageTypeTable {
+    quint8 entries[kMessageTypeTableSize] = {};
+    bool perfect = true;
+};
+
+constexpr MessageTypeTable buildMessageTypeTable()
+{
+    MessageTypeTable table;
+    for (int i = 1; i < kMessageTypeCount; ++i) {
+        const char *name = kMessageTypeNames[i];
+        const int length = nameLength(name);
+        const unsigned slot = messageTypeHash(length, static_cast<unsigned char>(name[0]),
+                                              static_cast<unsigned char>(name[length - 1]));
+        if (table.entries[slot] != 0) {
+            table.perfect = false;
+        }
+        table.entries[slot] = static_cast<quint8>(i);
+    }
+    return table;
+}
+
+inline constexpr MessageTypeTable kMessageTypeTable = buildMessageTypeTable();
+static_assert(kMessageTypeTable.perfect, "message type names collide in messageTypeHash()");
+
+} // namespace detail
+
+// One table probe and one string comparison to confirm the match.
+inline MessageType messageTypeFromName(const QString &name)
+{
+    const int length = name.size();
+    if (length == 0) {
+        return MessageType::Unknown;
+    }
+    const unsigned slot = detail::messageTypeHash(length, name.at(0).unicode(),
+                                                  name.at(length - 1).unicode());
+    const quint8 index = detail::kMessageTypeTable.entries[slot];
+    if (index == 0 || name != QLatin1String(kMessageTypeNames[index])) {
+        return MessageType::Unknown;
+    }
+    return static_cast<MessageType>(index);
+}
+
+inline QLatin1String messageTypeName(MessageType type)
+{
+    return QLatin1String(kMessageTypeNames[static_cast<int>(type)]);
+}
+
 } // namespace protocol
 } // namespace qt_spy
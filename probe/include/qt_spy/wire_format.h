@@ -0,0 +1,404 @@
+#pragma once
+
+#include "qt_spy/protocol.h"
+
+#include <QByteArray>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QString>
+#include <QtEndian>
+
+#include <cmath>
+
+// Payload encodings shared by the probe and the bridge client. Every frame is a
+// 4-byte big-endian length followed by either compact JSON text or a CBOR map.
+// The two are told apart by the first payload byte, so a decoder accepts both
+// regardless of what was negotiated; the negotiation only decides what a peer
+// sends. The top bit of the length marks a payload compressed with qCompress,
+// which a peer only sends after the other side offered it at attach.
+namespace qt_spy {
+namespace protocol {
+
+enum class Encoding {
+    Json,
+    Cbor,
+};
+
+namespace encodings {
+inline constexpr char kJson[] = "json";
+inline constexpr char kCbor[] = "cbor";
+} // namespace encodings
+
+namespace compressions {
+inline constexpr char kZlib[] = "zlib";
+} // namespace compressions
+
+inline constexpr quint32 kCompressedFrameFlag = 0x80000000u;
+inline constexpr quint32 kFrameLengthMask = 0x7fffffffu;
+// Fast rather than small: frames are compressed on the way out of the host.
+inline constexpr int kFrameCompressionLevel = 1;
+// Refuse to inflate a frame claiming to be larger than this.
+inline constexpr quint32 kMaxInflatedFrameSize = 256u * 1024u * 1024u;
+
+inline QString encodingName(Encoding encoding)
+{
+    return encoding == Encoding::Cbor ? QLatin1String(encodings::kCbor)
+                                      : QLatin1String(encodings::kJson);
+}
+
+inline bool encodingFromName(const QString &name, Encoding *encoding)
+{
+    if (name == QLatin1String(encodings::kJson)) {
+        *encoding = Encoding::Json;
+        return true;
+    }
+    if (name == QLatin1String(encodings::kCbor)) {
+        *encoding = Encoding::Cbor;
+        return true;
+    }
+    return false;
+}
+
+// A CBOR map starts with major type 5 (0xa0..0xbf); JSON text never does.
+inline Encoding detectEncoding(const QByteArray &payload)
+{
+    if (!payload.isEmpty() && (static_cast<uchar>(payload.at(0)) & 0xe0) == 0xa0) {
+        return Encoding::Cbor;
+    }
+    return Encoding::Json;
+}
+
+namespace detail {
+
+inline constexpr int kMaxCborDepth = 512;
+
+inline void writeCborValue(QCborStreamWriter &writer, const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        writer.append(value.toBool());
+        break;
+    case QJsonValue::Double: {
+        // JSON has no integer type; integral values go out as CBOR integers,
+        // which are both shorter and cheaper to decode.
+        const double number = value.toDouble();
+        if (std::isfinite(number) && std::floor(number) == number
+            && std::fabs(number) < 9007199254740992.0) {
+            writer.append(static_cast<qint64>(number));
+        } else {
+            writer.append(number);
+        }
+        break;
+    }
+    case QJsonValue::String:
+        writer.append(value.toString());
+        break;
+    case QJsonValue::Array: {
+        const QJsonArray array = value.toArray();
+        writer.startArray(static_cast<quint64>(array.size()));
+        for (const QJsonValue &element : array) {
+            writeCborValue(writer, element);
+        }
+        writer.endArray();
+        break;
+    }
+    case QJsonValue::Object: {
+        const QJsonObject object = value.toObject();
+        writer.startMap(static_cast<quint64>(object.size()));
+        for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+            writer.append(it.key());
+            writeCborValue(writer, it.value());
+        }
+        writer.endMap();
+        break;
+    }
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+    default:
+        writer.appendNull();
+        break;
+    }
+}
+
+inline bool readCborString(QCborStreamReader &reader, QString *out)
+{
+    out->clear();
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        out->append(chunk.data);
+        chunk = reader.readString();
+    }
+    return chunk.status == QCborStreamReader::EndOfString;
+}
+
+inline bool readCborValue(QCborStreamReader &reader, QJsonValue *out, int depth)
+{
+    if (depth > kMaxCborDepth) {
+        return false;
+    }
+
+    switch (reader.type()) {
+    case QCborStreamReader::UnsignedInteger:
+    case QCborStreamReader::NegativeInteger:
+        *out = QJsonValue(reader.toInteger());
+        return reader.next();
+    case QCborStreamReader::Float16:
+        *out = QJsonValue(static_cast<double>(reader.toFloat16()));
+        return reader.next();
+    case QCborStreamReader::Float:
+        *out = QJsonValue(static_cast<double>(reader.toFloat()));
+        return reader.next();
+    case QCborStreamReader::Double:
+        *out = QJsonValue(reader.toDouble());
+        return reader.next();
+    case QCborStreamReader::TextString: {
+        QString text;
+        if (!readCborString(reader, &text)) {
+            return false;
+        }
+        *out = QJsonValue(text);
+        return true;
+    }
+    case QCborStreamReader::SimpleType:
+        if (reader.isBool()) {
+            *out = QJsonValue(reader.toBool());
+        } else {
+            *out = QJsonValue();
+        }
+        return reader.next();
+    case QCborStreamReader::Array: {
+        if (!reader.enterContainer()) {
+            return false;
+        }
+        QJsonArray array;
+        while (reader.hasNext()) {
+            QJsonValue element;
+            if (!readCborValue(reader, &element, depth + 1)) {
+                return false;
+            }
+            array.append(element);
+        }
+        if (!reader.leaveContainer()) {
+            return false;
+        }
+        *out = array;
+        return true;
+    }
+    case QCborStreamReader::Map: {
+        if (!reader.enterContainer()) {
+            return false;
+        }
+        QJsonObject object;
+        while (reader.hasNext()) {
+            if (!reader.isString()) {
+                return false;
+            }
+            QString key;
+            if (!readCborString(reader, &key)) {
+                return false;
+            }
+            QJsonValue element;
+            if (!readCborValue(reader, &element, depth + 1)) {
+                return false;
+            }
+            object.insert(key, element);
+        }
+        if (!reader.leaveContainer()) {
+            return false;
+        }
+        *out = object;
+        return true;
+    }
+    default:
+        // Byte strings and tags are never produced by qt-spy peers.
+        return false;
+    }
+}
+
+} // namespace detail
+
+inline QByteArray encodePayload(const QJsonObject &message, Encoding encoding)
+{
+    if (encoding == Encoding::Json) {
+        return QJsonDocument(message).toJson(QJsonDocument::Compact);
+    }
+
+    QByteArray payload;
+    QCborStreamWriter writer(&payload);
+    detail::writeCborValue(writer, message);
+    return payload;
+}
+
+inline bool decodePayload(const QByteArray &payload, QJsonObject *message, QString *errorString)
+{
+    if (detectEncoding(payload) == Encoding::Json) {
+        QJsonParseError parseError{};
+        const QJsonDocument document = QJsonDocument::fromJson(payload, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            if (errorString) {
+                *errorString = parseError.error != QJsonParseError::NoError
+                                   ? parseError.errorString()
+                                   : QStringLiteral("payload is not a JSON object");
+            }
+            return false;
+        }
+        *message = document.object();
+        return true;
+    }
+
+    QCborStreamReader reader(payload);
+    QJsonValue value;
+    if (!detail::readCborValue(reader, &value, 0) || !value.isObject()) {
+        if (errorString) {
+            const QCborError error = reader.lastError();
+            *errorString = error == QCborError::NoError ? QStringLiteral("malformed CBOR message")
+                                                        : error.toString();
+        }
+        return false;
+    }
+    *message = value.toObject();
+    return true;
+}
+
+inline QByteArray frameFromPayload(const QByteArray &payload, bool compressed = false)
+{
+    QByteArray frame;
+    frame.reserve(payload.size() + 4);
+    frame.resize(4);
+    const quint32 header = static_cast<quint32>(payload.size())
+                           | (compressed ? kCompressedFrameFlag : 0u);
+    qToBigEndian(header, reinterpret_cast<uchar *>(frame.data()));
+    frame.append(payload);
+    return frame;
+}
+
+// Payloads of at least compressAbove bytes are compressed when that makes them
+// smaller; 0 never compresses.
+inline QByteArray encodeFrame(const QJsonObject &message, Encoding encoding, int compressAbove = 0)
+{
+    const QByteArray payload = encodePayload(message, encoding);
+    if (compressAbove > 0 && payload.size() >= compressAbove) {
+        const QByteArray compressed = qCompress(payload, kFrameCompressionLevel);
+        if (compressed.size() < payload.size()) {
+            return frameFromPayload(compressed, true);
+        }
+    }
+    return frameFromPayload(payload);
+}
+
+inline bool isCompressedFrame(quint32 header)
+{
+    return (header & kCompressedFrameFlag) != 0;
+}
+
+inline quint32 framePayloadLength(quint32 header)
+{
+    return header & kFrameLengthMask;
+}
+
+// Size a compressed payload will have once inflated; qCompress stores it up
+// front.
+inline quint32 inflatedPayloadSize(const QByteArray &compressed)
+{
+    if (compressed.size() < 4) {
+        return 0;
+    }
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(compressed.constData()));
+}
+
+inline bool inflatePayload(const QByteArray &compressed, QByteArray *payload, QString *errorString)
+{
+    const quint32 size = inflatedPayloadSize(compressed);
+    if (size == 0 || size > kMaxInflatedFrameSize) {
+        if (errorString) {
+            *errorString = QStringLiteral("compressed frame has an invalid size");
+        }
+        return false;
+    }
+    *payload = qUncompress(compressed);
+    if (payload->isEmpty()) {
+        if (errorString) {
+            *errorString = QStringLiteral("compressed frame is corrupt");
+        }
+        return false;
+    }
+    return true;
+}
+
+// Incremental parser over one receive buffer. Frames are parsed where they lie
+// and handed out as views instead of being cut off the front one at a time;
+// consumed bytes are only dropped when new data arrives and they make up at
+// least half the buffer, so a burst of small frames costs one short move of the
+// trailing partial frame rather than one move of the whole buffer per frame.
+class FrameReader {
+public:
+    // Appends what the device has buffered straight into the receive buffer.
+    void readFrom(QIODevice *device)
+    {
+        const qint64 available = device->bytesAvailable();
+        if (available <= 0) {
+            return;
+        }
+        compact();
+        const int oldSize = m_buffer.size();
+        m_buffer.resize(oldSize + static_cast<int>(available));
+        const qint64 read = device->read(m_buffer.data() + oldSize, available);
+        m_buffer.resize(oldSize + static_cast<int>(qMax<qint64>(read, 0)));
+    }
+
+    void append(const QByteArray &data)
+    {
+        compact();
+        m_buffer.append(data);
+    }
+
+    // Takes the next complete frame, or returns false while it is still
+    // arriving. The payload views the buffer and stays valid until the next
+    // readFrom(), append() or clear().
+    bool next(quint32 *header, QByteArray *payload)
+    {
+        const int unread = m_buffer.size() - m_readPos;
+        if (unread < 4) {
+            return false;
+        }
+        const char *frame = m_buffer.constData() + m_readPos;
+        const quint32 frameHeader = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(frame));
+        const quint32 length = framePayloadLength(frameHeader);
+        if (static_cast<quint32>(unread - 4) < length) {
+            return false;
+        }
+        *header = frameHeader;
+        *payload = QByteArray::fromRawData(frame + 4, static_cast<int>(length));
+        m_readPos += static_cast<int>(length) + 4;
+        return true;
+    }
+
+    void clear()
+    {
+        m_buffer.clear();
+        m_readPos = 0;
+    }
+
+    int bufferedBytes() const { return m_buffer.size() - m_readPos; }
+
+private:
+    void compact()
+    {
+        if (m_readPos > 0 && m_readPos >= m_buffer.size() - m_readPos) {
+            m_buffer.remove(0, m_readPos);
+            m_readPos = 0;
+        }
+    }
+
+    QByteArray m_buffer;
+    int m_readPos = 0;
+};
+
+} // namespace protocol
+} // namespace qt_spy
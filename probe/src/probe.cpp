@@ -1,13 +1,17 @@
 #include "qt_spy/probe.h"
 #include "qt_spy/protocol.h"
+#include "qt_spy/wire_format.h"
 
 #include <QApplication>
 #include <QByteArray>
 #include <QChildEvent>
 #include <QCoreApplication>
 #include <QDateTime>
+#include <QDeadlineTimer>
 #include <QDynamicPropertyChangeEvent>
+#include <QElapsedTimer>
 #include <QGuiApplication>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -18,21 +22,28 @@
 #include <QMetaMethod>
 #include <QMetaObject>
 #include <QMetaProperty>
+#include <QMetaType>
 #include <QPair>
 #include <QPointer>
+#include <QQueue>
 #include <QRect>
 #include <QRegularExpression>
+#include <QScopedValueRollback>
 #include <QSet>
+#include <QThread>
 #include <QTimer>
+#include <QUuid>
 #include <QVariant>
 #include <QWidget>
 #include <QWindow>
 
 #include <QFile>
 #include <QDebug>
-#include <QtEndian>
 #include <QtGlobal>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -40,14 +51,6 @@
 
 namespace {
 
-QString makeNodeId(const QObject *object)
-{
-    if (!object) {
-        return {};
-    }
-    return QStringLiteral("node_%1").arg(QString::number(quintptr(object), 16));
-}
-
 QJsonValue variantToJson(const QVariant &value)
 {
     if (!value.isValid()) {
@@ -61,6 +64,116 @@ QJsonValue variantToJson(const QVariant &value)
     return converted;
 }
 
+// How a readable property's value is turned into JSON. The scalar kinds skip the
+// generic QJsonValue::fromVariant() dispatch; everything else (enums, flags,
+// geometry types, user types) goes through variantToJson(). Types that
+// fromVariant() does not treat as numbers (short, long and the char types,
+// which it turns into strings) stay generic so the output does not change.
+enum class PropertyConverter {
+    Bool,
+    Int,
+    UInt,
+    LongLong,
+    Double,
+    String,
+    Generic,
+};
+
+struct PropertyEntry {
+    int index = -1;
+    QString key;
+    PropertyConverter converter = PropertyConverter::Generic;
+    int notifySignalIndex = -1;
+};
+
+// Readable properties of one QMetaObject, resolved once and shared by every
+// object of that class.
+struct PropertyLayout {
+    QVector<PropertyEntry> properties;
+    // Notify signal index -> properties it reports, in property order.
+    // Several properties can share one signal (e.g. geometry, pos and size).
+    QHash<int, QStringList> propertiesByNotifySignal;
+};
+
+PropertyConverter converterForProperty(const QMetaProperty &property)
+{
+    if (property.isEnumType() || property.isFlagType()) {
+        return PropertyConverter::Generic;
+    }
+
+    switch (property.userType()) {
+    case QMetaType::Bool:
+        return PropertyConverter::Bool;
+    case QMetaType::Int:
+        return PropertyConverter::Int;
+    case QMetaType::UInt:
+        return PropertyConverter::UInt;
+    case QMetaType::LongLong:
+        return PropertyConverter::LongLong;
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return PropertyConverter::Double;
+    case QMetaType::QString:
+        return PropertyConverter::String;
+    default:
+        return PropertyConverter::Generic;
+    }
+}
+
+// Probe-wide cache keyed by QMetaObject. Meta objects are static data that
+// outlive every instance, and the probe only touches them from the GUI thread.
+const PropertyLayout &propertyLayoutFor(const QMetaObject *meta)
+{
+    static QHash<const QMetaObject *, PropertyLayout> cache;
+
+    auto it = cache.constFind(meta);
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+
+    PropertyLayout layout;
+    const int count = meta->propertyCount();
+    layout.properties.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QMetaProperty property = meta->property(i);
+        if (!property.isReadable()) {
+            continue;
+        }
+        PropertyEntry entry;
+        entry.index = i;
+        entry.key = QString::fromLatin1(property.name());
+        entry.converter = converterForProperty(property);
+        entry.notifySignalIndex = property.hasNotifySignal() ? property.notifySignalIndex() : -1;
+        if (entry.notifySignalIndex >= 0) {
+            layout.propertiesByNotifySignal[entry.notifySignalIndex].append(entry.key);
+        }
+        layout.properties.append(entry);
+    }
+
+    return cache.insert(meta, layout).value();
+}
+
+QJsonValue convertProperty(const QVariant &value, PropertyConverter converter)
+{
+    switch (converter) {
+    case PropertyConverter::Bool:
+        return QJsonValue(value.toBool());
+    case PropertyConverter::Int:
+        return QJsonValue(value.toInt());
+    case PropertyConverter::UInt:
+        return QJsonValue(static_cast<qint64>(value.toUInt()));
+    case PropertyConverter::LongLong:
+        return QJsonValue(value.toLongLong());
+    case PropertyConverter::Double:
+        return QJsonValue(value.toDouble());
+    case PropertyConverter::String:
+        return QJsonValue(value.toString());
+    case PropertyConverter::Generic:
+        break;
+    }
+    return variantToJson(value);
+}
+
 QJsonObject geometryToJson(const QRect &rect)
 {
     QJsonObject geometry;
@@ -71,751 +184,2949 @@ QJsonObject geometryToJson(const QRect &rect)
     return geometry;
 }
 
-QJsonObject widgetInfo(const QWidget *widget)
-{
-    QJsonObject info;
-    info["visible"] = widget->isVisible();
-    info["enabled"] = widget->isEnabled();
-    info["windowTitle"] = widget->windowTitle();
-    info["geometry"] = geometryToJson(widget->geometry());
-    return info;
-}
+// What a node contributes to a snapshot or nodeAdded, read from the QObject on
+// the GUI thread. Turning it into JSON and encoding it touches no QObject, so
+// it can run on the probe's encoder thread.
+struct CapturedProperty {
+    QString key;
+    PropertyConverter converter = PropertyConverter::Generic;
+    QVariant value;  // scalar converters; converted later
+    QJsonValue json; // Generic: converted while the object is at hand
+};
+
+struct CapturedNode {
+    enum class Surface {
+        None,
+        Widget,
+        Window,
+    };
+
+    qt_spy::NodeId id = qt_spy::protocol::kInvalidNodeId;
+    qt_spy::NodeId parentId = qt_spy::protocol::kInvalidNodeId;
+    const char *className = nullptr; // static meta-object data
+    QString objectName;
+    quintptr address = 0;
+    QVector<qt_spy::NodeId> childIds;
+    int childCount = 0; // set instead of childIds when a depth limit cut the children off
+
+    Surface surface = Surface::None;
+    bool visible = false;
+    bool enabled = false;
+    QString title;
+    QRect geometry;
+
+    QVector<CapturedProperty> properties;
+    QVector<QPair<QString, QJsonValue>> dynamicProperties;
+};
 
-QJsonObject windowInfo(const QWindow *window)
+QJsonObject propertiesToJson(const CapturedNode &node)
 {
-    QJsonObject info;
-    info["visible"] = window->isVisible();
-    info["title"] = window->title();
-    info["geometry"] = geometryToJson(window->geometry());
-    return info;
+    QJsonObject properties;
+    for (const CapturedProperty &property : node.properties) {
+        properties.insert(property.key,
+                          property.converter == PropertyConverter::Generic
+                              ? property.json
+                              : convertProperty(property.value, property.converter));
+    }
+
+    if (!node.dynamicProperties.isEmpty()) {
+        QJsonObject dynamicProps;
+        for (const auto &property : node.dynamicProperties) {
+            dynamicProps[property.first] = property.second;
+        }
+        properties[QStringLiteral("__dynamic")] = dynamicProps;
+    }
+
+    return properties;
 }
 
-QString sanitizeProcessName(const QString &name)
+QJsonObject nodeToJson(const CapturedNode &node)
 {
-    QString sanitized = name;
-    sanitized.replace(QRegularExpression(QStringLiteral("[^A-Za-z0-9_]")), QStringLiteral("_"));
-    sanitized.replace(QRegularExpression(QStringLiteral("_+")), QStringLiteral("_"));
-    return sanitized.trimmed();
-}
+    QJsonObject json;
+    json[QLatin1String(qt_spy::protocol::keys::kId)] = qt_spy::protocol::nodeIdToJson(node.id);
+    if (node.parentId != qt_spy::protocol::kInvalidNodeId) {
+        json[QLatin1String(qt_spy::protocol::keys::kParentId)] =
+            qt_spy::protocol::nodeIdToJson(node.parentId);
+    }
+    json[QStringLiteral("className")] = QString::fromLatin1(node.className);
+    json[QStringLiteral("objectName")] = node.objectName;
+    json[QStringLiteral("address")] =
+        QStringLiteral("0x%1").arg(node.address, 0, 16, QLatin1Char('0'));
+
+    if (!node.childIds.isEmpty()) {
+        QJsonArray childrenIds;
+        for (const qt_spy::NodeId childId : node.childIds) {
+            childrenIds.append(qt_spy::protocol::nodeIdToJson(childId));
+        }
+        json[QLatin1String(qt_spy::protocol::keys::kChildIds)] = childrenIds;
+    }
+    if (node.childCount > 0) {
+        json[QLatin1String(qt_spy::protocol::keys::kChildCount)] = node.childCount;
+    }
 
-} // namespace
+    if (node.surface == CapturedNode::Surface::Widget) {
+        QJsonObject info;
+        info["visible"] = node.visible;
+        info["enabled"] = node.enabled;
+        info["windowTitle"] = node.title;
+        info["geometry"] = geometryToJson(node.geometry);
+        json[QStringLiteral("widget")] = info;
+    } else if (node.surface == CapturedNode::Surface::Window) {
+        QJsonObject info;
+        info["visible"] = node.visible;
+        info["title"] = node.title;
+        info["geometry"] = geometryToJson(node.geometry);
+        json[QStringLiteral("window")] = info;
+    }
 
-namespace qt_spy {
+    const QJsonObject properties = propertiesToJson(node);
+    if (!properties.isEmpty()) {
+        json[QLatin1String(qt_spy::protocol::keys::kProperties)] = properties;
+    }
 
-class ProbeConnection : public QObject {
-    Q_OBJECT
-public:
-    ProbeConnection(QLocalSocket *socket, Probe *probe);
-    ~ProbeConnection() override;
+    return json;
+}
 
-    void close();
+// Frames the probe compressed, counted from the GUI thread and the encoder
+// thread alike.
+struct CompressionMeter {
+    std::atomic<quint64> frames{0};
+    std::atomic<qint64> inputBytes{0};
+    std::atomic<qint64> outputBytes{0};
+    std::atomic<qint64> totalNs{0};
+};
 
-signals:
-    void closed(ProbeConnection *connection);
+// protocol::encodeFrame, metering the compression.
+QByteArray encodeOutgoingFrame(const QJsonObject &message, qt_spy::protocol::Encoding encoding,
+                               int compressAbove, CompressionMeter *meter)
+{
+    namespace protocol = qt_spy::protocol;
 
-protected:
-    bool eventFilter(QObject *watched, QEvent *event) override;
+    const QByteArray payload = protocol::encodePayload(message, encoding);
+    if (compressAbove <= 0 || payload.size() < compressAbove) {
+        return protocol::frameFromPayload(payload);
+    }
 
-private slots:
-    void onReadyRead();
-    void onDisconnected();
-    void handlePropertyNotify();
-    void onObjectDestroyed(QObject *object);
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray compressed = qCompress(payload, protocol::kFrameCompressionLevel);
+    if (meter) {
+        meter->totalNs += timer.nsecsElapsed();
+    }
+    if (compressed.size() >= payload.size()) {
+        return protocol::frameFromPayload(payload);
+    }
+    if (meter) {
+        ++meter->frames;
+        meter->inputBytes += payload.size();
+        meter->outputBytes += compressed.size();
+    }
+    return protocol::frameFromPayload(compressed, true);
+}
 
-private:
-    void processBuffer();
-    void handleMessage(const QJsonObject &message);
-    void handleAttach(const QJsonObject &message);
-    void handleDetach(const QJsonObject &message);
-    void handleSnapshotRequest(const QJsonObject &message);
-    void handlePropertiesRequest(const QJsonObject &message);
-    void handleSelectNode(const QJsonObject &message);
+// A whole snapshot reply as captured on the GUI thread, nodes in pre-order.
+struct SnapshotCapture {
+    QVector<CapturedNode> nodes;
+    QVector<qt_spy::NodeId> rootIds;
+    qt_spy::NodeId subtreeRootId = qt_spy::protocol::kInvalidNodeId; // echoed as rootId
+    int maxDepth = -1;                                                // -1: unlimited
+    qt_spy::NodeId selection = qt_spy::protocol::kInvalidNodeId;
+    quint64 seq = 0; // last event emitted before the walk began
+    QJsonValue requestId = QJsonValue(QJsonValue::Undefined);
+    QString serverName;
+    qint64 timestampMs = 0;
+    int chunkSize = 0; // 0: one snapshot message; otherwise snapshotBegin/Chunk/End
+    qt_spy::protocol::Encoding encoding = qt_spy::protocol::Encoding::Json;
+    int compressAbove = 0; // as negotiated by the connection
+    std::shared_ptr<CompressionMeter> compression;
+};
 
-    void sendMessage(const QJsonObject &message);
-    void sendError(const QString &code, const QString &text, const QJsonObject &context = {});
-    void sendHello();
-    void resetConnectionState(); // Reset state without cleanup for reconnections
+// Where a snapshot walk resumes: the tracked nodes still to visit, next last.
+struct SnapshotWalk {
+    struct PendingNode {
+        int slot;
+        qt_spy::NodeId id; // tells a slot reused since it was queued apart
+        int depth;
+    };
+    QVector<PendingNode> stack;
+    int slices = 0;
+};
 
-    QJsonObject buildSnapshotPayload();
-    QJsonObject serializeNode(QObject *object, const QString &parentId);
-    QJsonObject serializeProperties(QObject *object) const;
+QVector<QByteArray> encodeSnapshot(const SnapshotCapture &capture)
+{
+    namespace protocol = qt_spy::protocol;
 
-    QString ensureIdForObject(const QObject *object);
+    QJsonArray rootIds;
+    for (const qt_spy::NodeId rootId : capture.rootIds) {
+        rootIds.append(protocol::nodeIdToJson(rootId));
+    }
 
-    void observeProperties(QObject *object);
-    void unobserveProperties(QObject *object);
+    const auto header = [&](const char *type) {
+        QJsonObject message;
+        message[QLatin1String(protocol::keys::kType)] = QLatin1String(type);
+        message[QLatin1String(protocol::keys::kTimestampMs)] = capture.timestampMs;
+        if (!capture.requestId.isUndefined()) {
+            message[QLatin1String(protocol::keys::kRequestId)] = capture.requestId;
+        }
+        return message;
+    };
+    const auto describe = [&](QJsonObject &message) {
+        message[QStringLiteral("protocolVersion")] = protocol::kVersion;
+        message[QLatin1String(protocol::keys::kServerName)] = capture.serverName;
+        message[QLatin1String(protocol::keys::kRootIds)] = rootIds;
+        if (capture.subtreeRootId != protocol::kInvalidNodeId) {
+            message[QLatin1String(protocol::keys::kRootId)] =
+                protocol::nodeIdToJson(capture.subtreeRootId);
+        }
+        if (capture.maxDepth >= 0) {
+            message[QLatin1String(protocol::keys::kMaxDepth)] = capture.maxDepth;
+        }
+        if (capture.selection != protocol::kInvalidNodeId) {
+            message[QLatin1String(protocol::keys::kSelection)] =
+                protocol::nodeIdToJson(capture.selection);
+        }
+        message[QLatin1String(protocol::keys::kSeq)] = static_cast<qint64>(capture.seq);
+    };
 
-    void installRecursive(QObject *object, const QString &parentId, bool announce);
-    void removeRecursive(QObject *object, bool emitEvent);
+    const auto encode = [&](const QJsonObject &message) {
+        return encodeOutgoingFrame(message, capture.encoding, capture.compressAbove,
+                                   capture.compression.get());
+    };
 
-    void emitNodeAdded(QObject *object, const QString &parentId);
-    void emitNodeRemoved(const QString &id, const QString &parentId);
-    void emitPropertiesChanged(QObject *object, const QStringList &names);
+    QVector<QByteArray> frames;
+    if (capture.chunkSize <= 0) {
+        QJsonArray nodes;
+        for (const CapturedNode &node : capture.nodes) {
+            nodes.append(nodeToJson(node));
+        }
+        QJsonObject payload = header(protocol::types::kSnapshot);
+        describe(payload);
+        payload[QLatin1String(protocol::keys::kNodes)] = nodes;
+        frames.append(encode(payload));
+        return frames;
+    }
+
+    QJsonObject begin = header(protocol::types::kSnapshotBegin);
+    describe(begin);
+    begin[QLatin1String(protocol::keys::kChunkSize)] = capture.chunkSize;
+    frames.append(encode(begin));
+
+    int chunkIndex = 0;
+    for (int first = 0; first < capture.nodes.size(); first += capture.chunkSize) {
+        const int last = qMin(first + capture.chunkSize, capture.nodes.size());
+        QJsonArray nodes;
+        for (int i = first; i < last; ++i) {
+            nodes.append(nodeToJson(capture.nodes.at(i)));
+        }
+        QJsonObject chunk;
+        chunk[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSnapshotChunk);
+        chunk[QLatin1String(protocol::keys::kChunkIndex)] = chunkIndex++;
+        if (!capture.requestId.isUndefined()) {
+            chunk[QLatin1String(protocol::keys::kRequestId)] = capture.requestId;
+        }
+        chunk[QLatin1String(protocol::keys::kNodes)] = nodes;
+        frames.append(encode(chunk));
+    }
 
-    QVector<QObject *> ensureRootsTracked(bool announce);
-    void refreshTopLevelObjects();
-    void cleanup();
+    QJsonObject end = header(protocol::types::kSnapshotEnd);
+    end[QLatin1String(protocol::keys::kNodeCount)] = capture.nodes.size();
+    end[QLatin1String(protocol::keys::kChunkCount)] = chunkIndex;
+    frames.append(encode(end));
+    return frames;
+}
 
-    bool m_handshakeComplete = false;
-    QLocalSocket *m_socket = nullptr;
-    Probe *m_probe = nullptr;
-    QByteArray m_readBuffer;
-    QTimer m_topLevelPoll;
-
-    QHash<const QObject *, QString> m_idsByObject;
-    QHash<QString, QPointer<QObject>> m_objectById;
-    QHash<const QObject *, QString> m_parentByObject;
-    QHash<const QObject *, QVector<QMetaObject::Connection>> m_propertyConnections;
-    QHash<QPair<const QObject *, int>, QString> m_propertyBySignalIndex;
-    QSet<const QObject *> m_tracked;
-    QString m_selectedId;
+// What a snapshotRequest/propertiesRequest asked for. Groups left out are not
+// read from the host objects at all, not merely dropped from the payload.
+struct FieldMask {
+    bool geometry = true;
+    bool properties = true;
+    bool dynamicProperties = true;
+    QSet<QString> propertyNames; // empty: every property of the enabled groups
 };
 
-ProbeConnection::ProbeConnection(QLocalSocket *socket, Probe *probe)
-    : QObject(probe)
-    , m_socket(socket)
-    , m_probe(probe)
-    , m_topLevelPoll(this)
+bool applyFieldToken(const QString &token, FieldMask *mask)
 {
-    Q_ASSERT(m_socket);
-    m_socket->setParent(this);
+    const bool enable = !token.startsWith(QLatin1Char('-'));
+    const QString name = enable ? token : token.mid(1);
+    if (name == QLatin1String(qt_spy::protocol::fields::kAll)) {
+        mask->geometry = mask->properties = mask->dynamicProperties = enable;
+    } else if (name == QLatin1String(qt_spy::protocol::fields::kStructure)) {
+        // Identity and hierarchy are always present; the token only exists so
+        // that ["structure"] reads naturally as a structure-only request.
+    } else if (name == QLatin1String(qt_spy::protocol::fields::kGeometry)) {
+        mask->geometry = enable;
+    } else if (name == QLatin1String(qt_spy::protocol::fields::kProperties)) {
+        mask->properties = enable;
+    } else if (name == QLatin1String(qt_spy::protocol::fields::kDynamic)) {
+        mask->dynamicProperties = enable;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    connect(m_socket, &QLocalSocket::readyRead, this, &ProbeConnection::onReadyRead);
-    connect(m_socket, &QLocalSocket::disconnected, this, &ProbeConnection::onDisconnected);
-    connect(m_socket,
-            &QLocalSocket::errorOccurred,
-            this,
-            [this](QLocalSocket::LocalSocketError) {
-                if (!m_handshakeComplete) {
-                    sendError(QStringLiteral("connectionError"), m_socket->errorString());
-                }
-            });
+// Missing "fields" means everything. Otherwise the tokens are applied in
+// order to a mask that starts empty, or full when the first token is a "-"
+// removal, so ["-dynamic"] means everything but dynamic properties.
+// "propertyNames" further restricts the property groups that remain enabled.
+bool parseFieldMask(const QJsonObject &message, FieldMask *mask, QString *error)
+{
+    *mask = FieldMask();
+
+    const QJsonValue fieldsValue = message.value(QLatin1String(qt_spy::protocol::keys::kFields));
+    if (!fieldsValue.isUndefined() && !fieldsValue.isNull()) {
+        QJsonArray tokens;
+        if (fieldsValue.isString()) {
+            tokens.append(fieldsValue);
+        } else if (fieldsValue.isArray()) {
+            tokens = fieldsValue.toArray();
+        } else {
+            *error = QStringLiteral("'fields' must be a string or an array of strings.");
+            return false;
+        }
+
+        const bool startFull =
+            !tokens.isEmpty() && tokens.first().toString().startsWith(QLatin1Char('-'));
+        mask->geometry = mask->properties = mask->dynamicProperties = startFull;
+        for (const QJsonValue &token : tokens) {
+            if (!token.isString() || !applyFieldToken(token.toString(), mask)) {
+                *error = QStringLiteral("Unknown field token: %1")
+                             .arg(token.isString() ? token.toString() : QStringLiteral("<non-string>"));
+                return false;
+            }
+        }
+    }
+
+    const QJsonValue namesValue = message.value(QLatin1String(qt_spy::protocol::keys::kPropertyNames));
+    if (!namesValue.isUndefined() && !namesValue.isNull()) {
+        if (!namesValue.isArray()) {
+            *error = QStringLiteral("'propertyNames' must be an array of strings.");
+            return false;
+        }
+        const QJsonArray names = namesValue.toArray();
+        for (const QJsonValue &name : names) {
+            if (!name.isString()) {
+                *error = QStringLiteral("'propertyNames' must be an array of strings.");
+                return false;
+            }
+            mask->propertyNames.insert(name.toString());
+        }
+        if (fieldsValue.isUndefined() || fieldsValue.isNull()) {
+            // A bare name list is a projection: skip widget/window info too.
+            mask->geometry = false;
+        }
+    }
 
-    m_topLevelPoll.setInterval(1000);
-    m_topLevelPoll.setSingleShot(false);
-    connect(&m_topLevelPoll, &QTimer::timeout, this, &ProbeConnection::refreshTopLevelObjects);
+    return true;
 }
 
-ProbeConnection::~ProbeConnection()
+// Internal application children that are never worth inspecting and that the
+// probe must not touch.
+bool isInternalApplicationChild(const QObject *child)
 {
-    m_topLevelPoll.stop();
-    
-    // For injected probes, avoid cleanup in destructor to prevent interference with host application
-    const bool isLikelyInjected = (m_probe && m_probe->parent() == QCoreApplication::instance());
-    
-    if (!isLikelyInjected) {
-        // Only cleanup for non-injected probes (tests, etc.)
-        cleanup();
+    const QString childClassName = child->metaObject()->className();
+    const QString childObjectName = child->objectName();
+    return childClassName.startsWith("QSocketNotifier") ||
+           childClassName.startsWith("QEventDispatcher") ||
+           childClassName.startsWith("QTimer") ||
+           childClassName.startsWith("QThread") ||
+           childClassName.contains("SystemTrayIcon") ||
+           childClassName.contains("DBus") ||
+           childObjectName.startsWith("qt_") ||
+           childObjectName.startsWith("_q_");
+}
+
+// Application-wide event filter that reports objects which may have started a
+// new subtree (children added anywhere, windows shown, widgets reparented) and
+// children leaving their parent. Candidates are only recorded and installed
+// later; no event is ever consumed, so it is safe for injected probes too.
+class TopLevelWatcher : public QObject {
+public:
+    TopLevelWatcher(std::function<void(QObject *)> onCandidate,
+                    std::function<void(QObject *)> onRemoved,
+                    QObject *parent = nullptr)
+        : QObject(parent)
+        , m_onCandidate(std::move(onCandidate))
+        , m_onRemoved(std::move(onRemoved))
+    {
+    }
+
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        switch (event->type()) {
+        case QEvent::ChildAdded: {
+            auto *childEvent = static_cast<QChildEvent *>(event);
+            if (childEvent->child()) {
+                m_onCandidate(childEvent->child());
+            }
+            break;
+        }
+        case QEvent::ChildRemoved: {
+            auto *childEvent = static_cast<QChildEvent *>(event);
+            if (childEvent->child()) {
+                m_onRemoved(childEvent->child());
+            }
+            break;
+        }
+        case QEvent::Show:
+        case QEvent::ParentChange:
+            m_onCandidate(watched);
+            break;
+        default:
+            break;
+        }
+        return false;
     }
-    
-    if (m_socket) {
-        disconnect(m_socket, nullptr, this, nullptr);
-        if (m_socket->state() == QLocalSocket::ConnectedState) {
-            m_socket->disconnectFromServer();
-            m_socket->waitForDisconnected(50);
+
+private:
+    std::function<void(QObject *)> m_onCandidate;
+    std::function<void(QObject *)> m_onRemoved;
+};
+
+// Frames are handed to the socket only while it holds less than this; the
+// rest waits in the connection's outbound queue where it can still be merged
+// or dropped.
+constexpr qint64 kSocketBufferTarget = 64 * 1024;
+
+// Folds a later propertiesChanged entry for the same node into an earlier one:
+// the changed names are merged and newer values win.
+void mergePropertyChange(QJsonObject *into, const QJsonObject &later)
+{
+    const QLatin1String changedKey(qt_spy::protocol::keys::kChanged);
+    const QLatin1String propertiesKey(qt_spy::protocol::keys::kProperties);
+    const QLatin1String dynamicKey("__dynamic");
+
+    QJsonArray changed = into->value(changedKey).toArray();
+    const QJsonArray laterChanged = later.value(changedKey).toArray();
+    for (const QJsonValue &name : laterChanged) {
+        if (!changed.contains(name)) {
+            changed.append(name);
+        }
+    }
+
+    QJsonObject properties = into->value(propertiesKey).toObject();
+    const QJsonObject laterProperties = later.value(propertiesKey).toObject();
+    for (auto it = laterProperties.constBegin(); it != laterProperties.constEnd(); ++it) {
+        if (it.key() != dynamicKey) {
+            properties.insert(it.key(), it.value());
+            continue;
         }
+        QJsonObject dynamic = properties.value(dynamicKey).toObject();
+        const QJsonObject laterDynamic = it.value().toObject();
+        for (auto dyn = laterDynamic.constBegin(); dyn != laterDynamic.constEnd(); ++dyn) {
+            dynamic.insert(dyn.key(), dyn.value());
+        }
+        properties.insert(dynamicKey, dynamic);
     }
+
+    into->insert(changedKey, changed);
+    into->insert(propertiesKey, properties);
 }
 
-void ProbeConnection::close()
+// Narrows a propertiesChanged entry to the properties a client subscribed to;
+// empty when none of them changed.
+QJsonObject projectPropertyChange(const QJsonObject &change, const QSet<QString> &names)
 {
-    if (m_socket) {
-        m_socket->disconnectFromServer();
+    const QLatin1String changedKey(qt_spy::protocol::keys::kChanged);
+    const QLatin1String propertiesKey(qt_spy::protocol::keys::kProperties);
+    const QLatin1String dynamicKey("__dynamic");
+
+    QJsonArray changed;
+    const QJsonArray allChanged = change.value(changedKey).toArray();
+    for (const QJsonValue &name : allChanged) {
+        if (names.contains(name.toString())) {
+            changed.append(name);
+        }
+    }
+    if (changed.isEmpty()) {
+        return {};
+    }
+
+    QJsonObject properties;
+    const QJsonObject allProperties = change.value(propertiesKey).toObject();
+    for (auto it = allProperties.constBegin(); it != allProperties.constEnd(); ++it) {
+        if (it.key() != dynamicKey) {
+            if (names.contains(it.key())) {
+                properties.insert(it.key(), it.value());
+            }
+            continue;
+        }
+        QJsonObject dynamic;
+        const QJsonObject allDynamic = it.value().toObject();
+        for (auto dyn = allDynamic.constBegin(); dyn != allDynamic.constEnd(); ++dyn) {
+            if (names.contains(dyn.key())) {
+                dynamic.insert(dyn.key(), dyn.value());
+            }
+        }
+        if (!dynamic.isEmpty()) {
+            properties.insert(dynamicKey, dynamic);
+        }
     }
+
+    QJsonObject projected = change;
+    projected.insert(changedKey, changed);
+    projected.insert(propertiesKey, properties);
+    return projected;
 }
 
-bool ProbeConnection::eventFilter(QObject *watched, QEvent *event)
-{
-    if (!watched || !event) {
-        return QObject::eventFilter(watched, event);
+// Open-addressing index from a key to an ObjectTable slot. Buckets hold only
+// slot numbers and keys are compared through the table, so an entry costs one
+// int. Linear probing with backward-shift deletion keeps probe sequences short
+// without tombstones.
+class SlotIndex {
+public:
+    template <typename Matches>
+    int find(quint64 hash, Matches matches) const
+    {
+        if (m_buckets.isEmpty()) {
+            return -1;
+        }
+        for (int bucket = bucketFor(hash);; bucket = nextBucket(bucket)) {
+            const int slot = m_buckets.at(bucket);
+            if (slot < 0 || matches(slot)) {
+                return slot;
+            }
+        }
     }
 
-    switch (event->type()) {
-    case QEvent::ChildAdded: {
-        auto *childEvent = static_cast<QChildEvent *>(event);
-        if (!childEvent->added()) {
-            break;
+    template <typename HashOf>
+    void insert(quint64 hash, int slot, HashOf hashOf)
+    {
+        // Grow at 3/4 load.
+        if ((m_size + 1) * 4 > m_buckets.size() * 3) {
+            rehash(qMax(16, m_buckets.size() * 2), hashOf);
         }
-        QObject *child = childEvent->child();
-        if (!child || m_tracked.contains(child)) {
-            break;
+        int bucket = bucketFor(hash);
+        while (m_buckets.at(bucket) >= 0) {
+            bucket = nextBucket(bucket);
         }
-        const QString parentId = ensureIdForObject(watched);
-        installRecursive(child, parentId, true);
-        break;
+        m_buckets[bucket] = slot;
+        ++m_size;
     }
-    case QEvent::ChildRemoved: {
-        auto *childEvent = static_cast<QChildEvent *>(event);
-        QObject *child = childEvent->child();
-        if (!child) {
-            break;
+
+    template <typename HashOf>
+    void remove(quint64 hash, int slot, HashOf hashOf)
+    {
+        if (m_buckets.isEmpty()) {
+            return;
         }
-        removeRecursive(child, true);
-        break;
+        int hole = bucketFor(hash);
+        while (m_buckets.at(hole) != slot) {
+            if (m_buckets.at(hole) < 0) {
+                return;
+            }
+            hole = nextBucket(hole);
+        }
+
+        // Pull later entries of the probe run back into the hole unless their
+        // home bucket lies between the hole and where they sit.
+        const int mask = m_buckets.size() - 1;
+        for (int bucket = nextBucket(hole);; bucket = nextBucket(bucket)) {
+            const int moved = m_buckets.at(bucket);
+            if (moved < 0) {
+                break;
+            }
+            const int home = bucketFor(hashOf(moved));
+            if (((bucket - home) & mask) >= ((bucket - hole) & mask)) {
+                m_buckets[hole] = moved;
+                hole = bucket;
+            }
+        }
+        m_buckets[hole] = -1;
+        --m_size;
     }
-    case QEvent::DynamicPropertyChange: {
-        auto *dynamicEvent = static_cast<QDynamicPropertyChangeEvent *>(event);
-        const QByteArray name = dynamicEvent->propertyName();
-        emitPropertiesChanged(watched, {QString::fromUtf8(name)});
-        break;
+
+    void clear()
+    {
+        m_buckets.clear();
+        m_size = 0;
+        m_shift = 64;
     }
-    default:
-        break;
+
+    qint64 memoryBytes() const { return qint64(m_buckets.capacity()) * qint64(sizeof(int)); }
+
+private:
+    // Fibonacci hashing: object addresses share their low bits and ids are
+    // sequential, so the high bits of the product are the ones to use.
+    int bucketFor(quint64 hash) const
+    {
+        return static_cast<int>((hash * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+    int nextBucket(int bucket) const { return (bucket + 1) & (m_buckets.size() - 1); }
+
+    template <typename HashOf>
+    void rehash(int bucketCount, HashOf hashOf)
+    {
+        const QVector<int> old = std::exchange(m_buckets, QVector<int>(bucketCount, -1));
+        m_shift = 64;
+        for (int count = bucketCount; count > 1; count >>= 1) {
+            --m_shift;
+        }
+        for (const int slot : old) {
+            if (slot < 0) {
+                continue;
+            }
+            int bucket = bucketFor(hashOf(slot));
+            while (m_buckets.at(bucket) >= 0) {
+                bucket = nextBucket(bucket);
+            }
+            m_buckets[bucket] = slot;
+        }
     }
 
-    return QObject::eventFilter(watched, event);
+    QVector<int> m_buckets;
+    int m_size = 0;
+    int m_shift = 64;
+};
+
+// Per-object state of the registry as parallel arrays indexed by slot, with
+// the tracked tree kept as parent/child/sibling links between slots. Every
+// object the probe handed an id to has a slot; slots of forgotten objects are
+// reused.
+class ObjectTable {
+public:
+    static constexpr int kNoSlot = -1;
+
+    enum Flag : quint8 {
+        Tracked = 0x1,
+        Expanded = 0x2, // lazy attach: the children are tracked too
+    };
+
+    int slotOf(const QObject *object) const
+    {
+        return m_byObject.find(objectHash(object),
+                               [this, object](int slot) { return m_objects.at(slot) == object; });
+    }
+
+    int slotOfId(qt_spy::NodeId id) const
+    {
+        return m_byId.find(id, [this, id](int slot) { return m_ids.at(slot) == id; });
+    }
+
+    int add(QObject *object, qt_spy::NodeId id)
+    {
+        int slot = kNoSlot;
+        if (!m_freeSlots.isEmpty()) {
+            slot = m_freeSlots.takeLast();
+            m_objects[slot] = object;
+            m_guards[slot] = object;
+            m_ids[slot] = id;
+        } else {
+            slot = m_objects.size();
+            m_objects.append(object);
+            m_guards.append(object);
+            m_ids.append(id);
+            m_parent.append(kNoSlot);
+            m_firstChild.append(kNoSlot);
+            m_lastChild.append(kNoSlot);
+            m_childCount.append(0);
+            m_prevSibling.append(kNoSlot);
+            m_nextSibling.append(kNoSlot);
+            m_flags.append(0);
+            m_connections.append(QVector<QMetaObject::Connection>());
+        }
+        m_byObject.insert(objectHash(object), slot, [this](int s) { return objectHash(m_objects.at(s)); });
+        m_byId.insert(id, slot, [this](int s) { return m_ids.at(s); });
+        ++m_size;
+        return slot;
+    }
+
+    void release(int slot)
+    {
+        unlink(slot);
+        for (int child = m_firstChild.at(slot); child != kNoSlot;) {
+            const int next = m_nextSibling.at(child);
+            m_parent[child] = kNoSlot;
+            m_prevSibling[child] = kNoSlot;
+            m_nextSibling[child] = kNoSlot;
+            child = next;
+        }
+        m_firstChild[slot] = kNoSlot;
+        m_lastChild[slot] = kNoSlot;
+        m_childCount[slot] = 0;
+
+        m_byObject.remove(objectHash(m_objects.at(slot)), slot,
+                          [this](int s) { return objectHash(m_objects.at(s)); });
+        m_byId.remove(m_ids.at(slot), slot, [this](int s) { return m_ids.at(s); });
+        m_objects[slot] = nullptr;
+        m_guards[slot].clear();
+        m_ids[slot] = qt_spy::protocol::kInvalidNodeId;
+        m_flags[slot] = 0;
+        m_connections[slot] = {};
+        m_freeSlots.append(slot);
+        --m_size;
+    }
+
+    // Appends the slot as the last child of parentSlot, or makes it a root.
+    void link(int slot, int parentSlot)
+    {
+        unlink(slot);
+        m_parent[slot] = parentSlot;
+        if (parentSlot == kNoSlot) {
+            return;
+        }
+        const int last = m_lastChild.at(parentSlot);
+        m_prevSibling[slot] = last;
+        if (last != kNoSlot) {
+            m_nextSibling[last] = slot;
+        } else {
+            m_firstChild[parentSlot] = slot;
+        }
+        m_lastChild[parentSlot] = slot;
+        ++m_childCount[parentSlot];
+    }
+
+    void unlink(int slot)
+    {
+        const int parentSlot = m_parent.at(slot);
+        if (parentSlot != kNoSlot) {
+            const int prev = m_prevSibling.at(slot);
+            const int next = m_nextSibling.at(slot);
+            if (prev != kNoSlot) {
+                m_nextSibling[prev] = next;
+            } else {
+                m_firstChild[parentSlot] = next;
+            }
+            if (next != kNoSlot) {
+                m_prevSibling[next] = prev;
+            } else {
+                m_lastChild[parentSlot] = prev;
+            }
+            --m_childCount[parentSlot];
+        }
+        m_parent[slot] = kNoSlot;
+        m_prevSibling[slot] = kNoSlot;
+        m_nextSibling[slot] = kNoSlot;
+    }
+
+    void clear()
+    {
+        *this = ObjectTable();
+    }
+
+    int size() const { return m_size; }
+    int slotCount() const { return m_objects.size(); }
+
+    // Null once the object is being destroyed, or when a new object reuses
+    // the address of one the probe never saw die.
+    QObject *object(int slot) const { return m_guards.at(slot).data(); }
+    const QObject *key(int slot) const { return m_objects.at(slot); }
+    qt_spy::NodeId id(int slot) const { return m_ids.at(slot); }
+    int parent(int slot) const { return m_parent.at(slot); }
+    int firstChild(int slot) const { return m_firstChild.at(slot); }
+    int lastChild(int slot) const { return m_lastChild.at(slot); }
+    int childCount(int slot) const { return m_childCount.at(slot); }
+    int nextSibling(int slot) const { return m_nextSibling.at(slot); }
+    int prevSibling(int slot) const { return m_prevSibling.at(slot); }
+
+    bool hasFlag(int slot, Flag flag) const { return (m_flags.at(slot) & flag) != 0; }
+    void setFlag(int slot, Flag flag, bool on)
+    {
+        m_flags[slot] = on ? quint8(m_flags.at(slot) | flag) : quint8(m_flags.at(slot) & ~flag);
+    }
+
+    QVector<QMetaObject::Connection> &connections(int slot) { return m_connections[slot]; }
+
+    qint64 memoryBytes() const
+    {
+        qint64 bytes = qint64(m_objects.capacity()) * qint64(sizeof(const QObject *))
+                       + qint64(m_guards.capacity()) * qint64(sizeof(QPointer<QObject>))
+                       + qint64(m_ids.capacity()) * qint64(sizeof(qt_spy::NodeId))
+                       + qint64(m_parent.capacity() + m_firstChild.capacity() + m_lastChild.capacity()
+                                + m_childCount.capacity() + m_prevSibling.capacity() + m_nextSibling.capacity()
+                                + m_freeSlots.capacity())
+                             * qint64(sizeof(int))
+                       + qint64(m_flags.capacity())
+                       + qint64(m_connections.capacity())
+                             * qint64(sizeof(QVector<QMetaObject::Connection>))
+                       + m_byObject.memoryBytes() + m_byId.memoryBytes();
+        for (const auto &connections : m_connections) {
+            bytes += qint64(connections.capacity()) * qint64(sizeof(QMetaObject::Connection));
+        }
+        return bytes;
+    }
+
+private:
+    static quint64 objectHash(const QObject *object) { return quint64(quintptr(object)); }
+
+    QVector<const QObject *> m_objects; // index key; stays set while the object dies
+    QVector<QPointer<QObject>> m_guards;
+    QVector<qt_spy::NodeId> m_ids;
+    QVector<int> m_parent;
+    QVector<int> m_firstChild;
+    QVector<int> m_lastChild;
+    QVector<int> m_childCount;
+    QVector<int> m_prevSibling;
+    QVector<int> m_nextSibling;
+    QVector<quint8> m_flags;
+    QVector<QVector<QMetaObject::Connection>> m_connections;
+    QVector<int> m_freeSlots;
+    SlotIndex m_byObject;
+    SlotIndex m_byId;
+    int m_size = 0;
+};
+
+// Records how long the enclosing scope took; a null histogram records nothing.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(qt_spy::LatencyHistogram *histogram)
+        : m_histogram(histogram)
+    {
+        if (m_histogram) {
+            m_timer.start();
+        }
+    }
+
+    ~ScopedLatency()
+    {
+        if (m_histogram) {
+            m_histogram->record(m_timer.nsecsElapsed());
+        }
+    }
+
+private:
+    qt_spy::LatencyHistogram *m_histogram;
+    QElapsedTimer m_timer;
+};
+
+QJsonObject histogramToJson(const qt_spy::LatencyHistogram &histogram)
+{
+    // Trailing empty buckets are left out.
+    int used = qt_spy::LatencyHistogram::kBucketCount;
+    while (used > 0 && histogram.buckets[used - 1] == 0) {
+        --used;
+    }
+    QJsonArray buckets;
+    for (int i = 0; i < used; ++i) {
+        buckets.append(static_cast<qint64>(histogram.buckets[i]));
+    }
+
+    QJsonObject json;
+    json[QStringLiteral("count")] = static_cast<qint64>(histogram.count);
+    json[QStringLiteral("totalNs")] = histogram.totalNs;
+    json[QStringLiteral("maxNs")] = histogram.maxNs;
+    json[QStringLiteral("p50Ns")] = histogram.percentileNs(0.5);
+    json[QStringLiteral("p99Ns")] = histogram.percentileNs(0.99);
+    json[QStringLiteral("buckets")] = buckets;
+    return json;
+}
+
+QJsonObject statsToJson(const qt_spy::ProbeStats &stats)
+{
+    QJsonObject latency;
+    latency[QStringLiteral("snapshotCapture")] = histogramToJson(stats.snapshotCaptureLatency);
+    latency[QStringLiteral("snapshotEncode")] = histogramToJson(stats.snapshotEncodeLatency);
+    latency[QStringLiteral("properties")] = histogramToJson(stats.propertiesLatency);
+    latency[QStringLiteral("install")] = histogramToJson(stats.installLatency);
+    latency[QStringLiteral("eventFilter")] = histogramToJson(stats.eventFilterLatency);
+
+    QJsonObject sent;
+    for (auto it = stats.sentByType.cbegin(); it != stats.sentByType.cend(); ++it) {
+        QJsonObject traffic;
+        traffic[QStringLiteral("frames")] = static_cast<qint64>(it->frames);
+        traffic[QStringLiteral("bytes")] = it->bytes;
+        sent[it.key()] = traffic;
+    }
+
+    QJsonObject json;
+    json[QStringLiteral("trackedObjects")] = stats.trackedObjects;
+    json[QStringLiteral("connections")] = stats.connections;
+    json[QStringLiteral("notifyConnections")] = stats.notifyConnections;
+    json[QStringLiteral("propertySubscriptions")] = stats.propertySubscriptions;
+    json[QStringLiteral("objectTableBytes")] = stats.objectTableBytes;
+    json[QStringLiteral("queuedBytes")] = stats.queuedBytes;
+    json[QStringLiteral("queuedFrames")] = stats.queuedFrames;
+    json[QStringLiteral("coalescedChanges")] = static_cast<qint64>(stats.coalescedChanges);
+    json[QStringLiteral("rateLimitedChanges")] = static_cast<qint64>(stats.rateLimitedChanges);
+    json[QStringLiteral("droppedFrames")] = static_cast<qint64>(stats.droppedFrames);
+    json[QStringLiteral("resyncCount")] = static_cast<qint64>(stats.resyncCount);
+    json[QStringLiteral("refreshCount")] = static_cast<qint64>(stats.refreshCount);
+
+    QJsonObject compression;
+    compression[QStringLiteral("frames")] = static_cast<qint64>(stats.compressedFrames);
+    compression[QStringLiteral("inputBytes")] = stats.compressionInputBytes;
+    compression[QStringLiteral("outputBytes")] = stats.compressionOutputBytes;
+    compression[QStringLiteral("ratio")] =
+        stats.compressionInputBytes > 0
+            ? double(stats.compressionOutputBytes) / double(stats.compressionInputBytes)
+            : 1.0;
+    compression[QStringLiteral("cpuNs")] = stats.compressionNs;
+    QJsonArray perConnection;
+    for (const qt_spy::ConnectionStats &connection : stats.perConnection) {
+        QJsonArray ids;
+        for (const quint64 id : connection.subscribedIds) {
+            ids.append(qt_spy::protocol::nodeIdToJson(id));
+        }
+        QJsonObject entry;
+        entry[QStringLiteral("clientName")] = connection.clientName;
+        entry[QStringLiteral("subscribedNodes")] = connection.subscribedIds.size();
+        entry[QStringLiteral("subscribedPropertyNames")] = connection.subscribedPropertyNames;
+        entry[QStringLiteral("allPropertiesNodes")] = connection.allPropertiesNodes;
+        entry[QStringLiteral("subscribedIds")] = ids;
+        perConnection.append(entry);
+    }
+
+    json[QStringLiteral("compression")] = compression;
+    json[QStringLiteral("latency")] = latency;
+    json[QStringLiteral("sentByType")] = sent;
+    json[QStringLiteral("perConnection")] = perConnection;
+    return json;
+}
+
+QString sanitizeProcessName(const QString &name)
+{
+    QString sanitized = name;
+    sanitized.replace(QRegularExpression(QStringLiteral("[^A-Za-z0-9_]")), QStringLiteral("_"));
+    sanitized.replace(QRegularExpression(QStringLiteral("_+")), QStringLiteral("_"));
+    return sanitized.trimmed();
+}
+
+} // namespace
+
+namespace qt_spy {
+
+class ObjectRegistry;
+
+// Turns captured snapshots into frames on a thread of its own, so the host's
+// GUI thread only pays for reading its objects. Results come back through
+// finished() on the thread that owns the encoder.
+class SnapshotEncoder : public QObject {
+    Q_OBJECT
+public:
+    explicit SnapshotEncoder(QObject *parent = nullptr);
+    ~SnapshotEncoder() override;
+
+    quint64 submit(SnapshotCapture capture);
+
+signals:
+    void finished(quint64 job, const QVector<QByteArray> &frames, qint64 encodeNs);
+
+private:
+    QThread m_thread;
+    QObject *m_worker = nullptr;
+    quint64 m_nextJob = 1;
+};
+
+class ProbeConnection : public QObject {
+    Q_OBJECT
+public:
+    ProbeConnection(QLocalSocket *socket, Probe *probe, ObjectRegistry *registry);
+    ~ProbeConnection() override;
+
+    void close();
+    protocol::Encoding encoding() const;
+    // Names this client to the registry; a client that resumes keeps the
+    // session it had.
+    QString session() const;
+    void setSendQueueLimits(qint64 highWater, qint64 limit);
+    // GUI-thread time a snapshot walk may take per event-loop pass; 0 walks
+    // the whole tree at once.
+    void setSnapshotTimeBudget(int budgetMs);
+    // Threshold offered to clients that can inflate frames; 0 disables it.
+    void setFrameCompression(int compressAbove);
+    // The threshold in use for this client, 0 when it did not negotiate
+    // compression.
+    int compressAbove() const;
+    // Without an encoder snapshots are encoded inline on the GUI thread.
+    void setSnapshotEncoder(SnapshotEncoder *encoder);
+    // Queues a registry broadcast. frame is message already encoded for this
+    // connection's encoding and is shared with the other subscribers.
+    void sendEvent(const QJsonObject &message, const QByteArray &frame);
+    void accumulateStats(ProbeStats *stats) const;
+
+signals:
+    void closed(ProbeConnection *connection);
+
+private slots:
+    void onReadyRead();
+    void onDisconnected();
+    void drainOutbound();
+    void onSnapshotEncoded(quint64 job, const QVector<QByteArray> &frames, qint64 encodeNs);
+    void resumeSnapshots();
+
+private:
+    void processBuffer();
+    void handleMessage(const QJsonObject &message);
+    void handleAttach(const QJsonObject &message);
+    void handleDetach(const QJsonObject &message);
+    void handleSnapshotRequest(const QJsonObject &message);
+    void handlePropertiesRequest(const QJsonObject &message);
+    void handleSelectNode(const QJsonObject &message);
+    void handleSubscribe(const QJsonObject &message, bool subscribe);
+    void handleStatsRequest(const QJsonObject &message);
+
+    void sendMessage(const QJsonObject &message);
+    void sendError(const QString &code, const QString &text, const QJsonObject &context = {});
+    void sendHello(protocol::Encoding encoding, bool compression, bool resumed);
+    void resetConnectionState(); // Reset state without cleanup for reconnections
+
+    void enqueueFrame(const QByteArray &frame, const QString &type, bool event,
+                      const QJsonObject &changes = {});
+    bool coalesceIntoTail(const QJsonObject &message);
+    void requireResync(quint64 droppedNow);
+
+    // subtreeRoot limits the walk to one tracked object and its descendants;
+    // nullptr walks every root.
+    void beginSnapshot(QObject *subtreeRoot, SnapshotCapture *capture, SnapshotWalk *walk);
+    // Encodes a finished capture; walkId names the placeholder holding its
+    // place in the queue, 0 appends it.
+    void submitSnapshot(SnapshotCapture capture, quint64 walkId);
+    void replacePlaceholder(int index, const QVector<QByteArray> &frames, const QString &type);
+    void scheduleSnapshotSlice();
+
+    bool m_handshakeComplete = false;
+    QString m_clientName;
+    QString m_session;
+    QLocalSocket *m_socket = nullptr;
+    Probe *m_probe = nullptr;
+    // Owned by the probe; may already be gone while the probe tears down its
+    // children.
+    QPointer<ObjectRegistry> m_registry;
+    QPointer<SnapshotEncoder> m_encoder;
+    protocol::FrameReader m_reader;
+    protocol::Encoding m_encoding = protocol::Encoding::Json;
+    int m_compressionThreshold = 0;
+    int m_compressAbove = 0;
+    std::shared_ptr<CompressionMeter> m_compression;
+    NodeId m_selectedId = protocol::kInvalidNodeId;
+    QJsonValue m_requestId{QJsonValue::Undefined}; // of the message being handled
+
+    // Frames waiting for room in the socket. Events from the registry may be
+    // merged (propertiesChanged past the high-water mark) or dropped (past the
+    // limit); replies to requests are always delivered.
+    struct OutboundFrame {
+        QByteArray frame;
+        QString type; // message type, for the traffic counters
+        bool event = false;
+        QJsonObject changes; // propertiesChanged message while still mergeable
+        quint64 pendingJob = 0; // snapshot still being encoded; holds the queue
+        quint64 pendingWalk = 0; // snapshot still being walked; holds the queue
+    };
+    QList<OutboundFrame> m_outbound;
+    qint64 m_outboundBytes = 0;
+    // The part of m_outboundBytes held by events; the send queue limits apply
+    // to it alone, so a large reply does not make the client resync.
+    qint64 m_queuedEventBytes = 0;
+    qint64 m_sendQueueHighWater = 0;
+    qint64 m_sendQueueLimit = 0;
+    bool m_resyncPending = false;
+    quint64 m_coalescedChanges = 0;
+    quint64 m_droppedFrames = 0;
+    quint64 m_resyncCount = 0;
+    qint64 m_lastSnapshotCaptureNs = 0;
+    qint64 m_lastSnapshotEncodeNs = 0;
+    int m_lastSnapshotSlices = 0;
+    LatencyHistogram m_snapshotCaptureLatency;
+    LatencyHistogram m_snapshotEncodeLatency;
+    QHash<QString, MessageTraffic> m_sentByType;
+
+    // Snapshots walked a time slice per event-loop pass, oldest first.
+    struct PendingSnapshot {
+        quint64 walkId = 0;
+        FieldMask mask;
+        SnapshotCapture capture;
+        SnapshotWalk walk;
+        qint64 captureNs = 0;
+    };
+    QList<PendingSnapshot> m_pendingSnapshots;
+    quint64 m_nextWalkId = 1;
+    qint64 m_snapshotBudgetNs = 0;
+    bool m_sliceScheduled = false;
+};
+
+// Tracks the host's object tree once for the whole probe: node ids, the
+// per-object filters and notify connections, discovery and property
+// coalescing. Attached connections subscribe to it; every nodeAdded and
+// nodeRemoved frame is built and encoded once and then written to each
+// subscriber, propertiesChanged only to the clients subscribed to the node.
+// Tracking starts with the first subscriber and is torn down when the last one
+// leaves. Events are numbered and the most recent ones journaled, so a client
+// whose connection dropped can pick up where it left off.
+class ObjectRegistry : public QObject {
+    Q_OBJECT
+public:
+    ObjectRegistry(Probe *probe, const ProbeOptions &options);
+    ~ObjectRegistry() override;
+
+    void subscribe(ProbeConnection *connection);
+    // resumable parks the connection's property subscriptions under its
+    // session, and keeps tracking alive, for the resume window in case the
+    // client comes back.
+    void unsubscribe(ProbeConnection *connection, bool resumable = false);
+
+    quint64 lastSequence() const;
+    // Whether session is parked and every event after seq is still journaled.
+    bool canResume(const QString &session, quint64 seq) const;
+    // Hands session's parked subscriptions to connection and queues the
+    // journaled events after seq on it, oldest first, narrowed to those
+    // subscriptions.
+    void resume(ProbeConnection *connection, const QString &session, quint64 seq);
+    // Forgets a parked session whose client came back but could not resume.
+    void dropParkedClient(const QString &session);
+
+    QObject *objectForId(NodeId id) const;
+
+    // Property updates are only observed and sent for subscribed nodes. Empty
+    // names subscribe to every property of the node; a negative maxRateHz
+    // uses the probe's default rate limit.
+    bool subscribeProperties(ProbeConnection *connection, NodeId id, const QSet<QString> &names,
+                             double maxRateHz);
+    void unsubscribeProperties(ProbeConnection *connection, NodeId id);
+    NodeId ensureIdForObject(const QObject *object);
+    QVector<QObject *> ensureRootsTracked(bool announce);
+    // Snapshot walks over the tree below subtreeRoot, or every root.
+    // beginCapture() queues the roots; continueCapture() appends nodes down to
+    // capture->maxDepth until the walk is done or budgetNs, when positive, has
+    // passed, and returns whether it is done. Nodes removed between slices are
+    // skipped; nodes added reach subscribers as nodeAdded, which is queued
+    // after the snapshot. With lazy attach the reported nodes get tracked here.
+    void beginCapture(QObject *subtreeRoot, SnapshotWalk *walk);
+    bool continueCapture(SnapshotWalk *walk, const FieldMask &mask, SnapshotCapture *capture,
+                         qint64 budgetNs);
+
+    // Reads what a node reports from the live object; GUI thread only.
+    // Without childIds the node carries childCount, and its children get no
+    // ids: untracked ones would hold table slots that nothing frees when
+    // they die.
+    CapturedNode captureNode(QObject *object, NodeId parentId,
+                             const FieldMask &mask = FieldMask(), bool childIds = true);
+    void captureProperties(QObject *object, const FieldMask &mask, CapturedNode *node) const;
+
+    QJsonObject serializeProperties(QObject *object, const FieldMask &mask = FieldMask());
+
+    ProbeStats stats() const;
+    // Fills in what connection is subscribed to.
+    void subscriptionStats(const ProbeConnection *connection, ConnectionStats *stats) const;
+    std::shared_ptr<CompressionMeter> compressionMeter() const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void handlePropertyNotify();
+    void onObjectDestroyed(QObject *object);
+
+private:
+    void broadcast(QJsonObject message);
+    // Gives message the next seq and journals it.
+    void recordEvent(QJsonObject *message);
+    void parkPropertySubscriptions(ProbeConnection *connection);
+    void refreshParkedSubscription(NodeId id);
+    void expireParkedClients();
+    static QByteArray &sharedFrameSlot(QByteArray (&frames)[4], const ProbeConnection *connection);
+
+    void observeProperties(int slot);
+    void unobserveProperties(int slot);
+
+    int ensureSlot(const QObject *object);
+    bool isTracked(const QObject *object) const;
+    NodeId parentIdOf(int slot) const;
+
+    // depth 0 tracks only the object itself, -1 the whole subtree.
+    void installRecursive(QObject *object, int parentSlot, bool announce, int depth);
+    void installSubtree(QObject *object, int parentSlot, bool announce, int depth);
+    void removeRecursive(const QObject *object, bool emitEvent);
+    void removeSlotRecursive(int slot, bool emitEvent);
+
+    int installDepth() const;
+    bool childrenTracked(int slot) const;
+    bool childrenTracked(const QObject *object) const;
+
+    void emitNodeAdded(QObject *object, NodeId parentId);
+    void emitNodeRemoved(NodeId id, NodeId parentId);
+    void queuePropertiesChanged(QObject *object, const QStringList &names);
+    void appendPendingChange(QObject *object, const QStringList &names);
+    bool admitRateLimited(QObject *object, const QString &name, double maxRateHz, qint64 nowMs);
+    void releaseRateLimited();
+    void flushPropertiesChanged();
+    void dropPropertySubscriptions(ProbeConnection *connection);
+
+    QVector<QObject *> collectRoots() const;
+    bool isRootCandidate(const QObject *object) const;
+    void startDiscovery();
+    void stopDiscovery();
+    void markDiscoveryCandidate(QObject *object);
+    void refreshTopLevelObjects();
+    void cleanup();
+
+    Probe *m_probe = nullptr;
+    bool m_lazyAttach = false;
+    bool m_propertyLayoutCache = true;
+    double m_defaultMaxRateHz = 0.0;
+    QVector<ProbeConnection *> m_subscribers;
+    QTimer m_discoveryFlush;
+    QTimer m_propertyFlush;
+    QTimer m_rateLimitRelease;
+
+    // Objects reported by the watcher since the last refresh. Only these are
+    // visited, instead of re-walking every tracked tree.
+    std::unique_ptr<TopLevelWatcher> m_topLevelWatcher;
+    QHash<const QObject *, QPointer<QObject>> m_discoveryCandidates;
+    int m_installVisits = 0;
+    ProbeStats m_stats;
+
+    // Property notifications collected during the current event-loop pass and
+    // sent as one batched propertiesChanged frame when control returns to it.
+    struct PendingPropertyChange {
+        QPointer<QObject> object;
+        QStringList names;
+    };
+    QHash<const QObject *, int> m_pendingChangeIndex;
+    QVector<PendingPropertyChange> m_pendingChanges;
+
+    // Subscribed property names per node and connection; notify signals are
+    // connected only while a node has at least one subscriber.
+    struct PropertySubscription {
+        QSet<QString> names;
+        double maxRateHz = 0.0;
+    };
+    QHash<NodeId, QHash<ProbeConnection *, PropertySubscription>> m_propertySubscriptions;
+    // Clients that dropped without detaching, by session, each with its own
+    // deadline to come back by. This key holds the union of their
+    // subscriptions on a node, so it keeps being observed and its changes
+    // journaled.
+    static constexpr ProbeConnection *kParkedSubscriber = nullptr;
+    struct ParkedClient {
+        QHash<NodeId, PropertySubscription> subscriptions;
+        QDeadlineTimer deadline;
+    };
+    QHash<QString, ParkedClient> m_parkedClients;
+    int m_resumeWindowMs = 0;
+    QTimer m_resumeWindow; // fires at the earliest deadline
+
+    // The newest events, oldest first. A client that applied everything up to
+    // m_journalFloor or later can resume from the journal alone.
+    struct JournalEntry {
+        quint64 seq = 0;
+        QJsonObject message;
+    };
+    QQueue<JournalEntry> m_journal;
+    int m_journalCapacity = 0;
+    quint64 m_journalFloor = 0;
+    quint64 m_lastSeq = 0;
+
+    // Rate limiting per object and property. A node is limited to the highest
+    // rate any of its subscribers asked for, so no client gets fewer updates
+    // than it wanted. Changes inside a window are held and sent, with the
+    // value current at that time, when the window ends.
+    struct RateWindow {
+        qint64 lastDeliveryMs = 0;
+        qint64 dueMs = 0;
+        bool held = false;
+    };
+    QElapsedTimer m_rateClock;
+    QHash<const QObject *, QHash<QString, RateWindow>> m_rateWindows;
+
+    // Ids are never handed out twice for the lifetime of the probe, even
+    // across tracking restarts.
+    NodeId m_nextNodeId = 1;
+    // Ids, tree links, tracking flags and notify connections of every object
+    // the probe knows about, one slot each.
+    ObjectTable m_table;
+    int m_trackedCount = 0;
+    int m_notifyConnectionCount = 0;
+
+    std::shared_ptr<CompressionMeter> m_compression = std::make_shared<CompressionMeter>();
+};
+
+SnapshotEncoder::SnapshotEncoder(QObject *parent)
+    : QObject(parent)
+    , m_worker(new QObject)
+{
+    m_thread.setObjectName(QStringLiteral("qt-spy snapshot encoder"));
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.start();
+}
+
+SnapshotEncoder::~SnapshotEncoder()
+{
+    // Jobs still queued on the worker are dropped with it.
+    m_thread.quit();
+    m_thread.wait();
+}
+
+quint64 SnapshotEncoder::submit(SnapshotCapture capture)
+{
+    const quint64 job = m_nextJob++;
+    QMetaObject::invokeMethod(
+        m_worker,
+        [this, job, capture = std::move(capture)]() {
+            QElapsedTimer timer;
+            timer.start();
+            const QVector<QByteArray> frames = encodeSnapshot(capture);
+            const qint64 encodeNs = timer.nsecsElapsed();
+            QMetaObject::invokeMethod(
+                this,
+                [this, job, frames, encodeNs]() { emit finished(job, frames, encodeNs); },
+                Qt::QueuedConnection);
+        },
+        Qt::QueuedConnection);
+    return job;
+}
+
+ProbeConnection::ProbeConnection(QLocalSocket *socket, Probe *probe, ObjectRegistry *registry)
+    : QObject(probe)
+    , m_socket(socket)
+    , m_probe(probe)
+    , m_registry(registry)
+{
+    Q_ASSERT(m_socket);
+    m_socket->setParent(this);
+    if (registry) {
+        m_compression = registry->compressionMeter();
+    }
+
+    connect(m_socket, &QLocalSocket::readyRead, this, &ProbeConnection::onReadyRead);
+    connect(m_socket, &QLocalSocket::disconnected, this, &ProbeConnection::onDisconnected);
+    connect(m_socket, &QLocalSocket::bytesWritten, this, &ProbeConnection::drainOutbound);
+    connect(m_socket,
+            &QLocalSocket::errorOccurred,
+            this,
+            [this](QLocalSocket::LocalSocketError) {
+                if (!m_handshakeComplete) {
+                    sendError(QStringLiteral("connectionError"), m_socket->errorString());
+                }
+            });
+}
+
+ProbeConnection::~ProbeConnection()
+{
+    if (m_registry) {
+        m_registry->unsubscribe(this);
+    }
+    
+    if (m_socket) {
+        disconnect(m_socket, nullptr, this, nullptr);
+        if (m_socket->state() == QLocalSocket::ConnectedState) {
+            m_socket->disconnectFromServer();
+            m_socket->waitForDisconnected(50);
+        }
+    }
+}
+
+void ProbeConnection::close()
+{
+    // Closed by the probe itself, which is going away: nothing to resume.
+    m_pendingSnapshots.clear();
+    if (m_registry) {
+        m_registry->unsubscribe(this);
+    }
+    if (m_socket) {
+        m_socket->disconnectFromServer();
+    }
+}
+
+protocol::Encoding ProbeConnection::encoding() const
+{
+    return m_encoding;
+}
+
+QString ProbeConnection::session() const
+{
+    return m_session;
+}
+
+void ProbeConnection::setSendQueueLimits(qint64 highWater, qint64 limit)
+{
+    m_sendQueueHighWater = highWater;
+    m_sendQueueLimit = qMax(limit, highWater);
+}
+
+void ProbeConnection::setFrameCompression(int compressAbove)
+{
+    m_compressionThreshold = qMax(0, compressAbove);
+}
+
+int ProbeConnection::compressAbove() const
+{
+    return m_compressAbove;
+}
+
+void ProbeConnection::setSnapshotTimeBudget(int budgetMs)
+{
+    m_snapshotBudgetNs = qMax(0, budgetMs) * qint64(1000000);
+}
+
+void ProbeConnection::setSnapshotEncoder(SnapshotEncoder *encoder)
+{
+    if (m_encoder) {
+        disconnect(m_encoder, nullptr, this, nullptr);
+    }
+    m_encoder = encoder;
+    if (encoder) {
+        connect(encoder, &SnapshotEncoder::finished, this, &ProbeConnection::onSnapshotEncoded);
+    }
+}
+
+void ProbeConnection::sendEvent(const QJsonObject &message, const QByteArray &frame)
+{
+    if (m_resyncPending) {
+        ++m_droppedFrames;
+        return;
+    }
+
+    const bool propertiesChanged = message.value(QLatin1String(protocol::keys::kType)).toString()
+                                   == QLatin1String(protocol::types::kPropertiesChanged);
+    if (propertiesChanged && m_queuedEventBytes >= m_sendQueueHighWater
+        && coalesceIntoTail(message)) {
+        // Merging bounds repeated changes, not a stream of distinct ones.
+        if (m_queuedEventBytes > m_sendQueueLimit) {
+            requireResync(0);
+        }
+        return;
+    }
+
+    if (m_queuedEventBytes + frame.size() > m_sendQueueLimit) {
+        requireResync(1);
+        return;
+    }
+
+    enqueueFrame(frame, message.value(QLatin1String(protocol::keys::kType)).toString(), true,
+                 propertiesChanged ? message : QJsonObject());
+}
+
+void ProbeConnection::accumulateStats(ProbeStats *stats) const
+{
+    stats->queuedBytes += m_outboundBytes;
+    stats->queuedFrames += m_outbound.size();
+    stats->coalescedChanges += m_coalescedChanges;
+    stats->droppedFrames += m_droppedFrames;
+    stats->resyncCount += m_resyncCount;
+    stats->lastSnapshotCaptureNs = qMax(stats->lastSnapshotCaptureNs, m_lastSnapshotCaptureNs);
+    stats->lastSnapshotEncodeNs = qMax(stats->lastSnapshotEncodeNs, m_lastSnapshotEncodeNs);
+    stats->lastSnapshotSlices = qMax(stats->lastSnapshotSlices, m_lastSnapshotSlices);
+    ++stats->connections;
+    stats->snapshotCaptureLatency.merge(m_snapshotCaptureLatency);
+    stats->snapshotEncodeLatency.merge(m_snapshotEncodeLatency);
+    for (auto it = m_sentByType.cbegin(); it != m_sentByType.cend(); ++it) {
+        MessageTraffic &traffic = stats->sentByType[it.key()];
+        traffic.frames += it->frames;
+        traffic.bytes += it->bytes;
+    }
+
+    ConnectionStats connection;
+    connection.clientName = m_clientName;
+    if (m_registry) {
+        m_registry->subscriptionStats(this, &connection);
+    }
+    stats->perConnection.append(connection);
+}
+
+void ProbeConnection::enqueueFrame(const QByteArray &frame, const QString &type, bool event,
+                                   const QJsonObject &changes)
+{
+    if (!m_socket) {
+        return;
+    }
+
+    m_outbound.append({frame, type, event, changes});
+    m_outboundBytes += frame.size();
+    if (event) {
+        m_queuedEventBytes += frame.size();
+    }
+    drainOutbound();
+}
+
+void ProbeConnection::drainOutbound()
+{
+    if (!m_socket) {
+        return;
+    }
+
+    while (!m_outbound.isEmpty() && m_outbound.first().pendingJob == 0
+           && m_outbound.first().pendingWalk == 0
+           && m_socket->bytesToWrite() < kSocketBufferTarget) {
+        const OutboundFrame next = m_outbound.takeFirst();
+        m_outboundBytes -= next.frame.size();
+        if (next.event) {
+            m_queuedEventBytes -= next.frame.size();
+        }
+        m_socket->write(next.frame);
+        MessageTraffic &traffic = m_sentByType[next.type];
+        ++traffic.frames;
+        traffic.bytes += next.frame.size();
+    }
+    m_socket->flush();
+}
+
+void ProbeConnection::onSnapshotEncoded(quint64 job, const QVector<QByteArray> &frames,
+                                        qint64 encodeNs)
+{
+    for (int i = 0; i < m_outbound.size(); ++i) {
+        if (m_outbound.at(i).pendingJob != job) {
+            continue;
+        }
+        m_lastSnapshotEncodeNs = encodeNs;
+        m_snapshotEncodeLatency.record(encodeNs);
+        replacePlaceholder(i, frames, QLatin1String(protocol::types::kSnapshot));
+        return;
+    }
+}
+
+bool ProbeConnection::coalesceIntoTail(const QJsonObject &message)
+{
+    // Only the last queued frame is merged into, so updates never overtake a
+    // nodeAdded/nodeRemoved queued before them.
+    if (m_outbound.isEmpty() || m_outbound.last().changes.isEmpty()) {
+        return false;
+    }
+
+    OutboundFrame &tail = m_outbound.last();
+    QJsonArray changes = tail.changes.value(QLatin1String(protocol::keys::kChanges)).toArray();
+    QHash<NodeId, int> indexById;
+    for (int i = 0; i < changes.size(); ++i) {
+        indexById.insert(protocol::nodeIdFromJson(
+                             changes.at(i).toObject().value(QLatin1String(protocol::keys::kId))),
+                         i);
+    }
+
+    const QJsonArray later = message.value(QLatin1String(protocol::keys::kChanges)).toArray();
+    for (const QJsonValue &value : later) {
+        const QJsonObject change = value.toObject();
+        const NodeId id = protocol::nodeIdFromJson(change.value(QLatin1String(protocol::keys::kId)));
+        const auto existing = indexById.constFind(id);
+        if (existing == indexById.constEnd()) {
+            indexById.insert(id, changes.size());
+            changes.append(change);
+            continue;
+        }
+        QJsonObject merged = changes.at(existing.value()).toObject();
+        mergePropertyChange(&merged, change);
+        changes.replace(existing.value(), merged);
+        ++m_coalescedChanges;
+    }
+
+    tail.changes.insert(QLatin1String(protocol::keys::kChanges), changes);
+    tail.changes.insert(QLatin1String(protocol::keys::kTimestampMs),
+                        message.value(QLatin1String(protocol::keys::kTimestampMs)));
+    tail.changes.insert(QLatin1String(protocol::keys::kSeq),
+                        message.value(QLatin1String(protocol::keys::kSeq)));
+    m_outboundBytes -= tail.frame.size();
+    m_queuedEventBytes -= tail.frame.size();
+    tail.frame = encodeOutgoingFrame(tail.changes, m_encoding, m_compressAbove, m_compression.get());
+    m_outboundBytes += tail.frame.size();
+    m_queuedEventBytes += tail.frame.size();
+    return true;
+}
+
+void ProbeConnection::requireResync(quint64 droppedNow)
+{
+    // Queued events are stale once any of them is lost; replies stay, the
+    // client is waiting for them.
+    quint64 dropped = droppedNow;
+    for (auto it = m_outbound.begin(); it != m_outbound.end();) {
+        if (it->event) {
+            m_outboundBytes -= it->frame.size();
+            it = m_outbound.erase(it);
+            ++dropped;
+        } else {
+            ++it;
+        }
+    }
+    m_queuedEventBytes = 0;
+    m_droppedFrames += dropped;
+    ++m_resyncCount;
+    m_resyncPending = true;
+
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kResyncRequired);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    payload[QLatin1String(protocol::keys::kDropped)] = static_cast<qint64>(dropped);
+    sendMessage(payload);
+}
+
+void ProbeConnection::onReadyRead()
+{
+    if (!m_socket) {
+        return;
+    }
+
+    m_reader.readFrom(m_socket);
+    processBuffer();
+}
+
+void ProbeConnection::onDisconnected()
+{
+    // The registry keeps tracking for the remaining subscribers and only tears
+    // down (conservatively, for injected probes) once the last one is gone and
+    // the window for it to resume has passed.
+    if (m_registry) {
+        m_registry->unsubscribe(this, m_handshakeComplete);
+    }
+    
+    emit closed(this);
+}
+
+void ProbeConnection::processBuffer()
+{
+    quint32 header = 0;
+    QByteArray payload;
+    while (m_reader.next(&header, &payload)) {
+        QJsonObject message;
+        QString parseError;
+        if (protocol::isCompressedFrame(header)
+            && !protocol::inflatePayload(payload, &payload, &parseError)) {
+            sendError(QStringLiteral("invalidFrame"),
+                      QStringLiteral("Unable to inflate message: %1").arg(parseError));
+            continue;
+        }
+        if (!protocol::decodePayload(payload, &message, &parseError)) {
+            const bool isCbor = protocol::detectEncoding(payload) == protocol::Encoding::Cbor;
+            sendError(isCbor ? QStringLiteral("invalidCbor") : QStringLiteral("invalidJson"),
+                      QStringLiteral("Unable to parse message: %1").arg(parseError));
+            continue;
+        }
+
+        handleMessage(message);
+    }
+}
+
+void ProbeConnection::handleMessage(const QJsonObject &message)
+{
+    // Errors raised while handling the message echo its requestId.
+    const QScopedValueRollback<QJsonValue> requestId(
+        m_requestId, message.value(QLatin1String(protocol::keys::kRequestId)));
+
+    const QString typeName = message.value(QLatin1String(protocol::keys::kType)).toString();
+    if (typeName.isEmpty()) {
+        sendError(QStringLiteral("invalidMessage"), QStringLiteral("Message missing 'type'."));
+        return;
+    }
+
+    const protocol::MessageType type = protocol::messageTypeFromName(typeName);
+    if (!m_handshakeComplete && type != protocol::MessageType::Attach) {
+        sendError(QStringLiteral("handshakeRequired"),
+                  QStringLiteral("Must attach before sending '%1'.").arg(typeName));
+        return;
+    }
+
+    switch (type) {
+    case protocol::MessageType::Attach:
+        handleAttach(message);
+        break;
+    case protocol::MessageType::SnapshotRequest:
+        handleSnapshotRequest(message);
+        break;
+    case protocol::MessageType::PropertiesRequest:
+        handlePropertiesRequest(message);
+        break;
+    case protocol::MessageType::SelectNode:
+        handleSelectNode(message);
+        break;
+    case protocol::MessageType::Subscribe:
+        handleSubscribe(message, true);
+        break;
+    case protocol::MessageType::Unsubscribe:
+        handleSubscribe(message, false);
+        break;
+    case protocol::MessageType::StatsRequest:
+        handleStatsRequest(message);
+        break;
+    case protocol::MessageType::Detach:
+        handleDetach(message);
+        break;
+    default:
+        sendError(QStringLiteral("unknownMessage"),
+                  QStringLiteral("Unknown message type '%1'.").arg(typeName));
+        break;
+    }
+}
+
+void ProbeConnection::handleAttach(const QJsonObject &message)
+{
+    if (m_handshakeComplete) {
+        sendError(QStringLiteral("alreadyAttached"),
+                  QStringLiteral("Attach has already been completed."));
+        return;
+    }
+
+    const int clientVersion =
+        message.value(QLatin1String(protocol::keys::kProtocolVersion)).toInt(-1);
+    if (clientVersion != qt_spy::protocol::kVersion) {
+        QJsonObject context;
+        context[QStringLiteral("serverVersion")] = qt_spy::protocol::kVersion;
+        context[QStringLiteral("clientVersion")] = clientVersion;
+        sendError(QStringLiteral("protocolMismatch"),
+                  QStringLiteral("Protocol mismatch between client and helper."),
+                  context);
+        if (m_socket) {
+            m_socket->disconnectFromServer();
+        }
+        return;
+    }
+
+    // The client lists the encodings it can send and decode, most preferred
+    // first. Clients that predate the negotiation send nothing and keep JSON.
+    protocol::Encoding negotiated = protocol::Encoding::Json;
+    const QJsonArray offered = message.value(QLatin1String(protocol::keys::kEncodings)).toArray();
+    for (const QJsonValue &value : offered) {
+        if (protocol::encodingFromName(value.toString(), &negotiated)) {
+            break;
+        }
+    }
+
+    // Large frames are compressed only for clients that can inflate them.
+    bool compression = false;
+    if (m_compressionThreshold > 0) {
+        const QJsonArray compressions =
+            message.value(QLatin1String(protocol::keys::kCompressions)).toArray();
+        compression = compressions.contains(QLatin1String(protocol::compressions::kZlib));
+    }
+
+    // A client that saw the events up to resumeFrom before its connection
+    // dropped gets the rest replayed instead of taking a new snapshot.
+    bool resumed = false;
+    quint64 resumeFrom = 0;
+    const QString session = message.value(QLatin1String(protocol::keys::kSession)).toString();
+    if (m_registry && message.contains(QLatin1String(protocol::keys::kResumeFrom))) {
+        const double seq = message.value(QLatin1String(protocol::keys::kResumeFrom)).toDouble(-1.0);
+        if (seq >= 0.0) {
+            resumeFrom = static_cast<quint64>(seq);
+            resumed = m_registry->canResume(session, resumeFrom);
+        }
+    }
+    m_session = resumed ? session : QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    m_handshakeComplete = true;
+    m_clientName = message.value(QLatin1String(protocol::keys::kClientName)).toString();
+    if (m_probe) {
+        qInfo() << "qt-spy probe attached client" << (m_clientName.isEmpty() ? QStringLiteral("<unknown>") : m_clientName);
+    }
+    // hello itself stays JSON so the client can read the choice before switching.
+    sendHello(negotiated, compression, resumed);
+    m_encoding = negotiated;
+    m_compressAbove = compression ? m_compressionThreshold : 0;
+
+    if (m_registry) {
+        m_registry->subscribe(this);
+        if (resumed) {
+            m_registry->resume(this, m_session, resumeFrom);
+        } else if (!session.isEmpty()) {
+            m_registry->dropParkedClient(session);
+        }
+    }
+}
+
+void ProbeConnection::handleDetach(const QJsonObject &message)
+{
+    if (!m_handshakeComplete) {
+        sendError(QStringLiteral("invalidState"),
+                  QStringLiteral("Cannot detach before completing attach."));
+        return;
+    }
+
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kGoodbye);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
+        payload[QLatin1String(protocol::keys::kRequestId)] =
+            message.value(QLatin1String(protocol::keys::kRequestId));
+    }
+
+    sendMessage(payload);
+
+    m_handshakeComplete = false;
+    m_encoding = protocol::Encoding::Json;
+    // Walks still in progress are for a client that has left; their slices
+    // must not keep running, or instrumenting objects, on the GUI thread.
+    m_pendingSnapshots.clear();
+    if (m_registry) {
+        m_registry->unsubscribe(this);
+    }
+
+    if (m_socket) {
+        // disconnectFromServer() waits for the socket's buffer, not for ours.
+        for (const OutboundFrame &pending : std::as_const(m_outbound)) {
+            m_socket->write(pending.frame); // a snapshot still encoding is dropped
+        }
+        m_outbound.clear();
+        m_outboundBytes = 0;
+        m_queuedEventBytes = 0;
+        m_socket->flush();
+        m_socket->disconnectFromServer();
+    }
+}
+
+void ProbeConnection::handleSnapshotRequest(const QJsonObject &message)
+{
+    FieldMask mask;
+    QString maskError;
+    if (!parseFieldMask(message, &mask, &maskError)) {
+        sendError(QStringLiteral("invalidRequest"), maskError);
+        return;
+    }
+
+    SnapshotCapture capture;
+    QObject *subtreeRoot = nullptr;
+    const QJsonValue rootIdValue = message.value(QLatin1String(protocol::keys::kRootId));
+    if (!rootIdValue.isUndefined()) {
+        capture.subtreeRootId = protocol::nodeIdFromJson(rootIdValue);
+        if (capture.subtreeRootId == protocol::kInvalidNodeId) {
+            sendError(QStringLiteral("invalidRequest"),
+                      QStringLiteral("snapshotRequest 'rootId' must be a numeric node id."));
+            return;
+        }
+        subtreeRoot = m_registry ? m_registry->objectForId(capture.subtreeRootId) : nullptr;
+        if (!subtreeRoot) {
+            QJsonObject context;
+            context[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(capture.subtreeRootId);
+            sendError(QStringLiteral("unknownNode"),
+                      QStringLiteral("No QObject is tracked with the requested rootId."),
+                      context);
+            return;
+        }
+    }
+    const QJsonValue maxDepthValue = message.value(QLatin1String(protocol::keys::kMaxDepth));
+    if (!maxDepthValue.isUndefined()) {
+        capture.maxDepth = maxDepthValue.toInt(-1);
+        if (capture.maxDepth < 0) {
+            sendError(QStringLiteral("invalidRequest"),
+                      QStringLiteral("snapshotRequest 'maxDepth' must be a non-negative integer."));
+            return;
+        }
+    }
+
+    // A full snapshot is the resync; updates queued after it apply to it. A
+    // subtree does not bring the rest of the client's view back.
+    if (!subtreeRoot) {
+        m_resyncPending = false;
+    }
+
+    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
+        capture.requestId = message.value(QLatin1String(protocol::keys::kRequestId));
+    }
+    if (message.value(QLatin1String(protocol::keys::kChunked)).toBool()) {
+        const int chunkSize = message.value(QLatin1String(protocol::keys::kChunkSize))
+                                  .toInt(protocol::kDefaultSnapshotChunkSize);
+        capture.chunkSize = qBound(1, chunkSize, protocol::kMaxSnapshotChunkSize);
+    }
+
+    SnapshotWalk walk;
+    QElapsedTimer timer;
+    timer.start();
+    beginSnapshot(subtreeRoot, &capture, &walk);
+    const bool done = !m_registry
+                      || m_registry->continueCapture(&walk, mask, &capture, m_snapshotBudgetNs);
+    const qint64 captureNs = timer.nsecsElapsed();
+
+    if (!done) {
+        // The rest is walked in later event-loop passes. The placeholder keeps
+        // the reply ahead of updates queued meanwhile, which bring the
+        // snapshot up to date with changes made while it was being walked.
+        PendingSnapshot pending;
+        pending.walkId = m_nextWalkId++;
+        pending.mask = mask;
+        pending.capture = std::move(capture);
+        pending.walk = std::move(walk);
+        pending.captureNs = captureNs;
+        OutboundFrame placeholder;
+        placeholder.pendingWalk = pending.walkId;
+        m_outbound.append(placeholder);
+        m_pendingSnapshots.append(std::move(pending));
+        scheduleSnapshotSlice();
+        return;
+    }
+
+    m_lastSnapshotCaptureNs = captureNs;
+    m_lastSnapshotSlices = walk.slices;
+    m_snapshotCaptureLatency.record(captureNs);
+    submitSnapshot(std::move(capture), 0);
+}
+
+void ProbeConnection::handleStatsRequest(const QJsonObject &message)
+{
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kStats);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
+        payload[QLatin1String(protocol::keys::kRequestId)] =
+            message.value(QLatin1String(protocol::keys::kRequestId));
+    }
+    payload[QLatin1String(protocol::keys::kStats)] =
+        statsToJson(m_probe ? m_probe->stats() : ProbeStats());
+    sendMessage(payload);
+}
+
+void ProbeConnection::handlePropertiesRequest(const QJsonObject &message)
+{
+    const NodeId id = protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId)));
+    if (id == protocol::kInvalidNodeId) {
+        sendError(QStringLiteral("invalidRequest"),
+                  QStringLiteral("propertiesRequest requires a numeric 'id'."));
+        return;
+    }
+
+    FieldMask mask;
+    QString maskError;
+    if (!parseFieldMask(message, &mask, &maskError)) {
+        sendError(QStringLiteral("invalidRequest"), maskError);
+        return;
+    }
+
+    QObject *object = m_registry ? m_registry->objectForId(id) : nullptr;
+    if (!object) {
+        QJsonObject context;
+        context[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+        sendError(QStringLiteral("unknownNode"),
+                  QStringLiteral("No QObject is tracked with the requested id."),
+                  context);
+        return;
+    }
+
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kProperties);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    payload[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+    payload[QLatin1String(protocol::keys::kProperties)] = m_registry->serializeProperties(object, mask);
+    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
+        payload[QLatin1String(protocol::keys::kRequestId)] =
+            message.value(QLatin1String(protocol::keys::kRequestId));
+    }
+    sendMessage(payload);
+}
+
+void ProbeConnection::handleSelectNode(const QJsonObject &message)
+{
+    const NodeId id = protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId)));
+    if (id == protocol::kInvalidNodeId) {
+        sendError(QStringLiteral("invalidRequest"),
+                  QStringLiteral("selectNode requires a numeric 'id'."));
+        return;
+    }
+
+    QObject *object = m_registry ? m_registry->objectForId(id) : nullptr;
+    if (!object) {
+        QJsonObject context;
+        context[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+        sendError(QStringLiteral("unknownNode"),
+                  QStringLiteral("Cannot select an unknown node."),
+                  context);
+        return;
+    }
+
+    m_selectedId = id;
+
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSelectionAck);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    payload[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
+        payload[QLatin1String(protocol::keys::kRequestId)] =
+            message.value(QLatin1String(protocol::keys::kRequestId));
+    }
+    sendMessage(payload);
+}
+
+void ProbeConnection::handleSubscribe(const QJsonObject &message, bool subscribe)
+{
+    const QJsonArray idValues = message.value(QLatin1String(protocol::keys::kIds)).toArray();
+    QVector<NodeId> ids;
+    ids.reserve(idValues.size());
+    for (const QJsonValue &value : idValues) {
+        const NodeId id = protocol::nodeIdFromJson(value);
+        if (id == protocol::kInvalidNodeId) {
+            ids.clear();
+            break;
+        }
+        ids.append(id);
+    }
+    if (ids.isEmpty()) {
+        sendError(QStringLiteral("invalidRequest"),
+                  QStringLiteral("'%1' requires a non-empty array of numeric 'ids'.")
+                      .arg(message.value(QLatin1String(protocol::keys::kType)).toString()));
+        return;
+    }
+
+    FieldMask mask;
+    QString maskError;
+    if (!parseFieldMask(message, &mask, &maskError)) {
+        sendError(QStringLiteral("invalidRequest"), maskError);
+        return;
+    }
+
+    double maxRateHz = -1.0; // the probe's default
+    const QJsonValue rateValue = message.value(QLatin1String(protocol::keys::kMaxRateHz));
+    if (subscribe && !rateValue.isUndefined()) {
+        if (!rateValue.isDouble() || !(rateValue.toDouble() >= 0.0)) {
+            sendError(QStringLiteral("invalidRequest"),
+                      QStringLiteral("'maxRateHz' must be a non-negative number."));
+            return;
+        }
+        maxRateHz = rateValue.toDouble();
+    }
+
+    QJsonArray applied;
+    QJsonArray unknown;
+    for (const NodeId id : std::as_const(ids)) {
+        if (!subscribe) {
+            if (m_registry) {
+                m_registry->unsubscribeProperties(this, id);
+            }
+            applied.append(protocol::nodeIdToJson(id));
+        } else if (m_registry && m_registry->subscribeProperties(this, id, mask.propertyNames, maxRateHz)) {
+            applied.append(protocol::nodeIdToJson(id));
+        } else {
+            unknown.append(protocol::nodeIdToJson(id));
+        }
+    }
+
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSubscriptionAck);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    payload[QLatin1String(protocol::keys::kIds)] = applied;
+    if (!unknown.isEmpty()) {
+        payload[QLatin1String(protocol::keys::kUnknownIds)] = unknown;
+    }
+    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
+        payload[QLatin1String(protocol::keys::kRequestId)] =
+            message.value(QLatin1String(protocol::keys::kRequestId));
+    }
+    sendMessage(payload);
+}
+
+void ProbeConnection::sendMessage(const QJsonObject &message)
+{
+    enqueueFrame(encodeOutgoingFrame(message, m_encoding, m_compressAbove, m_compression.get()),
+                 message.value(QLatin1String(protocol::keys::kType)).toString(), false);
+}
+
+void ProbeConnection::sendError(const QString &code, const QString &text, const QJsonObject &context)
+{
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kError);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    payload[QStringLiteral("code")] = code;
+    payload[QStringLiteral("message")] = text;
+    if (!context.isEmpty()) {
+        payload[QStringLiteral("context")] = context;
+    }
+    if (!m_requestId.isUndefined()) {
+        payload[QLatin1String(protocol::keys::kRequestId)] = m_requestId;
+    }
+    sendMessage(payload);
+}
+
+void ProbeConnection::sendHello(protocol::Encoding encoding, bool compression, bool resumed)
+{
+    QJsonObject payload;
+    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kHello);
+    payload[QLatin1String(protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    payload[QStringLiteral("protocolVersion")] = qt_spy::protocol::kVersion;
+    payload[QLatin1String(protocol::keys::kServerName)] =
+        m_probe ? m_probe->serverName() : QString();
+    payload[QLatin1String(protocol::keys::kApplicationPid)] =
+        static_cast<qint64>(QCoreApplication::applicationPid());
+    payload[QLatin1String(protocol::keys::kApplicationName)] =
+        QCoreApplication::applicationName();
+    payload[QLatin1String(protocol::keys::kEncoding)] = protocol::encodingName(encoding);
+    if (compression) {
+        payload[QLatin1String(protocol::keys::kCompression)] =
+            QLatin1String(protocol::compressions::kZlib);
+    }
+    payload[QLatin1String(protocol::keys::kSession)] = m_session;
+    payload[QLatin1String(protocol::keys::kResumed)] = resumed;
+    sendMessage(payload);
+}
+
+void ProbeConnection::beginSnapshot(QObject *subtreeRoot, SnapshotCapture *capture,
+                                    SnapshotWalk *walk)
+{
+    capture->timestampMs = static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    capture->serverName = m_probe ? m_probe->serverName() : QString();
+    capture->selection = m_selectedId;
+    capture->encoding = m_encoding;
+    capture->compressAbove = m_compressAbove;
+    capture->compression = m_compression;
+    if (m_registry) {
+        capture->seq = m_registry->lastSequence();
+        m_registry->beginCapture(subtreeRoot, walk);
+    }
+}
+
+void ProbeConnection::submitSnapshot(SnapshotCapture capture, quint64 walkId)
+{
+    int placeholder = -1;
+    for (int i = 0; walkId != 0 && i < m_outbound.size(); ++i) {
+        if (m_outbound.at(i).pendingWalk == walkId) {
+            placeholder = i;
+            break;
+        }
+    }
+
+    if (m_encoder) {
+        // Holds this reply's place in the queue until the encoder is done, so
+        // updates captured after the snapshot still arrive after it.
+        const quint64 job = m_encoder->submit(std::move(capture));
+        if (placeholder >= 0) {
+            m_outbound[placeholder].pendingWalk = 0;
+            m_outbound[placeholder].pendingJob = job;
+        } else {
+            OutboundFrame pending;
+            pending.pendingJob = job;
+            m_outbound.append(pending);
+        }
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<QByteArray> frames = encodeSnapshot(capture);
+    m_lastSnapshotEncodeNs = timer.nsecsElapsed();
+    m_snapshotEncodeLatency.record(m_lastSnapshotEncodeNs);
+    const QString type = QLatin1String(protocol::types::kSnapshot);
+    if (placeholder >= 0) {
+        replacePlaceholder(placeholder, frames, type);
+        return;
+    }
+    for (const QByteArray &frame : frames) {
+        enqueueFrame(frame, type, false);
+    }
+}
+
+void ProbeConnection::replacePlaceholder(int index, const QVector<QByteArray> &frames,
+                                         const QString &type)
+{
+    m_outbound.removeAt(index);
+    for (const QByteArray &frame : frames) {
+        m_outbound.insert(index++, {frame, type, false, {}, 0});
+        m_outboundBytes += frame.size();
+    }
+    drainOutbound();
+}
+
+void ProbeConnection::scheduleSnapshotSlice()
+{
+    if (m_sliceScheduled) {
+        return;
+    }
+    m_sliceScheduled = true;
+    QMetaObject::invokeMethod(this, &ProbeConnection::resumeSnapshots, Qt::QueuedConnection);
+}
+
+void ProbeConnection::resumeSnapshots()
+{
+    m_sliceScheduled = false;
+    if (!m_handshakeComplete || m_pendingSnapshots.isEmpty()) {
+        return;
+    }
+
+    // One slice per event-loop pass, so the host gets to paint in between.
+    PendingSnapshot &pending = m_pendingSnapshots.first();
+    QElapsedTimer timer;
+    timer.start();
+    const bool done = !m_registry
+                      || m_registry->continueCapture(&pending.walk, pending.mask,
+                                                     &pending.capture, m_snapshotBudgetNs);
+    pending.captureNs += timer.nsecsElapsed();
+
+    if (done) {
+        PendingSnapshot finished = m_pendingSnapshots.takeFirst();
+        m_lastSnapshotCaptureNs = finished.captureNs;
+        m_snapshotCaptureLatency.record(finished.captureNs);
+        m_lastSnapshotSlices = finished.walk.slices;
+        submitSnapshot(std::move(finished.capture), finished.walkId);
+    }
+    if (!m_pendingSnapshots.isEmpty()) {
+        scheduleSnapshotSlice();
+    }
+}
+
+void ProbeConnection::resetConnectionState()
+{
+    // Reset connection-specific state without cleaning up tracked objects
+    // This allows injected probes to handle new connections gracefully
+    m_handshakeComplete = false;
+    m_session.clear();
+    m_encoding = protocol::Encoding::Json;
+    m_compressAbove = 0;
+    m_selectedId = protocol::kInvalidNodeId;
+    m_reader.clear();
+    m_outbound.clear();
+    m_outboundBytes = 0;
+    m_queuedEventBytes = 0;
+    m_resyncPending = false;
+    m_pendingSnapshots.clear();
 }
 
-void ProbeConnection::onReadyRead()
+ObjectRegistry::ObjectRegistry(Probe *probe, const ProbeOptions &options)
+    : QObject(probe)
+    , m_probe(probe)
+    , m_lazyAttach(options.lazyAttach)
+    , m_propertyLayoutCache(options.propertyLayoutCache)
+    , m_defaultMaxRateHz(options.maxNotifyRateHz)
+    , m_discoveryFlush(this)
+    , m_propertyFlush(this)
+    , m_rateLimitRelease(this)
+    , m_resumeWindowMs(qMax(0, options.resumeWindowMs))
+    , m_resumeWindow(this)
+    , m_journalCapacity(qMax(0, options.eventJournalSize))
 {
-    if (!m_socket) {
-        return;
-    }
+    m_discoveryFlush.setInterval(0);
+    m_discoveryFlush.setSingleShot(true);
+    connect(&m_discoveryFlush, &QTimer::timeout, this, &ObjectRegistry::refreshTopLevelObjects);
 
-    m_readBuffer += m_socket->readAll();
-    processBuffer();
+    m_propertyFlush.setInterval(0);
+    m_propertyFlush.setSingleShot(true);
+    connect(&m_propertyFlush, &QTimer::timeout, this, &ObjectRegistry::flushPropertiesChanged);
+
+    m_rateLimitRelease.setSingleShot(true);
+    m_rateLimitRelease.setTimerType(Qt::PreciseTimer);
+    connect(&m_rateLimitRelease, &QTimer::timeout, this, &ObjectRegistry::releaseRateLimited);
+    m_rateClock.start();
+
+    m_resumeWindow.setSingleShot(true);
+    connect(&m_resumeWindow, &QTimer::timeout, this, &ObjectRegistry::expireParkedClients);
 }
 
-void ProbeConnection::onDisconnected()
+ObjectRegistry::~ObjectRegistry()
 {
-    m_topLevelPoll.stop();
+    stopDiscovery();
     
-    // For injected probes, avoid cleanup entirely to prevent interference with host application
+    // For injected probes, avoid cleanup in destructor to prevent interference with host application
     const bool isLikelyInjected = (m_probe && m_probe->parent() == QCoreApplication::instance());
     
     if (!isLikelyInjected) {
         // Only cleanup for non-injected probes (tests, etc.)
         cleanup();
     }
-    // For injected probes, just stop polling and emit closed - no cleanup
-    
-    emit closed(this);
 }
 
-void ProbeConnection::handlePropertyNotify()
+void ObjectRegistry::subscribe(ProbeConnection *connection)
 {
-    QObject *object = sender();
-    if (!object) {
+    if (!connection || m_subscribers.contains(connection)) {
         return;
     }
 
-    const int signalIndex = senderSignalIndex();
-    const auto key = qMakePair(static_cast<const QObject *>(object), signalIndex);
-    const QString propertyName = m_propertyBySignalIndex.value(key);
-    if (propertyName.isEmpty()) {
-        emitPropertiesChanged(object, {});
-    } else {
-        emitPropertiesChanged(object, {propertyName});
+    m_subscribers.append(connection);
+    if (m_subscribers.size() > 1 || !m_parkedClients.isEmpty()) {
+        return; // tracking is already running
+    }
+
+    // Full walk once when tracking starts (only the roots with lazy attach);
+    // afterwards only watcher-reported objects are visited, however many
+    // clients attach.
+    for (QObject *root : collectRoots()) {
+        installRecursive(root, ObjectTable::kNoSlot, false, installDepth());
     }
+    startDiscovery();
 }
 
-void ProbeConnection::onObjectDestroyed(QObject *object)
+void ObjectRegistry::unsubscribe(ProbeConnection *connection, bool resumable)
 {
-    if (!object) {
+    if (!m_subscribers.removeOne(connection)) {
+        return;
+    }
+    if (resumable && m_journalCapacity > 0 && m_resumeWindowMs > 0
+        && !connection->session().isEmpty()) {
+        parkPropertySubscriptions(connection);
+        return;
+    }
+    dropPropertySubscriptions(connection);
+    if (!m_subscribers.isEmpty() || !m_parkedClients.isEmpty()) {
         return;
     }
 
-    removeRecursive(object, true);
+    // cleanup() is passive for injected probes and leaves the host untouched.
+    cleanup();
+}
+
+void ObjectRegistry::expireParkedClients()
+{
+    QStringList expired;
+    qint64 nextMs = -1;
+    for (auto it = m_parkedClients.cbegin(); it != m_parkedClients.cend(); ++it) {
+        if (it->deadline.hasExpired()) {
+            expired.append(it.key());
+            continue;
+        }
+        const qint64 remainingMs = it->deadline.remainingTime();
+        if (nextMs < 0 || remainingMs < nextMs) {
+            nextMs = remainingMs;
+        }
+    }
+    for (const QString &session : std::as_const(expired)) {
+        dropParkedClient(session);
+    }
 
-    const QString id = m_idsByObject.take(object);
-    if (!id.isEmpty()) {
-        m_objectById.remove(id);
+    if (nextMs >= 0) {
+        m_resumeWindow.start(static_cast<int>(nextMs));
+        return;
+    }
+    if (m_subscribers.isEmpty()) {
+        cleanup();
     }
 }
 
-void ProbeConnection::processBuffer()
+quint64 ObjectRegistry::lastSequence() const
 {
-    while (m_readBuffer.size() >= 4) {
-        const quint32 length = qFromBigEndian<quint32>(
-            reinterpret_cast<const uchar *>(m_readBuffer.constData()));
-        if (m_readBuffer.size() < static_cast<int>(length) + 4) {
-            break;
-        }
+    return m_lastSeq;
+}
+
+bool ObjectRegistry::canResume(const QString &session, quint64 seq) const
+{
+    return m_parkedClients.contains(session) && seq >= m_journalFloor && seq <= m_lastSeq;
+}
 
-        QByteArray payload = m_readBuffer.mid(4, static_cast<int>(length));
-        m_readBuffer.remove(0, static_cast<int>(length) + 4);
+void ObjectRegistry::resume(ProbeConnection *connection, const QString &session, quint64 seq)
+{
+    const ParkedClient parked = m_parkedClients.take(session);
 
-        QJsonParseError parseError{};
-        const QJsonDocument document = QJsonDocument::fromJson(payload, &parseError);
-        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
-            sendError(QStringLiteral("invalidJson"),
-                      QStringLiteral("Unable to parse message: %1").arg(parseError.errorString()));
+    // Changes are narrowed as they would have been had the client stayed.
+    const QLatin1String changesKey(protocol::keys::kChanges);
+    for (const JournalEntry &entry : std::as_const(m_journal)) {
+        if (entry.seq <= seq) {
             continue;
         }
+        QJsonObject message = entry.message;
+        if (message.value(QLatin1String(protocol::keys::kType)).toString()
+            == QLatin1String(protocol::types::kPropertiesChanged)) {
+            QJsonArray own;
+            const QJsonArray changes = message.value(changesKey).toArray();
+            for (const QJsonValue &value : changes) {
+                const QJsonObject change = value.toObject();
+                const auto subscription = parked.subscriptions.constFind(
+                    protocol::nodeIdFromJson(change.value(QLatin1String(protocol::keys::kId))));
+                if (subscription == parked.subscriptions.constEnd()) {
+                    continue;
+                }
+                if (subscription->names.isEmpty()) {
+                    own.append(change);
+                    continue;
+                }
+                const QJsonObject projected = projectPropertyChange(change, subscription->names);
+                if (!projected.isEmpty()) {
+                    own.append(projected);
+                }
+            }
+            if (own.isEmpty()) {
+                continue;
+            }
+            message.insert(changesKey, own);
+        }
+        connection->sendEvent(message, encodeOutgoingFrame(message, connection->encoding(),
+                                                           connection->compressAbove(),
+                                                           m_compression.get()));
+    }
 
-        handleMessage(document.object());
+    // The client carries on with the subscriptions it had.
+    for (auto it = parked.subscriptions.cbegin(); it != parked.subscriptions.cend(); ++it) {
+        subscribeProperties(connection, it.key(), it->names, it->maxRateHz);
+        refreshParkedSubscription(it.key());
     }
 }
 
-void ProbeConnection::handleMessage(const QJsonObject &message)
+void ObjectRegistry::recordEvent(QJsonObject *message)
 {
-    const QString type = message.value(QLatin1String(protocol::keys::kType)).toString();
-    if (type.isEmpty()) {
-        sendError(QStringLiteral("invalidMessage"), QStringLiteral("Message missing 'type'."));
+    message->insert(QLatin1String(protocol::keys::kSeq), static_cast<qint64>(++m_lastSeq));
+    if (m_journalCapacity <= 0) {
+        m_journalFloor = m_lastSeq;
         return;
     }
-
-    if (!m_handshakeComplete && type != QLatin1String(protocol::types::kAttach)) {
-        sendError(QStringLiteral("handshakeRequired"),
-                  QStringLiteral("Must attach before sending '%1'.").arg(type));
-        return;
+    while (m_journal.size() >= m_journalCapacity) {
+        m_journalFloor = m_journal.dequeue().seq;
     }
+    m_journal.enqueue({m_lastSeq, *message});
+}
 
-    if (type == QLatin1String(protocol::types::kAttach)) {
-        handleAttach(message);
-    } else if (type == QLatin1String(protocol::types::kSnapshotRequest)) {
-        handleSnapshotRequest(message);
-    } else if (type == QLatin1String(protocol::types::kPropertiesRequest)) {
-        handlePropertiesRequest(message);
-    } else if (type == QLatin1String(protocol::types::kSelectNode)) {
-        handleSelectNode(message);
-    } else if (type == QLatin1String(protocol::types::kDetach)) {
-        handleDetach(message);
-    } else {
-        sendError(QStringLiteral("unknownMessage"),
-                  QStringLiteral("Unknown message type '%1'.").arg(type));
-    }
+QObject *ObjectRegistry::objectForId(NodeId id) const
+{
+    const int slot = m_table.slotOfId(id);
+    return slot != ObjectTable::kNoSlot ? m_table.object(slot) : nullptr;
 }
 
-void ProbeConnection::handleAttach(const QJsonObject &message)
+NodeId ObjectRegistry::parentIdOf(int slot) const
 {
-    if (m_handshakeComplete) {
-        sendError(QStringLiteral("alreadyAttached"),
-                  QStringLiteral("Attach has already been completed."));
-        return;
+    const int parentSlot = m_table.parent(slot);
+    return parentSlot != ObjectTable::kNoSlot ? m_table.id(parentSlot) : protocol::kInvalidNodeId;
+}
+
+bool ObjectRegistry::subscribeProperties(ProbeConnection *connection, NodeId id,
+                                         const QSet<QString> &names, double maxRateHz)
+{
+    const int slot = m_table.slotOfId(id);
+    if (slot == ObjectTable::kNoSlot || !m_table.object(slot)
+        || !m_table.hasFlag(slot, ObjectTable::Tracked)) {
+        return false;
     }
 
-    const int clientVersion =
-        message.value(QLatin1String(protocol::keys::kProtocolVersion)).toInt(-1);
-    if (clientVersion != qt_spy::protocol::kVersion) {
-        QJsonObject context;
-        context[QStringLiteral("serverVersion")] = qt_spy::protocol::kVersion;
-        context[QStringLiteral("clientVersion")] = clientVersion;
-        sendError(QStringLiteral("protocolMismatch"),
-                  QStringLiteral("Protocol mismatch between client and helper."),
-                  context);
-        if (m_socket) {
-            m_socket->disconnectFromServer();
+    auto &subscribers = m_propertySubscriptions[id];
+    if (subscribers.isEmpty()) {
+        // Injected probes never connect to the host's signals.
+        const bool isLikelyInjected = (m_probe && m_probe->parent() == QCoreApplication::instance());
+        if (!isLikelyInjected) {
+            observeProperties(slot);
         }
-        return;
     }
 
-    m_handshakeComplete = true;
-    if (m_probe) {
-        const QString clientName =
-            message.value(QLatin1String(protocol::keys::kClientName)).toString();
-        qInfo() << "qt-spy probe attached client" << (clientName.isEmpty() ? QStringLiteral("<unknown>") : clientName);
+    auto existing = subscribers.find(connection);
+    if (existing == subscribers.end()) {
+        existing = subscribers.insert(connection, {names, 0.0});
+    } else if (existing->names.isEmpty() || names.isEmpty()) {
+        existing->names.clear(); // all properties
+    } else {
+        existing->names.unite(names);
     }
-    sendHello();
-
-    ensureRootsTracked(false);
-    m_topLevelPoll.start();
+    existing->maxRateHz = maxRateHz < 0.0 ? m_defaultMaxRateHz : maxRateHz;
+    return true;
 }
 
-void ProbeConnection::handleDetach(const QJsonObject &message)
+void ObjectRegistry::unsubscribeProperties(ProbeConnection *connection, NodeId id)
 {
-    if (!m_handshakeComplete) {
-        sendError(QStringLiteral("invalidState"),
-                  QStringLiteral("Cannot detach before completing attach."));
+    auto it = m_propertySubscriptions.find(id);
+    if (it == m_propertySubscriptions.end() || !it.value().remove(connection)) {
         return;
     }
-
-    QJsonObject payload;
-    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kGoodbye);
-    payload[QLatin1String(protocol::keys::kTimestampMs)] =
-        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
-        payload[QLatin1String(protocol::keys::kRequestId)] =
-            message.value(QLatin1String(protocol::keys::kRequestId));
-    }
-
-    sendMessage(payload);
-
-    m_handshakeComplete = false;
-    m_topLevelPoll.stop();
-    
-    // For injected probes, avoid cleanup entirely to prevent interference with host application
-    const bool isLikelyInjected = (m_probe && m_probe->parent() == QCoreApplication::instance());
-    
-    if (!isLikelyInjected) {
-        // Only cleanup for non-injected probes (tests, etc.)
-        cleanup();
+    if (!it.value().isEmpty()) {
+        return;
     }
-    // For injected probes, just disconnect without cleanup - leave everything intact
-
-    if (m_socket) {
-        m_socket->flush();
-        m_socket->disconnectFromServer();
+    m_propertySubscriptions.erase(it);
+    const int slot = m_table.slotOfId(id);
+    if (slot != ObjectTable::kNoSlot) {
+        unobserveProperties(slot);
+        m_rateWindows.remove(m_table.key(slot));
     }
 }
 
-void ProbeConnection::handleSnapshotRequest(const QJsonObject &message)
+void ObjectRegistry::parkPropertySubscriptions(ProbeConnection *connection)
 {
-    QJsonObject payload = buildSnapshotPayload();
-    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
-        payload[QLatin1String(protocol::keys::kRequestId)] =
-            message.value(QLatin1String(protocol::keys::kRequestId));
+    ParkedClient &parked = m_parkedClients[connection->session()];
+    parked.subscriptions.clear();
+    parked.deadline.setRemainingTime(m_resumeWindowMs);
+    for (auto it = m_propertySubscriptions.cbegin(); it != m_propertySubscriptions.cend(); ++it) {
+        const auto found = it.value().constFind(connection);
+        if (found != it.value().constEnd()) {
+            parked.subscriptions.insert(it.key(), found.value());
+        }
     }
-    sendMessage(payload);
-}
-
-void ProbeConnection::handlePropertiesRequest(const QJsonObject &message)
-{
-    const QString id = message.value(QLatin1String(protocol::keys::kId)).toString();
-    if (id.isEmpty()) {
-        sendError(QStringLiteral("invalidRequest"),
-                  QStringLiteral("propertiesRequest requires an 'id'."));
-        return;
+    // The parked entry goes in first, so the node keeps a subscriber and its
+    // notify connections stay as they are.
+    const QList<NodeId> parkedIds = parked.subscriptions.keys();
+    for (const NodeId id : parkedIds) {
+        refreshParkedSubscription(id);
+        m_propertySubscriptions[id].remove(connection);
     }
 
-    const auto object = m_objectById.value(id);
-    if (object.isNull()) {
-        QJsonObject context;
-        context[QLatin1String(protocol::keys::kId)] = id;
-        sendError(QStringLiteral("unknownNode"),
-                  QStringLiteral("No QObject is tracked with the requested id."),
-                  context);
-        return;
+    if (!m_resumeWindow.isActive() || m_resumeWindow.remainingTime() > m_resumeWindowMs) {
+        m_resumeWindow.start(m_resumeWindowMs);
     }
+}
 
-    QJsonObject payload;
-    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kProperties);
-    payload[QLatin1String(protocol::keys::kTimestampMs)] =
-        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QLatin1String(protocol::keys::kId)] = id;
-    payload[QLatin1String(protocol::keys::kProperties)] = serializeProperties(object.data());
-    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
-        payload[QLatin1String(protocol::keys::kRequestId)] =
-            message.value(QLatin1String(protocol::keys::kRequestId));
+void ObjectRegistry::dropParkedClient(const QString &session)
+{
+    const ParkedClient parked = m_parkedClients.take(session);
+    for (auto it = parked.subscriptions.cbegin(); it != parked.subscriptions.cend(); ++it) {
+        refreshParkedSubscription(it.key());
     }
-    sendMessage(payload);
 }
 
-void ProbeConnection::handleSelectNode(const QJsonObject &message)
+void ObjectRegistry::refreshParkedSubscription(NodeId id)
 {
-    const QString id = message.value(QLatin1String(protocol::keys::kId)).toString();
-    if (id.isEmpty()) {
-        sendError(QStringLiteral("invalidRequest"),
-                  QStringLiteral("selectNode requires an 'id'."));
-        return;
+    // Everything any parked client asked for on id, at the highest rate.
+    bool found = false;
+    PropertySubscription merged;
+    for (const ParkedClient &parked : std::as_const(m_parkedClients)) {
+        const auto subscription = parked.subscriptions.constFind(id);
+        if (subscription == parked.subscriptions.constEnd()) {
+            continue;
+        }
+        if (!found) {
+            merged = subscription.value();
+            found = true;
+            continue;
+        }
+        if (merged.names.isEmpty() || subscription->names.isEmpty()) {
+            merged.names.clear();
+        } else {
+            merged.names.unite(subscription->names);
+        }
+        if (merged.maxRateHz > 0.0) {
+            merged.maxRateHz = subscription->maxRateHz > 0.0
+                                   ? qMax(merged.maxRateHz, subscription->maxRateHz)
+                                   : 0.0;
+        }
     }
 
-    const auto object = m_objectById.value(id);
-    if (object.isNull()) {
-        QJsonObject context;
-        context[QLatin1String(protocol::keys::kId)] = id;
-        sendError(QStringLiteral("unknownNode"),
-                  QStringLiteral("Cannot select an unknown node."),
-                  context);
+    if (!found) {
+        unsubscribeProperties(kParkedSubscriber, id);
         return;
     }
-
-    m_selectedId = id;
-
-    QJsonObject payload;
-    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSelectionAck);
-    payload[QLatin1String(protocol::keys::kTimestampMs)] =
-        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QLatin1String(protocol::keys::kId)] = id;
-    if (message.contains(QLatin1String(protocol::keys::kRequestId))) {
-        payload[QLatin1String(protocol::keys::kRequestId)] =
-            message.value(QLatin1String(protocol::keys::kRequestId));
+    const auto subscribers = m_propertySubscriptions.find(id);
+    if (subscribers != m_propertySubscriptions.end()) { // gone with its node otherwise
+        subscribers->insert(kParkedSubscriber, merged);
     }
-    sendMessage(payload);
 }
 
-void ProbeConnection::sendMessage(const QJsonObject &message)
+void ObjectRegistry::dropPropertySubscriptions(ProbeConnection *connection)
 {
-    if (!m_socket) {
-        return;
+    QVector<NodeId> subscribedIds;
+    for (auto it = m_propertySubscriptions.cbegin(); it != m_propertySubscriptions.cend(); ++it) {
+        if (it.value().contains(connection)) {
+            subscribedIds.append(it.key());
+        }
+    }
+    for (const NodeId id : std::as_const(subscribedIds)) {
+        unsubscribeProperties(connection, id);
     }
-
-    QJsonDocument document(message);
-    const QByteArray payload = document.toJson(QJsonDocument::Compact);
-
-    QByteArray frame;
-    frame.resize(4);
-    qToBigEndian(static_cast<quint32>(payload.size()), reinterpret_cast<uchar *>(frame.data()));
-    frame.append(payload);
-
-    m_socket->write(frame);
-    m_socket->flush();
 }
 
-void ProbeConnection::sendError(const QString &code, const QString &text, const QJsonObject &context)
+void ObjectRegistry::broadcast(QJsonObject message)
 {
-    QJsonObject payload;
-    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kError);
-    payload[QLatin1String(protocol::keys::kTimestampMs)] =
-        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QStringLiteral("code")] = code;
-    payload[QStringLiteral("message")] = text;
-    if (!context.isEmpty()) {
-        payload[QStringLiteral("context")] = context;
+    recordEvent(&message);
+
+    // One frame per encoding and compression in use, shared by every
+    // subscriber that negotiated it.
+    QByteArray frames[4];
+    for (ProbeConnection *connection : std::as_const(m_subscribers)) {
+        QByteArray &frame = sharedFrameSlot(frames, connection);
+        if (frame.isEmpty()) {
+            frame = encodeOutgoingFrame(message, connection->encoding(),
+                                        connection->compressAbove(), m_compression.get());
+        }
+        connection->sendEvent(message, frame);
     }
-    sendMessage(payload);
 }
 
-void ProbeConnection::sendHello()
+QByteArray &ObjectRegistry::sharedFrameSlot(QByteArray (&frames)[4],
+                                            const ProbeConnection *connection)
 {
-    QJsonObject payload;
-    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kHello);
-    payload[QLatin1String(protocol::keys::kTimestampMs)] =
-        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QStringLiteral("protocolVersion")] = qt_spy::protocol::kVersion;
-    payload[QLatin1String(protocol::keys::kServerName)] =
-        m_probe ? m_probe->serverName() : QString();
-    payload[QLatin1String(protocol::keys::kApplicationPid)] =
-        static_cast<qint64>(QCoreApplication::applicationPid());
-    payload[QLatin1String(protocol::keys::kApplicationName)] =
-        QCoreApplication::applicationName();
-    sendMessage(payload);
+    const int encoding = connection->encoding() == protocol::Encoding::Cbor ? 2 : 0;
+    return frames[encoding + (connection->compressAbove() > 0 ? 1 : 0)];
 }
 
-QJsonObject ProbeConnection::buildSnapshotPayload()
+bool ObjectRegistry::eventFilter(QObject *watched, QEvent *event)
 {
-    const QVector<QObject *> roots = ensureRootsTracked(false);
-
-    QSet<const QObject *> visited;
-    QJsonArray nodes;
-    QJsonArray rootIds;
+    ScopedLatency timing(&m_stats.eventFilterLatency);
+    if (!watched || !event) {
+        return QObject::eventFilter(watched, event);
+    }
 
-    std::function<void(QObject *, const QString &)> visit = [&](QObject *object, const QString &parentId) {
-        if (!object || visited.contains(object)) {
-            return;
+    switch (event->type()) {
+    case QEvent::ChildAdded: {
+        auto *childEvent = static_cast<QChildEvent *>(event);
+        if (!childEvent->added()) {
+            break;
         }
-        visited.insert(object);
-
-        const QString id = ensureIdForObject(object);
-        if (parentId.isEmpty()) {
-            rootIds.append(id);
+        if (QObject *child = childEvent->child()) {
+            // Deferred: the child is still being constructed at this point.
+            markDiscoveryCandidate(child);
         }
-
-        nodes.append(serializeNode(object, parentId));
-
-        const QList<QObject *> children = object->children();
-        for (QObject *child : children) {
-            visit(child, id);
+        break;
+    }
+    case QEvent::ChildRemoved: {
+        auto *childEvent = static_cast<QChildEvent *>(event);
+        QObject *child = childEvent->child();
+        if (!child) {
+            break;
         }
-    };
-
-    for (QObject *root : roots) {
-        visit(root, QString());
+        removeRecursive(child, true);
+        break;
     }
-
-    QJsonObject payload;
-    payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSnapshot);
-    payload[QLatin1String(protocol::keys::kTimestampMs)] =
-        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QStringLiteral("protocolVersion")] = qt_spy::protocol::kVersion;
-    payload[QLatin1String(protocol::keys::kServerName)] =
-        m_probe ? m_probe->serverName() : QString();
-    payload[QLatin1String(protocol::keys::kNodes)] = nodes;
-    payload[QLatin1String(protocol::keys::kRootIds)] = rootIds;
-    if (!m_selectedId.isEmpty()) {
-        payload[QLatin1String(protocol::keys::kSelection)] = m_selectedId;
+    case QEvent::DynamicPropertyChange: {
+        auto *dynamicEvent = static_cast<QDynamicPropertyChangeEvent *>(event);
+        const QByteArray name = dynamicEvent->propertyName();
+        queuePropertiesChanged(watched, {QString::fromUtf8(name)});
+        break;
+    }
+    default:
+        break;
     }
 
-    return payload;
+    return QObject::eventFilter(watched, event);
 }
 
-QJsonObject ProbeConnection::serializeNode(QObject *object, const QString &parentId)
+void ObjectRegistry::handlePropertyNotify()
 {
-    QJsonObject node;
-    const QString id = ensureIdForObject(object);
-
-    node[QLatin1String(protocol::keys::kId)] = id;
-    if (!parentId.isEmpty()) {
-        node[QLatin1String(protocol::keys::kParentId)] = parentId;
+    QObject *object = sender();
+    if (!object) {
+        return;
     }
-    node[QStringLiteral("className")] = QString::fromLatin1(object->metaObject()->className());
-    node[QStringLiteral("objectName")] = object->objectName();
-    node[QStringLiteral("address")] =
-        QStringLiteral("0x%1").arg(quintptr(object), 0, 16, QLatin1Char('0'));
 
-    QJsonArray childrenIds;
-    const QList<QObject *> children = object->children();
-    for (QObject *child : children) {
-        childrenIds.append(ensureIdForObject(child));
+    // The signal-to-property mapping belongs to the class, so nothing per
+    // object has to be looked up or cleaned up for it.
+    const PropertyLayout &layout = propertyLayoutFor(object->metaObject());
+    const QStringList propertyNames = layout.propertiesByNotifySignal.value(senderSignalIndex());
+    if (!propertyNames.isEmpty()) {
+        queuePropertiesChanged(object, propertyNames);
     }
-    if (!childrenIds.isEmpty()) {
-        node[QLatin1String(protocol::keys::kChildIds)] = childrenIds;
+}
+
+void ObjectRegistry::onObjectDestroyed(QObject *object)
+{
+    const int slot = m_table.slotOf(object);
+    if (slot == ObjectTable::kNoSlot) {
+        return;
     }
 
-    if (auto *widget = qobject_cast<QWidget *>(object)) {
-        node[QStringLiteral("widget")] = widgetInfo(widget);
+    // The children die with the object; their slots can go as well.
+    QVector<int> dying{slot};
+    for (int i = 0; i < dying.size(); ++i) {
+        for (int child = m_table.firstChild(dying.at(i)); child != ObjectTable::kNoSlot;
+             child = m_table.nextSibling(child)) {
+            dying.append(child);
+        }
     }
-    if (auto *window = qobject_cast<QWindow *>(object)) {
-        node[QStringLiteral("window")] = windowInfo(window);
+
+    removeSlotRecursive(slot, true);
+    for (const int released : std::as_const(dying)) {
+        m_table.release(released);
     }
+}
 
-    QJsonObject properties = serializeProperties(object);
-    if (!properties.isEmpty()) {
-        node[QLatin1String(protocol::keys::kProperties)] = properties;
+CapturedNode ObjectRegistry::captureNode(QObject *object, NodeId parentId,
+                                         const FieldMask &mask, bool childIds)
+{
+    CapturedNode node;
+    node.id = ensureIdForObject(object);
+    node.parentId = parentId;
+    node.className = object->metaObject()->className();
+    node.objectName = object->objectName();
+    node.address = quintptr(object);
+
+    const QList<QObject *> children = object->children();
+    if (childIds) {
+        node.childIds.reserve(children.size());
+        for (QObject *child : children) {
+            node.childIds.append(ensureIdForObject(child));
+        }
+    } else {
+        node.childCount = children.size();
+    }
+
+    if (mask.geometry) {
+        if (auto *widget = qobject_cast<QWidget *>(object)) {
+            node.surface = CapturedNode::Surface::Widget;
+            node.visible = widget->isVisible();
+            node.enabled = widget->isEnabled();
+            node.title = widget->windowTitle();
+            node.geometry = widget->geometry();
+        } else if (auto *window = qobject_cast<QWindow *>(object)) {
+            node.surface = CapturedNode::Surface::Window;
+            node.visible = window->isVisible();
+            node.title = window->title();
+            node.geometry = window->geometry();
+        }
     }
 
+    captureProperties(object, mask, &node);
     return node;
 }
 
-QJsonObject ProbeConnection::serializeProperties(QObject *object) const
+void ObjectRegistry::captureProperties(QObject *object, const FieldMask &mask,
+                                       CapturedNode *node) const
 {
-    QJsonObject properties;
-    const QMetaObject *meta = object->metaObject();
-    for (int i = 0; i < meta->propertyCount(); ++i) {
-        const QMetaProperty property = meta->property(i);
-        if (!property.isReadable()) {
-            continue;
+    const bool projected = !mask.propertyNames.isEmpty();
+    if (mask.properties && !m_propertyLayoutCache) {
+        const QMetaObject *meta = object->metaObject();
+        for (int i = 0; i < meta->propertyCount(); ++i) {
+            const QMetaProperty metaProperty = meta->property(i);
+            if (!metaProperty.isReadable()) {
+                continue;
+            }
+            const QString key = QString::fromLatin1(metaProperty.name());
+            if (projected && !mask.propertyNames.contains(key)) {
+                continue;
+            }
+            const QVariant value = metaProperty.read(object);
+            if (!value.isValid()) {
+                continue;
+            }
+            CapturedProperty property;
+            property.key = key;
+            property.json = variantToJson(value);
+            node->properties.append(std::move(property));
         }
-        const QVariant value = property.read(object);
-        if (!value.isValid()) {
-            continue;
+    } else if (mask.properties) {
+        const QMetaObject *meta = object->metaObject();
+        const PropertyLayout &layout = propertyLayoutFor(meta);
+        node->properties.reserve(layout.properties.size());
+        for (const PropertyEntry &entry : layout.properties) {
+            if (projected && !mask.propertyNames.contains(entry.key)) {
+                continue;
+            }
+            QVariant value = meta->property(entry.index).read(object);
+            if (!value.isValid()) {
+                continue;
+            }
+            CapturedProperty property;
+            property.key = entry.key;
+            property.converter = entry.converter;
+            // Generic values may reference the object itself; only plain
+            // scalars are left for the encoder thread.
+            if (entry.converter == PropertyConverter::Generic) {
+                property.json = variantToJson(value);
+            } else {
+                property.value = std::move(value);
+            }
+            node->properties.append(std::move(property));
         }
-        properties[QString::fromLatin1(property.name())] = variantToJson(value);
     }
 
-    const auto dynamicNames = object->dynamicPropertyNames();
-    if (!dynamicNames.isEmpty()) {
-        QJsonObject dynamicProps;
-        for (const QByteArray &name : dynamicNames) {
-            const QVariant value = object->property(name.constData());
-            dynamicProps[QString::fromUtf8(name)] = variantToJson(value);
-        }
-        if (!dynamicProps.isEmpty()) {
-            properties[QStringLiteral("__dynamic")] = dynamicProps;
+    const auto dynamicNames = mask.dynamicProperties ? object->dynamicPropertyNames()
+                                                     : QList<QByteArray>();
+    for (const QByteArray &name : dynamicNames) {
+        const QString key = QString::fromUtf8(name);
+        if (projected && !mask.propertyNames.contains(key)) {
+            continue;
         }
+        node->dynamicProperties.append({key, variantToJson(object->property(name.constData()))});
     }
+}
 
-    return properties;
+QJsonObject ObjectRegistry::serializeProperties(QObject *object, const FieldMask &mask)
+{
+    ScopedLatency timing(&m_stats.propertiesLatency);
+    CapturedNode node;
+    captureProperties(object, mask, &node);
+    return propertiesToJson(node);
 }
 
-QString ProbeConnection::ensureIdForObject(const QObject *object)
+NodeId ObjectRegistry::ensureIdForObject(const QObject *object)
 {
     if (!object) {
-        return {};
+        return protocol::kInvalidNodeId;
     }
+    return m_table.id(ensureSlot(object));
+}
 
-    const auto existing = m_idsByObject.constFind(object);
-    if (existing != m_idsByObject.constEnd()) {
-        const QString id = existing.value();
-        m_objectById.insert(id, const_cast<QObject *>(object));
-        return id;
+int ObjectRegistry::ensureSlot(const QObject *object)
+{
+    const int slot = m_table.slotOf(object);
+    if (slot != ObjectTable::kNoSlot) {
+        // The QPointer goes null when the object dies, which tells a live
+        // object apart from a new one that reused its address.
+        if (m_table.object(slot) == object) {
+            return slot;
+        }
+        // Only injected probes, which do not watch destroyed(), get here with
+        // a tracked slot; their removal never touches the dead object.
+        removeSlotRecursive(slot, true);
+        m_table.release(slot);
     }
+    return m_table.add(const_cast<QObject *>(object), m_nextNodeId++);
+}
 
-    const QString id = makeNodeId(object);
-    m_idsByObject.insert(object, id);
-    m_objectById.insert(id, const_cast<QObject *>(object));
-    return id;
+bool ObjectRegistry::isTracked(const QObject *object) const
+{
+    const int slot = m_table.slotOf(object);
+    return slot != ObjectTable::kNoSlot && m_table.object(slot) == object
+           && m_table.hasFlag(slot, ObjectTable::Tracked);
 }
 
-void ProbeConnection::observeProperties(QObject *object)
+void ObjectRegistry::observeProperties(int slot)
 {
+    QObject *object = m_table.object(slot);
     const int slotIndex = metaObject()->indexOfSlot("handlePropertyNotify()");
-    if (slotIndex < 0) {
+    if (!object || slotIndex < 0) {
         return;
     }
 
-    QVector<QMetaObject::Connection> connections;
+    QVector<QMetaObject::Connection> &connections = m_table.connections(slot);
 
-    for (int metaIndex = 0; metaIndex < object->metaObject()->propertyCount(); ++metaIndex) {
-        const QMetaProperty property = object->metaObject()->property(metaIndex);
-        if (!property.hasNotifySignal()) {
-            continue;
-        }
-        const int signalIndex = property.notifySignalIndex();
-        if (signalIndex < 0) {
-            continue;
-        }
-        const auto key = qMakePair(static_cast<const QObject *>(object), signalIndex);
-        if (m_propertyBySignalIndex.contains(key)) {
-            continue;
-        }
+    // One connection per notify signal, however many properties it reports.
+    const PropertyLayout &layout = propertyLayoutFor(object->metaObject());
+    connections.reserve(layout.propertiesByNotifySignal.size());
+    for (auto it = layout.propertiesByNotifySignal.cbegin();
+         it != layout.propertiesByNotifySignal.cend(); ++it) {
         QMetaObject::Connection connection =
-            QMetaObject::connect(object, signalIndex, this, slotIndex);
-        if (!connection) {
-            continue;
+            QMetaObject::connect(object, it.key(), this, slotIndex);
+        if (connection) {
+            connections.append(connection);
         }
-        connections.append(connection);
-        m_propertyBySignalIndex.insert(key, QString::fromLatin1(property.name()));
-    }
-
-    if (!connections.isEmpty()) {
-        m_propertyConnections.insert(object, connections);
     }
+    m_notifyConnectionCount += connections.size();
 }
 
-void ProbeConnection::unobserveProperties(QObject *object)
+void ObjectRegistry::unobserveProperties(int slot)
 {
-    auto connectionIt = m_propertyConnections.find(object);
-    if (connectionIt != m_propertyConnections.end()) {
-        for (const QMetaObject::Connection &connection : connectionIt.value()) {
-            QObject::disconnect(connection);
-        }
-        m_propertyConnections.erase(connectionIt);
+    QVector<QMetaObject::Connection> &connections = m_table.connections(slot);
+    for (const QMetaObject::Connection &connection : std::as_const(connections)) {
+        QObject::disconnect(connection);
     }
+    m_notifyConnectionCount -= connections.size();
+    connections = {};
+}
 
-    for (auto it = m_propertyBySignalIndex.begin(); it != m_propertyBySignalIndex.end();) {
-        if (it.key().first == object) {
-            it = m_propertyBySignalIndex.erase(it);
-        } else {
-            ++it;
-        }
-    }
+void ObjectRegistry::installRecursive(QObject *object, int parentSlot, bool announce, int depth)
+{
+    ScopedLatency timing(&m_stats.installLatency);
+    installSubtree(object, parentSlot, announce, depth);
 }
 
-void ProbeConnection::installRecursive(QObject *object, const QString &parentId, bool announce)
+void ObjectRegistry::installSubtree(QObject *object, int parentSlot, bool announce, int depth)
 {
     if (!object) {
         return;
     }
 
-    const QString id = ensureIdForObject(object);
-    m_parentByObject.insert(object, parentId);
+    ++m_installVisits;
+    const int slot = ensureSlot(object);
 
-    const bool alreadyTracked = m_tracked.contains(object);
+    const bool alreadyTracked = m_table.hasFlag(slot, ObjectTable::Tracked);
     if (!alreadyTracked) {
-        m_tracked.insert(object);
+        m_table.setFlag(slot, ObjectTable::Tracked, true);
+        m_table.link(slot, parentSlot);
+        ++m_trackedCount;
         
         // For injected probes, be extremely conservative - don't install event filters or property observers
         const bool isLikelyInjected = (m_probe && m_probe->parent() == QCoreApplication::instance());
         
         if (!isLikelyInjected) {
-            // Only install filters and observers for non-injected probes
+            // Only install filters for non-injected probes; notify signals
+            // are connected when a client subscribes to the node
             object->installEventFilter(this);
-            observeProperties(object);
             // Only connect to destroyed signal for non-injected probes
             QObject::connect(object,
                              &QObject::destroyed,
                              this,
-                             &ProbeConnection::onObjectDestroyed,
+                             &ObjectRegistry::onObjectDestroyed,
                              Qt::UniqueConnection);
         }
         // For injected probes, don't connect to destroyed signal to avoid interference
+    } else if (m_table.parent(slot) != parentSlot) {
+        m_table.link(slot, parentSlot);
+    }
+
+    const bool expand = depth != 0;
+    if (expand && m_lazyAttach) {
+        m_table.setFlag(slot, ObjectTable::Expanded, true);
     }
 
     if (announce && !alreadyTracked) {
-        emitNodeAdded(object, parentId);
+        emitNodeAdded(object, parentIdOf(slot));
+    }
+    if (!expand) {
+        return;
     }
 
     const QList<QObject *> children = object->children();
     for (QObject *child : children) {
-        installRecursive(child, id, announce);
+        installSubtree(child, slot, announce, depth > 0 ? depth - 1 : depth);
+    }
+}
+
+int ObjectRegistry::installDepth() const
+{
+    return m_lazyAttach ? 0 : -1;
+}
+
+bool ObjectRegistry::childrenTracked(int slot) const
+{
+    return m_table.hasFlag(slot, ObjectTable::Tracked)
+           && (!m_lazyAttach || m_table.hasFlag(slot, ObjectTable::Expanded));
+}
+
+bool ObjectRegistry::childrenTracked(const QObject *object) const
+{
+    const int slot = m_table.slotOf(object);
+    return slot != ObjectTable::kNoSlot && m_table.object(slot) == object && childrenTracked(slot);
+}
+
+void ObjectRegistry::beginCapture(QObject *subtreeRoot, SnapshotWalk *walk)
+{
+    // Pre-order walk over the table's child links; children are pushed in
+    // reverse so they are emitted in the order they were tracked.
+    if (subtreeRoot) {
+        if (!isTracked(subtreeRoot)) {
+            QObject *parent = subtreeRoot->parent();
+            const int parentSlot = parent && isTracked(parent) ? m_table.slotOf(parent)
+                                                               : ObjectTable::kNoSlot;
+            installRecursive(subtreeRoot, parentSlot, false, installDepth());
+        }
+        const int slot = m_table.slotOf(subtreeRoot);
+        walk->stack.append({slot, m_table.id(slot), 0});
+    } else {
+        const QVector<QObject *> roots = ensureRootsTracked(false);
+        for (int i = roots.size() - 1; i >= 0; --i) {
+            const int slot = m_table.slotOf(roots.at(i));
+            walk->stack.append({slot, m_table.id(slot), 0});
+        }
+    }
+}
+
+bool ObjectRegistry::continueCapture(SnapshotWalk *walk, const FieldMask &mask,
+                                     SnapshotCapture *capture, qint64 budgetNs)
+{
+    ++walk->slices;
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!walk->stack.isEmpty()) {
+        if (budgetNs > 0 && timer.nsecsElapsed() >= budgetNs) {
+            return false;
+        }
+
+        const SnapshotWalk::PendingNode next = walk->stack.takeLast();
+        if (next.slot == ObjectTable::kNoSlot || next.slot >= m_table.slotCount()
+            || m_table.id(next.slot) != next.id) {
+            continue; // forgotten since it was queued
+        }
+        QObject *object = m_table.object(next.slot);
+        if (!object) {
+            continue;
+        }
+
+        const bool atDepthLimit = capture->maxDepth >= 0 && next.depth >= capture->maxDepth;
+        if (!atDepthLimit
+            && (!childrenTracked(next.slot)
+                || m_table.childCount(next.slot) != object->children().size())) {
+            // The children are reported too, so track them now: with lazy
+            // attach they may never have been, and injected probes see no
+            // ChildAdded events.
+            installRecursive(object, m_table.parent(next.slot), false, 1);
+        }
+
+        capture->nodes.append(captureNode(object, parentIdOf(next.slot), mask, !atDepthLimit));
+        if (next.depth == 0) {
+            capture->rootIds.append(capture->nodes.last().id);
+        }
+        if (atDepthLimit) {
+            continue;
+        }
+
+        for (int child = m_table.lastChild(next.slot); child != ObjectTable::kNoSlot;
+             child = m_table.prevSibling(child)) {
+            walk->stack.append({child, m_table.id(child), next.depth + 1});
+        }
+    }
+    return true;
+}
+
+void ObjectRegistry::removeRecursive(const QObject *object, bool emitEvent)
+{
+    if (object) {
+        removeSlotRecursive(m_table.slotOf(object), emitEvent);
     }
 }
 
-void ProbeConnection::removeRecursive(QObject *object, bool emitEvent)
+void ObjectRegistry::removeSlotRecursive(int slot, bool emitEvent)
 {
-    if (!object || !m_tracked.contains(object)) {
+    if (slot == ObjectTable::kNoSlot || !m_table.hasFlag(slot, ObjectTable::Tracked)) {
         return;
     }
 
-    const QList<QObject *> children = object->children();
-    for (QObject *child : children) {
-        removeRecursive(child, emitEvent);
+    for (int child = m_table.firstChild(slot); child != ObjectTable::kNoSlot;) {
+        const int next = m_table.nextSibling(child);
+        removeSlotRecursive(child, emitEvent);
+        child = next;
     }
 
+    const NodeId parentId = parentIdOf(slot);
+    m_table.setFlag(slot, ObjectTable::Tracked, false);
+    m_table.setFlag(slot, ObjectTable::Expanded, false);
+    m_table.unlink(slot);
+    --m_trackedCount;
+
     // Never interfere with the QCoreApplication instance itself - this could kill the app
-    if (object == QCoreApplication::instance()) {
-        m_tracked.remove(object);
+    if (m_table.key(slot) == QCoreApplication::instance()) {
         return;
     }
 
@@ -823,57 +3134,230 @@ void ProbeConnection::removeRecursive(QObject *object, bool emitEvent)
     const bool isLikelyInjected = (m_probe && m_probe->parent() == QCoreApplication::instance());
     
     if (!isLikelyInjected) {
-        // Only do cleanup for non-injected probes
-        object->removeEventFilter(this);
-        unobserveProperties(object);
-        // Only disconnect signals for non-injected probes
-        QObject::disconnect(object, nullptr, this, nullptr);
+        // Only do cleanup for non-injected probes; an object that is being
+        // destroyed drops its filters and connections by itself
+        unobserveProperties(slot);
+        if (QObject *object = m_table.object(slot)) {
+            object->removeEventFilter(this);
+            // Only disconnect signals for non-injected probes
+            QObject::disconnect(object, nullptr, this, nullptr);
+        }
     }
     // For injected probes, don't disconnect anything - leave everything intact
 
-    m_tracked.remove(object);
-    const QString parentId = m_parentByObject.take(object);
-    const QString id = m_idsByObject.value(object);
+    m_rateWindows.remove(m_table.key(slot));
+    const NodeId id = m_table.id(slot);
+    m_propertySubscriptions.remove(id);
 
-    if (emitEvent && !id.isEmpty()) {
+    if (emitEvent) {
         emitNodeRemoved(id, parentId);
     }
 }
 
-void ProbeConnection::emitNodeAdded(QObject *object, const QString &parentId)
+void ObjectRegistry::emitNodeAdded(QObject *object, NodeId parentId)
 {
     QJsonObject payload;
     payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kNodeAdded);
     payload[QLatin1String(protocol::keys::kTimestampMs)] =
         static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    if (!parentId.isEmpty()) {
-        payload[QLatin1String(protocol::keys::kParentId)] = parentId;
-    }
-    payload[QLatin1String(protocol::keys::kNode)] = serializeNode(object, parentId);
-    sendMessage(payload);
+    if (parentId != protocol::kInvalidNodeId) {
+        payload[QLatin1String(protocol::keys::kParentId)] = protocol::nodeIdToJson(parentId);
+    }
+    // Without tracked children it is reported like a node at a snapshot's
+    // depth limit; clients fetch the children with a subtree snapshot.
+    const CapturedNode node = captureNode(object, parentId, FieldMask(), childrenTracked(object));
+    payload[QLatin1String(protocol::keys::kNode)] = nodeToJson(node);
+    broadcast(payload);
 }
 
-void ProbeConnection::emitNodeRemoved(const QString &id, const QString &parentId)
+void ObjectRegistry::emitNodeRemoved(NodeId id, NodeId parentId)
 {
     QJsonObject payload;
     payload[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kNodeRemoved);
     payload[QLatin1String(protocol::keys::kTimestampMs)] =
         static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QLatin1String(protocol::keys::kId)] = id;
-    if (!parentId.isEmpty()) {
-        payload[QLatin1String(protocol::keys::kParentId)] = parentId;
+    payload[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+    if (parentId != protocol::kInvalidNodeId) {
+        payload[QLatin1String(protocol::keys::kParentId)] = protocol::nodeIdToJson(parentId);
     }
-    sendMessage(payload);
+    broadcast(payload);
 }
 
-void ProbeConnection::emitPropertiesChanged(QObject *object, const QStringList &names)
+void ObjectRegistry::queuePropertiesChanged(QObject *object, const QStringList &names)
 {
-    if (!object) {
+    if (!object || names.isEmpty()) {
+        return;
+    }
+    const int slot = m_table.slotOf(object);
+    if (slot == ObjectTable::kNoSlot) {
+        return;
+    }
+    const auto subscribers = m_propertySubscriptions.constFind(m_table.id(slot));
+    if (subscribers == m_propertySubscriptions.constEnd()) {
+        return;
+    }
+
+    QStringList admitted;
+    const qint64 nowMs = m_rateClock.elapsed();
+    for (const QString &name : names) {
+        double maxRateHz = 0.0;
+        for (const PropertySubscription &subscription : subscribers.value()) {
+            if (!subscription.names.isEmpty() && !subscription.names.contains(name)) {
+                continue;
+            }
+            if (subscription.maxRateHz <= 0.0) {
+                maxRateHz = 0.0; // someone wants every change
+                break;
+            }
+            maxRateHz = qMax(maxRateHz, subscription.maxRateHz);
+        }
+        if (maxRateHz > 0.0 && !admitRateLimited(object, name, maxRateHz, nowMs)) {
+            continue;
+        }
+        admitted.append(name);
+    }
+    if (!admitted.isEmpty()) {
+        appendPendingChange(object, admitted);
+    }
+}
+
+bool ObjectRegistry::admitRateLimited(QObject *object, const QString &name, double maxRateHz,
+                                      qint64 nowMs)
+{
+    const qint64 intervalMs = qMax<qint64>(1, qRound64(1000.0 / maxRateHz));
+    auto &windows = m_rateWindows[object];
+    auto window = windows.find(name);
+    if (window == windows.end()) {
+        windows.insert(name, {nowMs, 0, false});
+        return true;
+    }
+    if (window->held) {
+        // Already going out at the end of the window with the latest value.
+        ++m_stats.rateLimitedChanges;
+        return false;
+    }
+    if (nowMs - window->lastDeliveryMs >= intervalMs) {
+        window->lastDeliveryMs = nowMs;
+        return true;
+    }
+
+    window->held = true;
+    window->dueMs = window->lastDeliveryMs + intervalMs;
+    const qint64 delayMs = window->dueMs - nowMs;
+    if (!m_rateLimitRelease.isActive() || m_rateLimitRelease.remainingTime() > delayMs) {
+        m_rateLimitRelease.start(static_cast<int>(delayMs));
+    }
+    return false;
+}
+
+void ObjectRegistry::releaseRateLimited()
+{
+    const qint64 nowMs = m_rateClock.elapsed();
+    qint64 nextDueMs = -1;
+    for (auto objectIt = m_rateWindows.begin(); objectIt != m_rateWindows.end(); ++objectIt) {
+        QStringList due;
+        for (auto window = objectIt->begin(); window != objectIt->end(); ++window) {
+            if (!window->held) {
+                continue;
+            }
+            if (window->dueMs <= nowMs) {
+                window->held = false;
+                window->lastDeliveryMs = nowMs;
+                due.append(window.key());
+            } else if (nextDueMs < 0 || window->dueMs < nextDueMs) {
+                nextDueMs = window->dueMs;
+            }
+        }
+        if (!due.isEmpty()) {
+            // Windows are dropped with the object, so the key is still alive.
+            appendPendingChange(const_cast<QObject *>(objectIt.key()), due);
+        }
+    }
+    if (nextDueMs >= 0) {
+        m_rateLimitRelease.start(static_cast<int>(nextDueMs - nowMs));
+    }
+}
+
+void ObjectRegistry::appendPendingChange(QObject *object, const QStringList &names)
+{
+    const auto indexIt = m_pendingChangeIndex.constFind(object);
+    if (indexIt != m_pendingChangeIndex.constEnd()) {
+        PendingPropertyChange &pending = m_pendingChanges[indexIt.value()];
+        if (pending.object == object) {
+            for (const QString &name : names) {
+                if (!pending.names.contains(name)) {
+                    pending.names.append(name);
+                }
+            }
+            return;
+        }
+        // The queued object died and its address was reused; start over.
+        pending.object = object;
+        pending.names = names;
         return;
     }
 
-    const QString id = ensureIdForObject(object);
-    if (id.isEmpty()) {
+    m_pendingChangeIndex.insert(object, m_pendingChanges.size());
+    m_pendingChanges.append({object, names});
+    if (!m_propertyFlush.isActive()) {
+        m_propertyFlush.start();
+    }
+}
+
+void ObjectRegistry::flushPropertiesChanged()
+{
+    const QVector<PendingPropertyChange> pendingChanges = std::exchange(m_pendingChanges, {});
+    m_pendingChangeIndex.clear();
+
+    QJsonArray changes;
+    QVector<NodeId> changedIds;
+    for (const PendingPropertyChange &pending : pendingChanges) {
+        QObject *object = pending.object.data();
+        if (!object) {
+            continue;
+        }
+        const NodeId id = ensureIdForObject(object);
+        if (id == protocol::kInvalidNodeId) {
+            continue;
+        }
+
+        // Only the changed values are read; a full dump is what
+        // propertiesRequest is for.
+        FieldMask mask;
+        mask.geometry = false;
+        mask.propertyNames = QSet<QString>(pending.names.cbegin(), pending.names.cend());
+
+        QJsonObject properties = serializeProperties(object, mask);
+
+        // A removed dynamic property has no value left to read; null tells
+        // clients to drop the one they hold.
+        QJsonObject dynamicProperties = properties.value(QStringLiteral("__dynamic")).toObject();
+        bool removedDynamic = false;
+        for (const QString &name : pending.names) {
+            if (properties.contains(name) || dynamicProperties.contains(name)) {
+                continue;
+            }
+            const QByteArray rawName = name.toUtf8();
+            if (object->metaObject()->indexOfProperty(rawName.constData()) >= 0
+                || object->property(rawName.constData()).isValid()) {
+                continue;
+            }
+            dynamicProperties.insert(name, QJsonValue::Null);
+            removedDynamic = true;
+        }
+        if (removedDynamic) {
+            properties.insert(QStringLiteral("__dynamic"), dynamicProperties);
+        }
+
+        QJsonObject change;
+        change[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(id);
+        change[QLatin1String(protocol::keys::kChanged)] = QJsonArray::fromStringList(pending.names);
+        change[QLatin1String(protocol::keys::kProperties)] = properties;
+        changes.append(change);
+        changedIds.append(id);
+    }
+
+    if (changes.isEmpty()) {
         return;
     }
 
@@ -882,19 +3366,62 @@ void ProbeConnection::emitPropertiesChanged(QObject *object, const QStringList &
         QLatin1String(protocol::types::kPropertiesChanged);
     payload[QLatin1String(protocol::keys::kTimestampMs)] =
         static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
-    payload[QLatin1String(protocol::keys::kId)] = id;
-    if (!names.isEmpty()) {
-        QJsonArray changed;
-        for (const QString &name : names) {
-            changed.append(name);
+    // Journaled whole, as a client resuming later may subscribe differently.
+    payload[QLatin1String(protocol::keys::kChanges)] = changes;
+    recordEvent(&payload);
+
+    // Each subscriber gets the entries for its own subscriptions. Clients
+    // that see the whole batch share one encoded frame, as in broadcast().
+    QByteArray frames[4];
+    for (ProbeConnection *connection : std::as_const(m_subscribers)) {
+        QJsonArray own;
+        bool complete = true;
+        for (int i = 0; i < changes.size(); ++i) {
+            const QSet<QString> *names = nullptr;
+            const auto subscribers = m_propertySubscriptions.constFind(changedIds.at(i));
+            if (subscribers != m_propertySubscriptions.constEnd()) {
+                const auto found = subscribers->constFind(connection);
+                if (found != subscribers->constEnd()) {
+                    names = &found->names;
+                }
+            }
+            if (!names) {
+                complete = false;
+                continue;
+            }
+            if (names->isEmpty()) {
+                own.append(changes.at(i));
+                continue;
+            }
+            complete = false;
+            const QJsonObject projected = projectPropertyChange(changes.at(i).toObject(), *names);
+            if (!projected.isEmpty()) {
+                own.append(projected);
+            }
+        }
+        if (own.isEmpty()) {
+            continue;
+        }
+
+        QJsonObject message = payload;
+        message[QLatin1String(protocol::keys::kChanges)] = own;
+        if (!complete) {
+            connection->sendEvent(message,
+                                  encodeOutgoingFrame(message, connection->encoding(),
+                                                      connection->compressAbove(),
+                                                      m_compression.get()));
+            continue;
+        }
+        QByteArray &frame = sharedFrameSlot(frames, connection);
+        if (frame.isEmpty()) {
+            frame = encodeOutgoingFrame(message, connection->encoding(),
+                                        connection->compressAbove(), m_compression.get());
         }
-        payload[QLatin1String(protocol::keys::kChanged)] = changed;
+        connection->sendEvent(message, frame);
     }
-    payload[QLatin1String(protocol::keys::kProperties)] = serializeProperties(object);
-    sendMessage(payload);
 }
 
-QVector<QObject *> ProbeConnection::ensureRootsTracked(bool announce)
+QVector<QObject *> ObjectRegistry::collectRoots() const
 {
     QVector<QObject *> roots;
     QSet<QObject *> candidates;
@@ -913,19 +3440,8 @@ QVector<QObject *> ProbeConnection::ensureRootsTracked(bool announce)
         // Be more selective about application children - avoid tracking critical system objects
         const auto appChildren = app->children();
         for (QObject *child : appChildren) {
-            // Skip objects that are likely critical to application lifecycle
-            const QString childClassName = child->metaObject()->className();
-            const QString childObjectName = child->objectName();
-            
             // Skip critical Qt internal objects that could affect application stability
-            if (childClassName.startsWith("QSocketNotifier") ||
-                childClassName.startsWith("QEventDispatcher") ||
-                childClassName.startsWith("QTimer") ||
-                childClassName.startsWith("QThread") ||
-                childClassName.contains("SystemTrayIcon") ||
-                childClassName.contains("DBus") ||
-                childObjectName.startsWith("qt_") ||
-                childObjectName.startsWith("_q_")) {
+            if (isInternalApplicationChild(child)) {
                 continue;
             }
             
@@ -949,28 +3465,162 @@ QVector<QObject *> ProbeConnection::ensureRootsTracked(bool announce)
         }
     }
 
-    for (QObject *root : roots) {
-        installRecursive(root, QString(), announce);
+    return roots;
+}
+
+QVector<QObject *> ObjectRegistry::ensureRootsTracked(bool announce)
+{
+    // Pick up anything the watcher reported before the caller looks at the
+    // tree; roots that are already tracked are kept current by the watcher.
+    if (!m_discoveryCandidates.isEmpty()) {
+        m_discoveryFlush.stop();
+        refreshTopLevelObjects();
     }
 
+    const QVector<QObject *> roots = collectRoots();
+    for (QObject *root : roots) {
+        if (!isTracked(root)) {
+            installRecursive(root, ObjectTable::kNoSlot, announce, installDepth());
+        }
+    }
     return roots;
 }
 
-void ProbeConnection::refreshTopLevelObjects()
+bool ObjectRegistry::isRootCandidate(const QObject *object) const
 {
-    ensureRootsTracked(true);
+    const QObject *parent = object->parent();
+    if (!parent) {
+        if (object->isWidgetType()) {
+            return static_cast<const QWidget *>(object)->isWindow();
+        }
+        return qobject_cast<const QWindow *>(object) != nullptr;
+    }
+    return parent == QCoreApplication::instance() && !isInternalApplicationChild(object);
 }
 
-void ProbeConnection::resetConnectionState()
+void ObjectRegistry::startDiscovery()
 {
-    // Reset connection-specific state without cleaning up tracked objects
-    // This allows injected probes to handle new connections gracefully
-    m_handshakeComplete = false;
-    m_selectedId.clear();
-    m_readBuffer.clear();
+    auto *app = QCoreApplication::instance();
+    if (!app || m_topLevelWatcher) {
+        return;
+    }
+    // Injected probes install no per-object filters, so removals are only
+    // seen here; for standalone probes this runs first and the per-object
+    // filter then finds nothing left to do.
+    m_topLevelWatcher = std::make_unique<TopLevelWatcher>(
+        [this](QObject *object) { markDiscoveryCandidate(object); },
+        [this](QObject *object) {
+            m_discoveryCandidates.remove(object);
+            removeRecursive(object, true);
+        });
+    app->installEventFilter(m_topLevelWatcher.get());
+}
+
+void ObjectRegistry::stopDiscovery()
+{
+    m_discoveryFlush.stop();
+    m_discoveryCandidates.clear();
+    if (m_topLevelWatcher) {
+        if (auto *app = QCoreApplication::instance()) {
+            app->removeEventFilter(m_topLevelWatcher.get());
+        }
+        m_topLevelWatcher.reset();
+    }
+}
+
+void ObjectRegistry::markDiscoveryCandidate(QObject *object)
+{
+    // Runs for every ChildAdded/Show/ParentChange in the application, so keep
+    // the common case (already tracked, or unrelated to anything tracked) to
+    // a couple of hash lookups.
+    if (isTracked(object) || m_discoveryCandidates.contains(object)) {
+        return;
+    }
+    QObject *parent = object->parent();
+    if (parent && parent != QCoreApplication::instance() && !childrenTracked(parent)
+        && !m_discoveryCandidates.contains(parent)) {
+        // Shown windows with untracked parents can still be roots.
+        if (!object->isWidgetType() || !static_cast<QWidget *>(object)->isWindow()) {
+            return;
+        }
+    }
+
+    m_discoveryCandidates.insert(object, object);
+    if (!m_discoveryFlush.isActive()) {
+        m_discoveryFlush.start();
+    }
+}
+
+void ObjectRegistry::refreshTopLevelObjects()
+{
+    const auto candidates = std::exchange(m_discoveryCandidates, {});
+    const int visitsBefore = m_installVisits;
+
+    for (const QPointer<QObject> &candidate : candidates) {
+        QObject *object = candidate.data();
+        if (!object || isTracked(object)) {
+            continue;
+        }
+        QObject *parent = object->parent();
+        if (parent && childrenTracked(parent)) {
+            installRecursive(object, m_table.slotOf(parent), true, installDepth());
+        } else if (isRootCandidate(object)) {
+            installRecursive(object, ObjectTable::kNoSlot, true, installDepth());
+        }
+        // Otherwise an ancestor is a candidate too and brings it in, or it
+        // lives outside anything the probe shows.
+    }
+
+    const int visited = m_installVisits - visitsBefore;
+    ++m_stats.refreshCount;
+    m_stats.lastRefreshVisited = visited;
+    m_stats.totalRefreshVisited += static_cast<quint64>(visited);
+}
+
+ProbeStats ObjectRegistry::stats() const
+{
+    ProbeStats stats = m_stats;
+    stats.trackedObjects = m_trackedCount;
+    stats.notifyConnections = m_notifyConnectionCount;
+    stats.objectTableBytes = m_table.memoryBytes();
+    stats.bytesPerTrackedObject =
+        m_trackedCount > 0 ? int(stats.objectTableBytes / m_trackedCount) : 0;
+    for (const auto &subscribers : m_propertySubscriptions) {
+        stats.propertySubscriptions +=
+            subscribers.size() - (subscribers.contains(kParkedSubscriber) ? 1 : 0);
+    }
+    stats.compressedFrames = m_compression->frames;
+    stats.compressionInputBytes = m_compression->inputBytes;
+    stats.compressionOutputBytes = m_compression->outputBytes;
+    stats.compressionNs = m_compression->totalNs;
+    return stats;
+}
+
+void ObjectRegistry::subscriptionStats(const ProbeConnection *connection,
+                                       ConnectionStats *stats) const
+{
+    ProbeConnection *key = const_cast<ProbeConnection *>(connection);
+    for (auto it = m_propertySubscriptions.cbegin(); it != m_propertySubscriptions.cend(); ++it) {
+        const auto found = it.value().constFind(key);
+        if (found == it.value().constEnd()) {
+            continue;
+        }
+        stats->subscribedIds.append(it.key());
+        if (found->names.isEmpty()) {
+            ++stats->allPropertiesNodes;
+        } else {
+            stats->subscribedPropertyNames += found->names.size();
+        }
+    }
+    std::sort(stats->subscribedIds.begin(), stats->subscribedIds.end());
+}
+
+std::shared_ptr<CompressionMeter> ObjectRegistry::compressionMeter() const
+{
+    return m_compression;
 }
 
-void ProbeConnection::cleanup()
+void ObjectRegistry::cleanup()
 {
     // For injected probes, we should be very conservative about cleanup
     // to avoid interfering with the host application's normal operation.
@@ -978,7 +3628,12 @@ void ProbeConnection::cleanup()
     // stops tracking without disrupting the application.
     
     // Stop the polling timer first
-    m_topLevelPoll.stop();
+    stopDiscovery();
+    m_propertyFlush.stop();
+    m_pendingChanges.clear();
+    m_pendingChangeIndex.clear();
+    m_rateLimitRelease.stop();
+    m_rateWindows.clear();
     
     // Determine if this is likely an injected probe by checking if the probe's parent
     // is the QCoreApplication instance (which happens during injection)
@@ -989,35 +3644,76 @@ void ProbeConnection::cleanup()
         // This prevents interference with the host application's normal operation
         
         // Only disconnect our specific property connections, don't touch the objects
-        for (auto it = m_propertyConnections.begin(); it != m_propertyConnections.end(); ++it) {
-            for (const QMetaObject::Connection &connection : it.value()) {
+        for (int slot = 0; slot < m_table.slotCount(); ++slot) {
+            for (const QMetaObject::Connection &connection : std::as_const(m_table.connections(slot))) {
                 QObject::disconnect(connection);
             }
         }
-        
-        // Clear all tracking data structures without touching the tracked objects
-        m_propertyConnections.clear();
-        m_propertyBySignalIndex.clear();
-        m_parentByObject.clear();
-        m_idsByObject.clear();
-        m_objectById.clear();
-        m_tracked.clear();
-        m_selectedId.clear();
     } else {
         // Aggressive cleanup for standalone probes (tests, etc.)
-        const auto trackedSnapshot = m_tracked;
-        for (const QObject *object : trackedSnapshot) {
-            removeRecursive(const_cast<QObject *>(object), false);
+        for (int slot = 0; slot < m_table.slotCount(); ++slot) {
+            if (m_table.parent(slot) == ObjectTable::kNoSlot) {
+                removeSlotRecursive(slot, false);
+            }
+        }
+    }
+
+    // Clear all tracking data structures without touching the tracked objects
+    m_table.clear();
+    m_trackedCount = 0;
+    m_notifyConnectionCount = 0;
+    m_propertySubscriptions.clear();
+
+    // Objects get new ids when tracking starts again, so nothing recorded so
+    // far can be resumed from.
+    m_parkedClients.clear();
+    m_resumeWindow.stop();
+    m_journal.clear();
+    m_journalFloor = m_lastSeq;
+}
+
+void LatencyHistogram::record(qint64 ns)
+{
+    ns = qMax<qint64>(0, ns);
+    int bucket = 0;
+    while (bucket < kBucketCount - 1 && ns >= bucketUpperNs(bucket)) {
+        ++bucket;
+    }
+    ++buckets[bucket];
+    ++count;
+    totalNs += ns;
+    maxNs = qMax(maxNs, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < kBucketCount; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    totalNs += other.totalNs;
+    maxNs = qMax(maxNs, other.maxNs);
+}
+
+qint64 LatencyHistogram::percentileNs(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(std::ceil(fraction * count)));
+    quint64 seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperNs(i), maxNs);
         }
-        
-        m_propertyConnections.clear();
-        m_propertyBySignalIndex.clear();
-        m_parentByObject.clear();
-        m_idsByObject.clear();
-        m_objectById.clear();
-        m_tracked.clear();
-        m_selectedId.clear();
     }
+    return maxNs;
+}
+
+qint64 LatencyHistogram::bucketUpperNs(int bucket)
+{
+    return qint64(1) << (bucket + 10);
 }
 
 // Probe implementation
@@ -1026,6 +3722,12 @@ Probe::Probe(const ProbeOptions &options, QObject *parent)
     : QObject(parent)
     , m_serverName(options.serverName.isEmpty() ? defaultServerName() : options.serverName)
     , m_autoStart(options.autoStart)
+    , m_sendQueueHighWater(options.sendQueueHighWater)
+    , m_sendQueueLimit(options.sendQueueLimit)
+    , m_snapshotTimeBudgetMs(options.snapshotTimeBudgetMs)
+    , m_compressFramesAbove(options.compressFramesAbove)
+    , m_registry(new ObjectRegistry(this, options))
+    , m_encoder(options.offThreadEncoding ? new SnapshotEncoder(this) : nullptr)
 {
     if (m_autoStart) {
         QMetaObject::invokeMethod(this, &Probe::start, Qt::QueuedConnection);
@@ -1042,6 +3744,15 @@ bool Probe::isListening() const
     return m_server && m_server->isListening();
 }
 
+ProbeStats Probe::stats() const
+{
+    ProbeStats stats = m_registry ? m_registry->stats() : ProbeStats();
+    for (const ProbeConnection *connection : m_connections) {
+        connection->accumulateStats(&stats);
+    }
+    return stats;
+}
+
 void Probe::start()
 {
     if (m_server) {
@@ -1090,7 +3801,11 @@ void Probe::handleNewConnection()
     }
 
     while (QLocalSocket *socket = m_server->nextPendingConnection()) {
-        auto *connection = new ProbeConnection(socket, this);
+        auto *connection = new ProbeConnection(socket, this, m_registry);
+        connection->setSendQueueLimits(m_sendQueueHighWater, m_sendQueueLimit);
+        connection->setSnapshotTimeBudget(m_snapshotTimeBudgetMs);
+        connection->setFrameCompression(m_compressFramesAbove);
+        connection->setSnapshotEncoder(m_encoder);
         connect(connection, &ProbeConnection::closed, this, &Probe::removeConnection);
         m_connections.push_back(connection);
     }
@@ -0,0 +1,146 @@
+#include "qt_spy/protocol.h"
+#include "qt_spy/wire_format.h"
+
+#include <QtTest>
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+
+namespace {
+
+constexpr int kFrameCount = 100000;
+// The per-frame mid()/remove() parser is quadratic in the burst size, so it
+// only gets a slice of the burst to compare against.
+constexpr int kLegacyFrameCount = 10000;
+
+// One small propertiesChanged event, about the size the registry sends for a
+// single changed property.
+QJsonObject propertiesChangedMessage(int index)
+{
+    QJsonObject properties;
+    properties[QStringLiteral("objectName")] = QStringLiteral("widget_%1").arg(index);
+
+    QJsonObject change;
+    change[QLatin1String(qt_spy::protocol::keys::kId)] = qt_spy::protocol::nodeIdToJson(
+        static_cast<qt_spy::NodeId>(index + 1));
+    change[QLatin1String(qt_spy::protocol::keys::kChanged)] =
+        QJsonArray{QStringLiteral("objectName")};
+    change[QLatin1String(qt_spy::protocol::keys::kProperties)] = properties;
+
+    QJsonObject message;
+    message[QLatin1String(qt_spy::protocol::keys::kType)] =
+        QLatin1String(qt_spy::protocol::types::kPropertiesChanged);
+    message[QLatin1String(qt_spy::protocol::keys::kTimestampMs)] =
+        static_cast<qint64>(QDateTime::currentMSecsSinceEpoch());
+    message[QLatin1String(qt_spy::protocol::keys::kChanges)] = QJsonArray{change};
+    return message;
+}
+
+QByteArray buildBurst(int frameCount, qt_spy::protocol::Encoding encoding)
+{
+    QByteArray burst;
+    for (int i = 0; i < frameCount; ++i) {
+        burst.append(qt_spy::protocol::encodeFrame(propertiesChangedMessage(i), encoding));
+    }
+    return burst;
+}
+
+// The parser both peers used before FrameReader: copy each payload out, then
+// cut the frame off the front of the buffer.
+int parseWithMidRemove(QIODevice *device)
+{
+    QByteArray buffer = device->readAll();
+    int decoded = 0;
+    while (buffer.size() >= 4) {
+        const quint32 header = qFromBigEndian<quint32>(
+            reinterpret_cast<const uchar *>(buffer.constData()));
+        const quint32 length = qt_spy::protocol::framePayloadLength(header);
+        if (buffer.size() < static_cast<int>(length) + 4) {
+            break;
+        }
+        const QByteArray payload = buffer.mid(4, static_cast<int>(length));
+        buffer.remove(0, static_cast<int>(length) + 4);
+
+        QJsonObject message;
+        if (qt_spy::protocol::decodePayload(payload, &message, nullptr)) {
+            ++decoded;
+        }
+    }
+    return decoded;
+}
+
+int parseWithFrameReader(QIODevice *device)
+{
+    qt_spy::protocol::FrameReader reader;
+    reader.readFrom(device);
+    int decoded = 0;
+    quint32 header = 0;
+    QByteArray payload;
+    while (reader.next(&header, &payload)) {
+        QJsonObject message;
+        if (qt_spy::protocol::decodePayload(payload, &message, nullptr)) {
+            ++decoded;
+        }
+    }
+    return reader.bufferedBytes() == 0 ? decoded : -1;
+}
+
+// Measures parsing one burst of 100k small frames, the shape a busy
+// propertiesChanged stream takes once the reader falls behind.
+class FrameReaderBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void benchmarkBurst_data();
+    void benchmarkBurst();
+};
+
+void FrameReaderBenchmark::benchmarkBurst_data()
+{
+    QTest::addColumn<int>("encoding");
+    QTest::newRow("json") << static_cast<int>(qt_spy::protocol::Encoding::Json);
+    QTest::newRow("cbor") << static_cast<int>(qt_spy::protocol::Encoding::Cbor);
+}
+
+void FrameReaderBenchmark::benchmarkBurst()
+{
+    QFETCH(int, encoding);
+    const auto wireEncoding = static_cast<qt_spy::protocol::Encoding>(encoding);
+
+    QByteArray burst = buildBurst(kFrameCount, wireEncoding);
+    QBuffer device(&burst);
+    QVERIFY(device.open(QIODevice::ReadOnly));
+
+    QElapsedTimer timer;
+    timer.start();
+    QCOMPARE(parseWithFrameReader(&device), kFrameCount);
+    const qint64 readerNs = timer.nsecsElapsed();
+
+    QByteArray legacyBurst = buildBurst(kLegacyFrameCount, wireEncoding);
+    QBuffer legacyDevice(&legacyBurst);
+    QVERIFY(legacyDevice.open(QIODevice::ReadOnly));
+    QBuffer sliceDevice(&legacyBurst);
+    QVERIFY(sliceDevice.open(QIODevice::ReadOnly));
+
+    timer.restart();
+    QCOMPARE(parseWithMidRemove(&legacyDevice), kLegacyFrameCount);
+    const qint64 legacyNs = timer.nsecsElapsed();
+
+    timer.restart();
+    QCOMPARE(parseWithFrameReader(&sliceDevice), kLegacyFrameCount);
+    const qint64 sliceNs = timer.nsecsElapsed();
+
+    qInfo() << "FrameReader" << readerNs / 1000000.0 << "ms for" << kFrameCount << "frames ("
+            << burst.size() << "bytes );" << kLegacyFrameCount << "frames:" << sliceNs / 1000000.0
+            << "ms vs" << legacyNs / 1000000.0 << "ms with mid/remove";
+    QTest::setBenchmarkResult(readerNs, QTest::WalltimeNanoseconds);
+}
+
+} // namespace
+
+QTEST_MAIN(FrameReaderBenchmark)
+#include "tst_frame_reader_benchmark.moc"
@@ -0,0 +1,145 @@
+#include "qt_spy/protocol.h"
+
+#include <QtTest>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QVector>
+
+namespace {
+
+using qt_spy::protocol::MessageType;
+
+constexpr int kFrameCount = 1000000;
+
+// The if-chain BridgeClient::dispatchMessage ran before message types were
+// interned, in the same order.
+MessageType messageTypeByComparison(const QString &type)
+{
+    namespace types = qt_spy::protocol::types;
+    if (type == QLatin1String(types::kHello)) {
+        return MessageType::Hello;
+    }
+    if (type == QLatin1String(types::kSnapshot)) {
+        return MessageType::Snapshot;
+    }
+    if (type == QLatin1String(types::kSnapshotBegin)) {
+        return MessageType::SnapshotBegin;
+    }
+    if (type == QLatin1String(types::kSnapshotChunk)) {
+        return MessageType::SnapshotChunk;
+    }
+    if (type == QLatin1String(types::kSnapshotEnd)) {
+        return MessageType::SnapshotEnd;
+    }
+    if (type == QLatin1String(types::kProperties)) {
+        return MessageType::Properties;
+    }
+    if (type == QLatin1String(types::kSelectionAck)) {
+        return MessageType::SelectionAck;
+    }
+    if (type == QLatin1String(types::kSubscriptionAck)) {
+        return MessageType::SubscriptionAck;
+    }
+    if (type == QLatin1String(types::kNodeAdded)) {
+        return MessageType::NodeAdded;
+    }
+    if (type == QLatin1String(types::kNodeRemoved)) {
+        return MessageType::NodeRemoved;
+    }
+    if (type == QLatin1String(types::kPropertiesChanged)) {
+        return MessageType::PropertiesChanged;
+    }
+    if (type == QLatin1String(types::kResyncRequired)) {
+        return MessageType::ResyncRequired;
+    }
+    if (type == QLatin1String(types::kStats)) {
+        return MessageType::Stats;
+    }
+    if (type == QLatin1String(types::kError)) {
+        return MessageType::Error;
+    }
+    if (type == QLatin1String(types::kGoodbye)) {
+        return MessageType::Goodbye;
+    }
+    return MessageType::Unknown;
+}
+
+// A notification storm: mostly propertiesChanged, with tree churn mixed in.
+QVector<QJsonObject> buildMessages()
+{
+    const MessageType mix[] = {
+        MessageType::PropertiesChanged, MessageType::PropertiesChanged,
+        MessageType::PropertiesChanged, MessageType::PropertiesChanged,
+        MessageType::PropertiesChanged, MessageType::PropertiesChanged,
+        MessageType::NodeAdded,         MessageType::NodeRemoved,
+    };
+    QVector<QJsonObject> messages;
+    for (MessageType type : mix) {
+        QJsonObject message;
+        message[QLatin1String(qt_spy::protocol::keys::kType)] =
+            qt_spy::protocol::messageTypeName(type);
+        messages.append(message);
+    }
+    return messages;
+}
+
+template <typename Lookup>
+qint64 timeDispatch(const QVector<QJsonObject> &messages, Lookup lookup, quint64 *checksum)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kFrameCount; ++i) {
+        const QJsonObject &message = messages.at(i % messages.size());
+        const QString type = message.value(QLatin1String(qt_spy::protocol::keys::kType)).toString();
+        *checksum += static_cast<quint64>(lookup(type));
+    }
+    return timer.nsecsElapsed();
+}
+
+// Measures resolving the type of a decoded message, which both dispatchers do
+// for every frame before anything else.
+class MessageDispatchBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void lookupMatchesNames();
+    void benchmarkDispatch();
+};
+
+void MessageDispatchBenchmark::lookupMatchesNames()
+{
+    for (int i = 1; i < qt_spy::protocol::kMessageTypeCount; ++i) {
+        const auto type = static_cast<MessageType>(i);
+        QCOMPARE(qt_spy::protocol::messageTypeFromName(qt_spy::protocol::messageTypeName(type)),
+                 type);
+    }
+    QCOMPARE(qt_spy::protocol::messageTypeFromName(QString()), MessageType::Unknown);
+    QCOMPARE(qt_spy::protocol::messageTypeFromName(QStringLiteral("hellO")), MessageType::Unknown);
+    QCOMPARE(qt_spy::protocol::messageTypeFromName(QStringLiteral("snapshotBegun")),
+             MessageType::Unknown);
+}
+
+void MessageDispatchBenchmark::benchmarkDispatch()
+{
+    const QVector<QJsonObject> messages = buildMessages();
+
+    quint64 chainChecksum = 0;
+    const qint64 chainNs = timeDispatch(messages, messageTypeByComparison, &chainChecksum);
+    quint64 tableChecksum = 0;
+    const qint64 tableNs =
+        timeDispatch(messages, qt_spy::protocol::messageTypeFromName, &tableChecksum);
+    QCOMPARE(tableChecksum, chainChecksum);
+
+    qInfo() << "Dispatch" << static_cast<double>(tableNs) / kFrameCount << "ns/frame interned vs"
+            << static_cast<double>(chainNs) / kFrameCount << "ns/frame compared over"
+            << kFrameCount << "frames";
+    QTest::setBenchmarkResult(static_cast<qreal>(tableNs) / kFrameCount,
+                              QTest::WalltimeNanoseconds);
+}
+
+} // namespace
+
+QTEST_MAIN(MessageDispatchBenchmark)
+#include "tst_message_dispatch_benchmark.moc"
@@ -0,0 +1,137 @@
+#include "qt_spy/bridge_client.h"
+#include "qt_spy/probe.h"
+#include "qt_spy/protocol.h"
+
+#include <QtTest>
+
+#include <QCheckBox>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSignalSpy>
+#include <QUuid>
+#include <QWidget>
+
+#include <memory>
+
+namespace {
+
+constexpr int kContainerCount = 100;
+constexpr int kWidgetsPerContainer = 99;
+
+QString uniqueServerName(const QString &tag)
+{
+    return QStringLiteral("qt_spy_bench_%1_%2")
+        .arg(tag)
+        .arg(QUuid::createUuid().toString(QUuid::Id128));
+}
+
+// Builds roughly 10k widgets spread over a handful of classes, which is the
+// shape the property layout cache is meant to speed up.
+std::unique_ptr<QWidget> buildWidgetTree()
+{
+    auto root = std::make_unique<QWidget>();
+    root->setObjectName(QStringLiteral("benchmarkRoot"));
+    for (int c = 0; c < kContainerCount; ++c) {
+        auto *container = new QWidget(root.get());
+        container->setObjectName(QStringLiteral("container_%1").arg(c));
+        for (int w = 0; w < kWidgetsPerContainer; ++w) {
+            QWidget *widget = nullptr;
+            switch (w % 4) {
+            case 0:
+                widget = new QLabel(QStringLiteral("label %1").arg(w), container);
+                break;
+            case 1:
+                widget = new QPushButton(QStringLiteral("button %1").arg(w), container);
+                break;
+            case 2:
+                widget = new QLineEdit(QStringLiteral("edit %1").arg(w), container);
+                break;
+            default:
+                widget = new QCheckBox(QStringLiteral("check %1").arg(w), container);
+                break;
+            }
+            widget->setObjectName(QStringLiteral("widget_%1_%2").arg(c).arg(w));
+        }
+    }
+    return root;
+}
+
+class SnapshotBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchmarkSnapshot_data();
+    void benchmarkSnapshot();
+
+private:
+    std::unique_ptr<QWidget> m_root;
+};
+
+void SnapshotBenchmark::initTestCase()
+{
+    m_root = buildWidgetTree();
+}
+
+void SnapshotBenchmark::cleanupTestCase()
+{
+    m_root.reset();
+}
+
+void SnapshotBenchmark::benchmarkSnapshot_data()
+{
+    QTest::addColumn<bool>("layoutCache");
+    QTest::newRow("generic fromVariant (baseline)") << false;
+    QTest::newRow("layout cache") << true;
+}
+
+void SnapshotBenchmark::benchmarkSnapshot()
+{
+    QFETCH(bool, layoutCache);
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.propertyLayoutCache = layoutCache;
+    options.serverName = uniqueServerName(QStringLiteral("snapshot"));
+    qt_spy::Probe probe(options);
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Local server not available (likely sandboxed)");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy connectedSpy(&client, &qt_spy::BridgeClient::socketConnected);
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    client.connectToServer(probe.serverName());
+    if (!connectedSpy.wait(5000)) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    client.sendAttach(QStringLiteral("snapshot-benchmark"));
+    QVERIFY(helloSpy.wait(5000));
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    int requestCounter = 0;
+    int nodeCount = 0;
+
+    QBENCHMARK {
+        snapshotSpy.clear();
+        client.requestSnapshot(QStringLiteral("bench_%1").arg(++requestCounter));
+        QVERIFY2(snapshotSpy.wait(30000), "Snapshot not received");
+        const QJsonObject snapshot = snapshotSpy.takeFirst().at(0).toJsonObject();
+        nodeCount = snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray().size();
+    }
+
+    QVERIFY(nodeCount >= kContainerCount * (kWidgetsPerContainer + 1));
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+} // namespace
+
+QTEST_MAIN(SnapshotBenchmark)
+#include "tst_snapshot_benchmark.moc"
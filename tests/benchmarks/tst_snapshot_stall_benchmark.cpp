@@ -0,0 +1,125 @@
+#include "qt_spy/bridge_client.h"
+#include "qt_spy/probe.h"
+#include "qt_spy/protocol.h"
+
+#include <QtTest>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QUuid>
+
+#include <memory>
+
+namespace {
+
+constexpr int kGroupCount = 500;
+constexpr int kObjectsPerGroup = 99;
+
+QString uniqueServerName(const QString &tag)
+{
+    return QStringLiteral("qt_spy_bench_%1_%2")
+        .arg(tag)
+        .arg(QUuid::createUuid().toString(QUuid::Id128));
+}
+
+// 50k plain QObjects under one application child. Reading them is cheap, so
+// what the GUI thread spends on a snapshot is dominated by building and
+// encoding the reply.
+std::unique_ptr<QObject> buildObjectTree()
+{
+    auto root = std::make_unique<QObject>(QCoreApplication::instance());
+    root->setObjectName(QStringLiteral("stallBenchmarkRoot"));
+    for (int g = 0; g < kGroupCount; ++g) {
+        auto *group = new QObject(root.get());
+        group->setObjectName(QStringLiteral("group_%1").arg(g));
+        for (int o = 0; o < kObjectsPerGroup; ++o) {
+            auto *object = new QObject(group);
+            object->setObjectName(QStringLiteral("object_%1_%2").arg(g).arg(o));
+        }
+    }
+    return root;
+}
+
+// Measures how long a snapshot request blocks the host's GUI thread, with the
+// encoding done inline and on the probe's encoder thread.
+class SnapshotStallBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchmarkSnapshotStall_data();
+    void benchmarkSnapshotStall();
+
+private:
+    std::unique_ptr<QObject> m_root;
+};
+
+void SnapshotStallBenchmark::initTestCase()
+{
+    m_root = buildObjectTree();
+}
+
+void SnapshotStallBenchmark::cleanupTestCase()
+{
+    m_root.reset();
+}
+
+void SnapshotStallBenchmark::benchmarkSnapshotStall_data()
+{
+    QTest::addColumn<bool>("offThreadEncoding");
+    QTest::newRow("inline") << false;
+    QTest::newRow("encoderThread") << true;
+}
+
+void SnapshotStallBenchmark::benchmarkSnapshotStall()
+{
+    QFETCH(bool, offThreadEncoding);
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.offThreadEncoding = offThreadEncoding;
+    options.serverName = uniqueServerName(QStringLiteral("stall"));
+    qt_spy::Probe probe(options);
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Local server not available (likely sandboxed)");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy connectedSpy(&client, &qt_spy::BridgeClient::socketConnected);
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    client.connectToServer(probe.serverName());
+    if (!connectedSpy.wait(5000)) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    client.sendAttach(QStringLiteral("stall-benchmark"));
+    QVERIFY(helloSpy.wait(5000));
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    client.requestSnapshot(QStringLiteral("stall"));
+    QVERIFY2(snapshotSpy.wait(60000), "Snapshot not received");
+    const QJsonObject snapshot = snapshotSpy.takeFirst().at(0).toJsonObject();
+    QVERIFY(snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray().size()
+            >= kGroupCount * (kObjectsPerGroup + 1));
+
+    const qt_spy::ProbeStats stats = probe.stats();
+    const qint64 stallNs = offThreadEncoding
+                               ? stats.lastSnapshotCaptureNs
+                               : stats.lastSnapshotCaptureNs + stats.lastSnapshotEncodeNs;
+    qInfo() << "GUI thread stall" << stallNs / 1000000.0 << "ms, capture"
+            << stats.lastSnapshotCaptureNs / 1000000.0 << "ms, encode"
+            << stats.lastSnapshotEncodeNs / 1000000.0 << "ms";
+    QTest::setBenchmarkResult(stallNs, QTest::WalltimeNanoseconds);
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+} // namespace
+
+QTEST_MAIN(SnapshotStallBenchmark)
+#include "tst_snapshot_stall_benchmark.moc"
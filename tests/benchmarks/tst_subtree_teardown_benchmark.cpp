@@ -0,0 +1,119 @@
+#include "qt_spy/bridge_client.h"
+#include "qt_spy/probe.h"
+#include "qt_spy/protocol.h"
+
+#include <QtTest>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QUuid>
+#include <QVector>
+
+#include <memory>
+
+namespace {
+
+constexpr int kGroupCount = 100;
+constexpr int kObjectsPerGroup = 99;
+constexpr int kSubtreeSize = kGroupCount * (kObjectsPerGroup + 1) + 1;
+
+QString uniqueServerName(const QString &tag)
+{
+    return QStringLiteral("qt_spy_bench_%1_%2")
+        .arg(tag)
+        .arg(QUuid::createUuid().toString(QUuid::Id128));
+}
+
+// About 10k QObjects under one application child, each with the objectName
+// notify signal to observe.
+std::unique_ptr<QObject> buildSubtree(const QString &name)
+{
+    auto root = std::make_unique<QObject>(QCoreApplication::instance());
+    root->setObjectName(name);
+    for (int g = 0; g < kGroupCount; ++g) {
+        auto *group = new QObject(root.get());
+        group->setObjectName(QStringLiteral("%1_group_%2").arg(name).arg(g));
+        for (int o = 0; o < kObjectsPerGroup; ++o) {
+            auto *object = new QObject(group);
+            object->setObjectName(QStringLiteral("%1_object_%2_%3").arg(name).arg(g).arg(o));
+        }
+    }
+    return root;
+}
+
+// Measures how long deleting a 10k-node subtree blocks the host while every
+// node, and as many elsewhere in the tree, has a property subscription.
+class SubtreeTeardownBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void benchmarkSubtreeTeardown();
+};
+
+void SubtreeTeardownBenchmark::benchmarkSubtreeTeardown()
+{
+    const std::unique_ptr<QObject> kept = buildSubtree(QStringLiteral("kept"));
+    std::unique_ptr<QObject> doomed = buildSubtree(QStringLiteral("doomed"));
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("teardown"));
+    qt_spy::Probe probe(options);
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Local server not available (likely sandboxed)");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy connectedSpy(&client, &qt_spy::BridgeClient::socketConnected);
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    client.connectToServer(probe.serverName());
+    if (!connectedSpy.wait(5000)) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    client.sendAttach(QStringLiteral("teardown-benchmark"));
+    QVERIFY(helloSpy.wait(5000));
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    client.requestSnapshot(QStringLiteral("teardown"));
+    QVERIFY2(snapshotSpy.wait(60000), "Snapshot not received");
+    const QJsonArray nodes = snapshotSpy.takeFirst().at(0).toJsonObject()
+                                 .value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+    QVector<qt_spy::NodeId> ids;
+    ids.reserve(nodes.size());
+    for (const QJsonValue &node : nodes) {
+        ids.append(qt_spy::protocol::nodeIdFromJson(
+            node.toObject().value(QLatin1String(qt_spy::protocol::keys::kId))));
+    }
+
+    QSignalSpy ackSpy(&client, &qt_spy::BridgeClient::subscriptionAckReceived);
+    client.subscribe(ids);
+    QVERIFY2(ackSpy.wait(60000), "Subscription not acknowledged");
+    const qt_spy::ProbeStats before = probe.stats();
+    QVERIFY(before.notifyConnections >= 2 * kSubtreeSize);
+
+    QElapsedTimer timer;
+    timer.start();
+    doomed.reset();
+    const qint64 teardownNs = timer.nsecsElapsed();
+
+    const qt_spy::ProbeStats after = probe.stats();
+    QCOMPARE(after.trackedObjects, before.trackedObjects - kSubtreeSize);
+    QCOMPARE(after.notifyConnections, before.notifyConnections - kSubtreeSize);
+
+    qInfo() << "Subtree teardown" << teardownNs / 1000000.0 << "ms for" << kSubtreeSize
+            << "nodes with" << before.notifyConnections << "notify connections";
+    QTest::setBenchmarkResult(teardownNs, QTest::WalltimeNanoseconds);
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+} // namespace
+
+QTEST_MAIN(SubtreeTeardownBenchmark)
+#include "tst_subtree_teardown_benchmark.moc"
@@ -1,4 +1,5 @@
 #include "qt_spy/bridge_client.h"
+#include "qt_spy/object_replica.h"
 #include "qt_spy/probe.h"
 
 #include <QtTest>
@@ -9,8 +10,11 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSet>
 #include <QSignalSpy>
+#include <QThread>
 #include <QUuid>
+#include <QVector>
 
 namespace {
 
@@ -49,6 +53,19 @@ private slots:
     void testIncrementalUpdates();
     void testRequestFlows();
     void testDetachHandshake();
+    void testCborEncoding();
+    void testChunkedSnapshot();
+    void testFieldMask();
+    void testCoalescedPropertyChanges();
+    void testNodeIdsNotReused();
+    void testSubtreeSnapshot();
+    void testStatsRequest();
+    void testFrameCompression();
+    void testCorrelatedRequests();
+    void testWorkerThreadIo();
+    void testObjectReplica();
+    void testResumeAfterReconnect();
+    void testResumeKeepsOwnSubscriptions();
 };
 
 QString uniqueServerName(const QString &tag)
@@ -86,6 +103,17 @@ bool connectAndAttach(qt_spy::BridgeClient &client,
     return true;
 }
 
+bool subscribeAndWait(qt_spy::BridgeClient &client, qt_spy::NodeId id)
+{
+    QSignalSpy ackSpy(&client, &qt_spy::BridgeClient::subscriptionAckReceived);
+    client.subscribe({id});
+    if (!ackSpy.wait(5000)) {
+        qWarning() << "BridgeClientTest: subscription ack timeout for" << id;
+        return false;
+    }
+    return true;
+}
+
 void BridgeClientTest::testHandshakeAndSnapshot()
 {
     qt_spy::ProbeOptions options;
@@ -133,14 +161,14 @@ void BridgeClientTest::testHandshakeAndSnapshot()
     const QJsonObject rootNode = nodesByName.value(QStringLiteral("rootNode"));
     const QJsonObject childNode = nodesByName.value(QStringLiteral("childNode"));
 
-    const QString rootId = rootNode.value(QLatin1String(qt_spy::protocol::keys::kId)).toString();
-    const QString childId = childNode.value(QLatin1String(qt_spy::protocol::keys::kId)).toString();
-    QVERIFY(!rootId.isEmpty());
-    QVERIFY(!childId.isEmpty());
-    QCOMPARE(childNode.value(QLatin1String(qt_spy::protocol::keys::kParentId)).toString(), rootId);
+    const qt_spy::NodeId rootId = qt_spy::protocol::nodeIdFromJson(rootNode.value(QLatin1String(qt_spy::protocol::keys::kId)));
+    const qt_spy::NodeId childId = qt_spy::protocol::nodeIdFromJson(childNode.value(QLatin1String(qt_spy::protocol::keys::kId)));
+    QVERIFY(rootId != qt_spy::protocol::kInvalidNodeId);
+    QVERIFY(childId != qt_spy::protocol::kInvalidNodeId);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(childNode.value(QLatin1String(qt_spy::protocol::keys::kParentId))), rootId);
 
     const QJsonArray rootIds = snapshot.value(QLatin1String(qt_spy::protocol::keys::kRootIds)).toArray();
-    QVERIFY(rootIds.contains(rootId));
+    QVERIFY(rootIds.contains(qt_spy::protocol::nodeIdToJson(rootId)));
 
     client.disconnectFromServer();
     probe.stop();
@@ -176,15 +204,16 @@ void BridgeClientTest::testIncrementalUpdates()
 
     const QJsonObject snapshot = takeFirstObject(snapshotSpy);
     const QJsonArray nodes = snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
-    QString notifierId;
+    qt_spy::NodeId notifierId = qt_spy::protocol::kInvalidNodeId;
     for (const QJsonValue &value : nodes) {
         const QJsonObject node = value.toObject();
         if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("notifier")) {
-            notifierId = node.value(QLatin1String(qt_spy::protocol::keys::kId)).toString();
+            notifierId = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
             break;
         }
     }
-    QVERIFY2(!notifierId.isEmpty(), "Notifier id not found in snapshot");
+    QVERIFY2(notifierId != qt_spy::protocol::kInvalidNodeId, "Notifier id not found in snapshot");
+    QVERIFY(subscribeAndWait(client, notifierId));
 
     QSignalSpy propertiesChangedSpy(&client, &qt_spy::BridgeClient::propertiesChanged);
     notifier.setValue(42);
@@ -193,7 +222,7 @@ void BridgeClientTest::testIncrementalUpdates()
     }
 
     const QJsonObject propsMessage = takeFirstObject(propertiesChangedSpy);
-    QCOMPARE(propsMessage.value(QLatin1String(qt_spy::protocol::keys::kId)).toString(), notifierId);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(propsMessage.value(QLatin1String(qt_spy::protocol::keys::kId))), notifierId);
     const QJsonArray changed = propsMessage.value(QLatin1String(qt_spy::protocol::keys::kChanged)).toArray();
     QVERIFY(changed.contains(QStringLiteral("value")));
     const QJsonObject props = propsMessage.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject();
@@ -209,8 +238,8 @@ void BridgeClientTest::testIncrementalUpdates()
 
     const QJsonObject nodeAdded = takeFirstObject(nodeAddedSpy);
     const QJsonObject addedNode = nodeAdded.value(QLatin1String(qt_spy::protocol::keys::kNode)).toObject();
-    const QString childId = addedNode.value(QLatin1String(qt_spy::protocol::keys::kId)).toString();
-    QVERIFY2(!childId.isEmpty(), "dynamic child id missing");
+    const qt_spy::NodeId childId = qt_spy::protocol::nodeIdFromJson(addedNode.value(QLatin1String(qt_spy::protocol::keys::kId)));
+    QVERIFY2(childId != qt_spy::protocol::kInvalidNodeId, "dynamic child id missing");
     QCOMPARE(addedNode.value(QStringLiteral("objectName")).toString(), QStringLiteral("dynamicChild"));
 
     QSignalSpy nodeRemovedSpy(&client, &qt_spy::BridgeClient::nodeRemoved);
@@ -219,7 +248,7 @@ void BridgeClientTest::testIncrementalUpdates()
         QSKIP("nodeRemoved not emitted (likely sandboxed)");
     }
     const QJsonObject removed = takeFirstObject(nodeRemovedSpy);
-    QCOMPARE(removed.value(QLatin1String(qt_spy::protocol::keys::kId)).toString(), childId);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(removed.value(QLatin1String(qt_spy::protocol::keys::kId))), childId);
 
     client.disconnectFromServer();
     probe.stop();
@@ -258,15 +287,15 @@ void BridgeClientTest::testRequestFlows()
 
     const QJsonObject snapshot = takeFirstObject(snapshotSpy);
     const QJsonArray nodes = snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
-    QString childId;
+    qt_spy::NodeId childId = qt_spy::protocol::kInvalidNodeId;
     for (const QJsonValue &value : nodes) {
         const QJsonObject node = value.toObject();
         if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("child")) {
-            childId = node.value(QLatin1String(qt_spy::protocol::keys::kId)).toString();
+            childId = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
             break;
         }
     }
-    QVERIFY2(!childId.isEmpty(), "child id not found in snapshot");
+    QVERIFY2(childId != qt_spy::protocol::kInvalidNodeId, "child id not found in snapshot");
 
     QSignalSpy propertiesSpy(&client, &qt_spy::BridgeClient::propertiesReceived);
     client.requestProperties(childId, QStringLiteral("req_props"));
@@ -275,7 +304,7 @@ void BridgeClientTest::testRequestFlows()
     }
 
     const QJsonObject propsMessage = takeFirstObject(propertiesSpy);
-    QCOMPARE(propsMessage.value(QLatin1String(qt_spy::protocol::keys::kId)).toString(), childId);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(propsMessage.value(QLatin1String(qt_spy::protocol::keys::kId))), childId);
     QCOMPARE(propsMessage.value(QLatin1String(qt_spy::protocol::keys::kRequestId)).toString(),
              QStringLiteral("req_props"));
     const QJsonObject props = propsMessage.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject();
@@ -290,7 +319,7 @@ void BridgeClientTest::testRequestFlows()
     const QJsonObject selectionAck = takeFirstObject(selectionSpy);
     QCOMPARE(selectionAck.value(QLatin1String(qt_spy::protocol::keys::kRequestId)).toString(),
              QStringLiteral("req_select"));
-    QCOMPARE(selectionAck.value(QLatin1String(qt_spy::protocol::keys::kId)).toString(), childId);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(selectionAck.value(QLatin1String(qt_spy::protocol::keys::kId))), childId);
 
     QSignalSpy verifySnapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
     client.requestSnapshot(QStringLiteral("req_verify"));
@@ -298,7 +327,7 @@ void BridgeClientTest::testRequestFlows()
         QSKIP("Verify snapshot not received (likely sandboxed)");
     }
     const QJsonObject verifySnapshot = takeFirstObject(verifySnapshotSpy);
-    QCOMPARE(verifySnapshot.value(QLatin1String(qt_spy::protocol::keys::kSelection)).toString(), childId);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(verifySnapshot.value(QLatin1String(qt_spy::protocol::keys::kSelection))), childId);
 
     client.disconnectFromServer();
     probe.stop();
@@ -348,6 +377,1190 @@ void BridgeClientTest::testDetachHandshake()
     probe.stop();
 }
 
+void BridgeClientTest::testCborEncoding()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("cborNotifier"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    client.setPreferredEncoding(qt_spy::protocol::Encoding::Cbor);
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("cbor-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    const QJsonObject hello = takeFirstObject(helloSpy);
+    QCOMPARE(hello.value(QLatin1String(qt_spy::protocol::keys::kEncoding)).toString(),
+             QLatin1String(qt_spy::protocol::encodings::kCbor));
+    QVERIFY(client.encoding() == qt_spy::protocol::Encoding::Cbor);
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    client.requestSnapshot(QStringLiteral("req_cbor_snapshot"));
+    if (!snapshotSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+
+    const QJsonObject snapshot = takeFirstObject(snapshotSpy);
+    QCOMPARE(snapshot.value(QLatin1String(qt_spy::protocol::keys::kRequestId)).toString(),
+             QStringLiteral("req_cbor_snapshot"));
+    qt_spy::NodeId notifierId = qt_spy::protocol::kInvalidNodeId;
+    const QJsonArray nodes = snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+    for (const QJsonValue &value : nodes) {
+        const QJsonObject node = value.toObject();
+        if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("cborNotifier")) {
+            notifierId = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+            break;
+        }
+    }
+    QVERIFY2(notifierId != qt_spy::protocol::kInvalidNodeId, "Notifier id not found in CBOR snapshot");
+    QVERIFY(subscribeAndWait(client, notifierId));
+
+    QSignalSpy propertiesChangedSpy(&client, &qt_spy::BridgeClient::propertiesChanged);
+    notifier.setValue(7);
+    if (!propertiesChangedSpy.wait(5000)) {
+        QSKIP("Property change not observed (likely sandboxed)");
+    }
+    const QJsonObject propsMessage = takeFirstObject(propertiesChangedSpy);
+    const QJsonObject props = propsMessage.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject();
+    QCOMPARE(props.value(QStringLiteral("value")).toInt(), 7);
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testChunkedSnapshot()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("chunkRoot"));
+    for (int i = 0; i < 5; ++i) {
+        auto *child = new QObject(&root);
+        child->setObjectName(QStringLiteral("chunkChild_%1").arg(i));
+    }
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("chunk-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    QSignalSpy beginSpy(&client, &qt_spy::BridgeClient::snapshotBegun);
+    QSignalSpy chunkSpy(&client, &qt_spy::BridgeClient::snapshotChunkReceived);
+    QSignalSpy endSpy(&client, &qt_spy::BridgeClient::snapshotFinished);
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+
+    qt_spy::SnapshotOptions snapshotOptions;
+    snapshotOptions.chunked = true;
+    snapshotOptions.chunkSize = 2;
+    client.requestSnapshot(QStringLiteral("req_chunked"), snapshotOptions);
+    if (!endSpy.wait(5000)) {
+        QSKIP("Chunked snapshot not received (likely sandboxed)");
+    }
+
+    QCOMPARE(beginSpy.count(), 1);
+    QCOMPARE(snapshotSpy.count(), 0);
+    const QJsonObject begin = takeFirstObject(beginSpy);
+    QCOMPARE(begin.value(QLatin1String(qt_spy::protocol::keys::kRequestId)).toString(),
+             QStringLiteral("req_chunked"));
+    QCOMPARE(begin.value(QLatin1String(qt_spy::protocol::keys::kChunkSize)).toInt(), 2);
+    const QJsonArray rootIds = begin.value(QLatin1String(qt_spy::protocol::keys::kRootIds)).toArray();
+    QVERIFY(!rootIds.isEmpty());
+
+    int receivedNodes = 0;
+    int expectedIndex = 0;
+    qt_spy::NodeId rootId = qt_spy::protocol::kInvalidNodeId;
+    QSet<qt_spy::NodeId> seenIds;
+    QSet<qt_spy::NodeId> childParents;
+    while (!chunkSpy.isEmpty()) {
+        const QJsonObject chunk = takeFirstObject(chunkSpy);
+        QCOMPARE(chunk.value(QLatin1String(qt_spy::protocol::keys::kChunkIndex)).toInt(), expectedIndex++);
+        const QJsonArray nodes = chunk.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+        QVERIFY(!nodes.isEmpty());
+        QVERIFY(nodes.size() <= 2);
+        for (const QJsonValue &value : nodes) {
+            const QJsonObject node = value.toObject();
+            const qt_spy::NodeId id = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+            const qt_spy::NodeId parentId = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kParentId)));
+            // Pre-order delivery: a parent always precedes its children.
+            QVERIFY(parentId == qt_spy::protocol::kInvalidNodeId || seenIds.contains(parentId));
+            seenIds.insert(id);
+            const QString name = node.value(QStringLiteral("objectName")).toString();
+            if (name == QStringLiteral("chunkRoot")) {
+                rootId = id;
+            } else if (name.startsWith(QStringLiteral("chunkChild_"))) {
+                childParents.insert(parentId);
+            }
+        }
+        receivedNodes += nodes.size();
+    }
+
+    QVERIFY2(rootId != qt_spy::protocol::kInvalidNodeId, "Root object missing from chunked snapshot");
+    QVERIFY(rootIds.contains(qt_spy::protocol::nodeIdToJson(rootId)));
+    QCOMPARE(childParents, QSet<qt_spy::NodeId>{rootId});
+
+    const QJsonObject end = takeFirstObject(endSpy);
+    QCOMPARE(end.value(QLatin1String(qt_spy::protocol::keys::kNodeCount)).toInt(), receivedNodes);
+    QCOMPARE(end.value(QLatin1String(qt_spy::protocol::keys::kChunkCount)).toInt(), expectedIndex);
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testFieldMask()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("maskNotifier"));
+    notifier.setProperty("dynamicTag", QStringLiteral("tagged"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("mask-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    const auto findNode = [](const QJsonObject &snapshot, const QString &objectName) {
+        const QJsonArray nodes = snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+        for (const QJsonValue &value : nodes) {
+            const QJsonObject node = value.toObject();
+            if (node.value(QStringLiteral("objectName")).toString() == objectName) {
+                return node;
+            }
+        }
+        return QJsonObject();
+    };
+
+    // Structure only: identity and hierarchy, no property reads.
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    qt_spy::SnapshotOptions structureOnly;
+    structureOnly.mask.fields = QStringList{QLatin1String(qt_spy::protocol::fields::kStructure)};
+    client.requestSnapshot(QStringLiteral("req_structure"), structureOnly);
+    if (!snapshotSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+    const QJsonObject structureNode = findNode(takeFirstObject(snapshotSpy), QStringLiteral("maskNotifier"));
+    QVERIFY(!structureNode.isEmpty());
+    QVERIFY(structureNode.contains(QLatin1String(qt_spy::protocol::keys::kId)));
+    QVERIFY(structureNode.value(QStringLiteral("className")).toString().endsWith(QStringLiteral("NotifyingObject")));
+    QVERIFY(!structureNode.contains(QLatin1String(qt_spy::protocol::keys::kProperties)));
+
+    // Everything except dynamic properties.
+    qt_spy::SnapshotOptions noDynamic;
+    noDynamic.mask.fields = QStringList{QLatin1String(qt_spy::protocol::fields::kAll),
+                                        QStringLiteral("-dynamic")};
+    client.requestSnapshot(QStringLiteral("req_no_dynamic"), noDynamic);
+    QVERIFY(snapshotSpy.wait(5000));
+    const QJsonObject staticProps = findNode(takeFirstObject(snapshotSpy), QStringLiteral("maskNotifier"))
+                                        .value(QLatin1String(qt_spy::protocol::keys::kProperties))
+                                        .toObject();
+    QVERIFY(staticProps.contains(QStringLiteral("value")));
+    QVERIFY(!staticProps.contains(QStringLiteral("__dynamic")));
+
+    // A list made only of removals starts from everything.
+    qt_spy::SnapshotOptions removalOnly;
+    removalOnly.mask.fields = QStringList{QStringLiteral("-dynamic")};
+    client.requestSnapshot(QStringLiteral("req_removal_only"), removalOnly);
+    QVERIFY(snapshotSpy.wait(5000));
+    const QJsonObject removalNode =
+        findNode(takeFirstObject(snapshotSpy), QStringLiteral("maskNotifier"));
+    const QJsonObject removalProps =
+        removalNode.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject();
+    QVERIFY(removalProps.contains(QStringLiteral("value")));
+    QVERIFY(removalProps.contains(QStringLiteral("objectName")));
+    QVERIFY(!removalProps.contains(QStringLiteral("__dynamic")));
+
+    // Property projection on a properties request, spanning static and dynamic.
+    const qt_spy::NodeId notifierId = qt_spy::protocol::nodeIdFromJson(structureNode.value(QLatin1String(qt_spy::protocol::keys::kId)));
+    QSignalSpy propertiesSpy(&client, &qt_spy::BridgeClient::propertiesReceived);
+    qt_spy::FieldMask projection;
+    projection.propertyNames = QStringList{QStringLiteral("value"), QStringLiteral("dynamicTag")};
+    client.requestProperties(notifierId, QStringLiteral("req_projection"), projection);
+    QVERIFY(propertiesSpy.wait(5000));
+    const QJsonObject projected = takeFirstObject(propertiesSpy)
+                                      .value(QLatin1String(qt_spy::protocol::keys::kProperties))
+                                      .toObject();
+    QCOMPARE(projected.size(), 2);
+    QVERIFY(projected.contains(QStringLiteral("value")));
+    QVERIFY(!projected.contains(QStringLiteral("objectName")));
+    QCOMPARE(projected.value(QStringLiteral("__dynamic")).toObject().value(QStringLiteral("dynamicTag")).toString(),
+             QStringLiteral("tagged"));
+
+    // Unknown tokens are rejected rather than silently ignored.
+    QSignalSpy errorSpy(&client, &qt_spy::BridgeClient::errorReceived);
+    qt_spy::SnapshotOptions bogus;
+    bogus.mask.fields = QStringList{QStringLiteral("everything")};
+    client.requestSnapshot(QStringLiteral("req_bogus"), bogus);
+    QVERIFY(errorSpy.wait(5000));
+    QCOMPARE(takeFirstObject(errorSpy).value(QStringLiteral("code")).toString(), QStringLiteral("invalidRequest"));
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testCoalescedPropertyChanges()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("coalesceNotifier"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("coalesce-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    client.requestSnapshot(QStringLiteral("req_coalesce"));
+    if (!snapshotSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+    qt_spy::NodeId notifierId = qt_spy::protocol::kInvalidNodeId;
+    const QJsonArray nodes =
+        takeFirstObject(snapshotSpy).value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+    for (const QJsonValue &value : nodes) {
+        const QJsonObject node = value.toObject();
+        if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("coalesceNotifier")) {
+            notifierId = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+            break;
+        }
+    }
+    QVERIFY2(notifierId != qt_spy::protocol::kInvalidNodeId, "Notifier id not found in snapshot");
+    QVERIFY(subscribeAndWait(client, notifierId));
+
+    // A burst within one event-loop pass collapses into a single delta.
+    QSignalSpy propertiesChangedSpy(&client, &qt_spy::BridgeClient::propertiesChanged);
+    for (int i = 1; i <= 10; ++i) {
+        notifier.setValue(i);
+    }
+    notifier.setProperty("burstTag", QStringLiteral("done"));
+    if (!propertiesChangedSpy.wait(5000)) {
+        QSKIP("Property change not observed (likely sandboxed)");
+    }
+    QTest::qWait(100);
+    QCOMPARE(propertiesChangedSpy.count(), 1);
+
+    const QJsonObject message = takeFirstObject(propertiesChangedSpy);
+    const QJsonArray changed = message.value(QLatin1String(qt_spy::protocol::keys::kChanged)).toArray();
+    QCOMPARE(changed.size(), 2);
+    QVERIFY(changed.contains(QStringLiteral("value")));
+    QVERIFY(changed.contains(QStringLiteral("burstTag")));
+
+    const QJsonObject props = message.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject();
+    QCOMPARE(props.value(QStringLiteral("value")).toInt(), 10);
+    QCOMPARE(props.value(QStringLiteral("__dynamic")).toObject().value(QStringLiteral("burstTag")).toString(),
+             QStringLiteral("done"));
+    QVERIFY(!props.contains(QStringLiteral("objectName")));
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testNodeIdsNotReused()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("idRoot"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("id-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    QSignalSpy nodeAddedSpy(&client, &qt_spy::BridgeClient::nodeAdded);
+    QSignalSpy nodeRemovedSpy(&client, &qt_spy::BridgeClient::nodeRemoved);
+    const auto addedId = [&nodeAddedSpy]() {
+        const QJsonObject node = takeFirstObject(nodeAddedSpy).value(QLatin1String(qt_spy::protocol::keys::kNode)).toObject();
+        return qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+    };
+
+    auto *first = new QObject(&root);
+    if (!nodeAddedSpy.wait(5000)) {
+        delete first;
+        QSKIP("nodeAdded not emitted (likely sandboxed)");
+    }
+    const qt_spy::NodeId firstId = addedId();
+    QVERIFY(firstId != qt_spy::protocol::kInvalidNodeId);
+
+    delete first;
+    QVERIFY(nodeRemovedSpy.wait(5000));
+
+    // The allocator will usually hand the same address straight back; the
+    // replacement must still get a fresh id.
+    auto *second = new QObject(&root);
+    QVERIFY(nodeAddedSpy.wait(5000));
+    const qt_spy::NodeId secondId = addedId();
+    QVERIFY(secondId > firstId);
+
+    QSignalSpy errorSpy(&client, &qt_spy::BridgeClient::errorReceived);
+    client.requestProperties(firstId, QStringLiteral("req_stale"));
+    QVERIFY(errorSpy.wait(5000));
+    QCOMPARE(takeFirstObject(errorSpy).value(QStringLiteral("code")).toString(), QStringLiteral("unknownNode"));
+
+    delete second;
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testSubtreeSnapshot()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("subtreeRoot"));
+    QObject level1(&root);
+    level1.setObjectName(QStringLiteral("level1"));
+    QObject level2(&level1);
+    level2.setObjectName(QStringLiteral("level2"));
+    QObject level3(&level2);
+    level3.setObjectName(QStringLiteral("level3"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("subtree-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    const auto nodesByName = [](const QJsonObject &snapshot) {
+        QHash<QString, QJsonObject> byName;
+        const QJsonArray nodes = snapshot.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+        for (const QJsonValue &value : nodes) {
+            const QJsonObject node = value.toObject();
+            byName.insert(node.value(QStringLiteral("objectName")).toString(), node);
+        }
+        return byName;
+    };
+    const auto idOf = [](const QJsonObject &node) {
+        return qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+    };
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    qt_spy::SnapshotOptions structureOnly;
+    structureOnly.mask.fields = QStringList{QLatin1String(qt_spy::protocol::fields::kStructure)};
+    client.requestSnapshot(QStringLiteral("req_full"), structureOnly);
+    if (!snapshotSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+    const QHash<QString, QJsonObject> full = nodesByName(takeFirstObject(snapshotSpy));
+    QVERIFY(full.contains(QStringLiteral("level3")));
+    const qt_spy::NodeId rootId = idOf(full.value(QStringLiteral("subtreeRoot")));
+    const qt_spy::NodeId level1Id = idOf(full.value(QStringLiteral("level1")));
+
+    // level1 and one level below it; level2 reports its cut-off child.
+    qt_spy::SnapshotOptions subtree = structureOnly;
+    subtree.rootId = level1Id;
+    subtree.maxDepth = 1;
+    client.requestSnapshot(QStringLiteral("req_subtree"), subtree);
+    QVERIFY(snapshotSpy.wait(5000));
+    const QJsonObject reply = takeFirstObject(snapshotSpy);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(reply.value(QLatin1String(qt_spy::protocol::keys::kRootId))), level1Id);
+    QCOMPARE(reply.value(QLatin1String(qt_spy::protocol::keys::kMaxDepth)).toInt(), 1);
+    const QJsonArray rootIds = reply.value(QLatin1String(qt_spy::protocol::keys::kRootIds)).toArray();
+    QCOMPARE(rootIds.size(), 1);
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(rootIds.at(0)), level1Id);
+
+    const QHash<QString, QJsonObject> partial = nodesByName(reply);
+    QCOMPARE(partial.size(), 2);
+    const QJsonObject level1Node = partial.value(QStringLiteral("level1"));
+    QCOMPARE(qt_spy::protocol::nodeIdFromJson(level1Node.value(QLatin1String(qt_spy::protocol::keys::kParentId))), rootId);
+    QCOMPARE(level1Node.value(QLatin1String(qt_spy::protocol::keys::kChildIds)).toArray().size(), 1);
+    const QJsonObject level2Node = partial.value(QStringLiteral("level2"));
+    QVERIFY(!level2Node.contains(QLatin1String(qt_spy::protocol::keys::kChildIds)));
+    QCOMPARE(level2Node.value(QLatin1String(qt_spy::protocol::keys::kChildCount)).toInt(), 1);
+
+    QSignalSpy errorSpy(&client, &qt_spy::BridgeClient::errorReceived);
+    qt_spy::SnapshotOptions unknownRoot;
+    unknownRoot.rootId = qt_spy::protocol::kMaxNodeId;
+    client.requestSnapshot(QStringLiteral("req_unknown_root"), unknownRoot);
+    QVERIFY(errorSpy.wait(5000));
+    QCOMPARE(takeFirstObject(errorSpy).value(QStringLiteral("code")).toString(), QStringLiteral("unknownNode"));
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testStatsRequest()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("statsRoot"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("stats-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    client.requestSnapshot(QStringLiteral("req_snapshot"));
+    if (!snapshotSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+
+    QSignalSpy statsSpy(&client, &qt_spy::BridgeClient::statsReceived);
+    client.requestStats(QStringLiteral("req_stats"));
+    QVERIFY(statsSpy.wait(5000));
+    const QJsonObject reply = takeFirstObject(statsSpy);
+    QCOMPARE(reply.value(QLatin1String(qt_spy::protocol::keys::kRequestId)).toString(),
+             QStringLiteral("req_stats"));
+
+    const QJsonObject stats = reply.value(QLatin1String(qt_spy::protocol::keys::kStats)).toObject();
+    QVERIFY(stats.value(QStringLiteral("trackedObjects")).toInt() > 0);
+    QCOMPARE(stats.value(QStringLiteral("connections")).toInt(), 1);
+
+    const QJsonObject latency = stats.value(QStringLiteral("latency")).toObject();
+    const QJsonObject capture = latency.value(QStringLiteral("snapshotCapture")).toObject();
+    QCOMPARE(capture.value(QStringLiteral("count")).toInt(), 1);
+    QVERIFY(capture.value(QStringLiteral("p99Ns")).toDouble() > 0);
+    QVERIFY(latency.value(QStringLiteral("install")).toObject().value(QStringLiteral("count")).toInt() > 0);
+
+    // Traffic is counted once written, so the snapshot is in and this reply is not.
+    const QJsonObject sent = stats.value(QStringLiteral("sentByType")).toObject();
+    const QJsonObject snapshotTraffic = sent.value(QLatin1String(qt_spy::protocol::types::kSnapshot)).toObject();
+    QCOMPARE(snapshotTraffic.value(QStringLiteral("frames")).toInt(), 1);
+    QVERIFY(snapshotTraffic.value(QStringLiteral("bytes")).toDouble() > 0);
+    QVERIFY(sent.contains(QLatin1String(qt_spy::protocol::types::kHello)));
+    QVERIFY(!sent.contains(QLatin1String(qt_spy::protocol::types::kStats)));
+
+    // Each client's subscriptions are reported on their own.
+    const QJsonArray snapshotNodes = takeFirstObject(snapshotSpy)
+                                         .value(QLatin1String(qt_spy::protocol::keys::kNodes))
+                                         .toArray();
+    qt_spy::NodeId rootId = qt_spy::protocol::kInvalidNodeId;
+    for (const QJsonValue &value : snapshotNodes) {
+        const QJsonObject node = value.toObject();
+        if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("statsRoot")) {
+            rootId = qt_spy::protocol::nodeIdFromJson(node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+        }
+    }
+    QVERIFY(rootId != qt_spy::protocol::kInvalidNodeId);
+
+    qt_spy::BridgeClient other;
+    QSignalSpy otherHelloSpy(&other, &qt_spy::BridgeClient::helloReceived);
+    QVERIFY(connectAndAttach(other, serverName, otherHelloSpy, QStringLiteral("stats-other")));
+    QSignalSpy ackSpy(&client, &qt_spy::BridgeClient::subscriptionAckReceived);
+    client.subscribe({rootId}, {QStringLiteral("objectName")});
+    QVERIFY(ackSpy.wait(5000));
+    QVERIFY(subscribeAndWait(other, rootId));
+
+    client.requestStats(QStringLiteral("req_stats_subscriptions"));
+    QVERIFY(statsSpy.wait(5000));
+    const QJsonArray perConnection = takeFirstObject(statsSpy)
+                                         .value(QLatin1String(qt_spy::protocol::keys::kStats))
+                                         .toObject()
+                                         .value(QStringLiteral("perConnection"))
+                                         .toArray();
+    QCOMPARE(perConnection.size(), 2);
+    QHash<QString, QJsonObject> byClient;
+    for (const QJsonValue &value : perConnection) {
+        const QJsonObject entry = value.toObject();
+        byClient.insert(entry.value(QStringLiteral("clientName")).toString(), entry);
+    }
+    const QJsonObject named = byClient.value(QStringLiteral("stats-test"));
+    QCOMPARE(named.value(QStringLiteral("subscribedNodes")).toInt(), 1);
+    QCOMPARE(named.value(QStringLiteral("subscribedPropertyNames")).toInt(), 1);
+    QCOMPARE(named.value(QStringLiteral("allPropertiesNodes")).toInt(), 0);
+    QCOMPARE(named.value(QStringLiteral("subscribedIds")).toArray(),
+             QJsonArray{qt_spy::protocol::nodeIdToJson(rootId)});
+    const QJsonObject everything = byClient.value(QStringLiteral("stats-other"));
+    QCOMPARE(everything.value(QStringLiteral("subscribedNodes")).toInt(), 1);
+    QCOMPARE(everything.value(QStringLiteral("subscribedPropertyNames")).toInt(), 0);
+    QCOMPARE(everything.value(QStringLiteral("allPropertiesNodes")).toInt(), 1);
+
+    other.disconnectFromServer();
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testFrameCompression()
+{
+    constexpr int kObjects = 500;
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    options.compressFramesAbove = 4096;
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("compressedRoot"));
+    for (int i = 0; i < kObjects; ++i) {
+        auto *object = new QObject(&root);
+        object->setObjectName(QStringLiteral("compressedObject%1").arg(i));
+    }
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    // A client that does not offer compression only ever gets raw frames.
+    qt_spy::BridgeClient plain;
+    plain.setFrameCompression(false);
+    QSignalSpy plainHelloSpy(&plain, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(plain, serverName, plainHelloSpy, QStringLiteral("plain-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    QVERIFY(!takeFirstObject(plainHelloSpy).contains(QLatin1String(qt_spy::protocol::keys::kCompression)));
+    QVERIFY(!plain.frameCompressionNegotiated());
+
+    QSignalSpy plainSnapshotSpy(&plain, &qt_spy::BridgeClient::snapshotReceived);
+    plain.requestSnapshot(QStringLiteral("req_plain"));
+    QVERIFY(plainSnapshotSpy.wait(5000));
+    const int plainNodes = takeFirstObject(plainSnapshotSpy)
+                               .value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray().size();
+    QVERIFY(plainNodes > kObjects);
+    QCOMPARE(probe.stats().compressedFrames, quint64(0));
+
+    qt_spy::BridgeClient client;
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    QVERIFY(connectAndAttach(client, serverName, helloSpy, QStringLiteral("compressed-test")));
+    QCOMPARE(takeFirstObject(helloSpy).value(QLatin1String(qt_spy::protocol::keys::kCompression)).toString(),
+             QLatin1String(qt_spy::protocol::compressions::kZlib));
+    QVERIFY(client.frameCompressionNegotiated());
+
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    client.requestSnapshot(QStringLiteral("req_compressed"));
+    QVERIFY(snapshotSpy.wait(5000));
+    const QJsonArray nodes = takeFirstObject(snapshotSpy)
+                                 .value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+    QCOMPARE(nodes.size(), plainNodes);
+
+    const qt_spy::ProbeStats stats = probe.stats();
+    QCOMPARE(stats.compressedFrames, quint64(1));
+    QVERIFY(stats.compressionOutputBytes * 2 < stats.compressionInputBytes);
+    QVERIFY(stats.compressionNs > 0);
+
+    // Small frames stay raw on the same connection.
+    QSignalSpy selectionSpy(&client, &qt_spy::BridgeClient::selectionAckReceived);
+    client.selectNode(qt_spy::protocol::nodeIdFromJson(
+        nodes.first().toObject().value(QLatin1String(qt_spy::protocol::keys::kId))));
+    QVERIFY(selectionSpy.wait(5000));
+    QCOMPARE(probe.stats().compressedFrames, quint64(1));
+
+    client.disconnectFromServer();
+    plain.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testCorrelatedRequests()
+{
+    constexpr int kPipelined = 50;
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("correlatedRoot"));
+    QVector<QObject *> children;
+    for (int i = 0; i < kPipelined; ++i) {
+        auto *child = new QObject(&root);
+        child->setObjectName(QStringLiteral("correlated%1").arg(i));
+        children.append(child);
+    }
+
+    qt_spy::BridgeClient client;
+
+    // Without a connection the reply still finishes, from the event loop.
+    qt_spy::BridgeReply *offline = client.sendStatsRequest();
+    QSignalSpy offlineSpy(offline, &qt_spy::BridgeReply::finished);
+    QVERIFY(!offline->isFinished());
+    QVERIFY(offlineSpy.wait(5000));
+    QCOMPARE(offline->status(), qt_spy::BridgeReply::Status::Disconnected);
+    delete offline;
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("correlated-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    qt_spy::BridgeReply *snapshot = client.sendSnapshotRequest();
+    QSignalSpy snapshotSpy(snapshot, &qt_spy::BridgeReply::finished);
+    QVERIFY(snapshotSpy.wait(5000));
+    QCOMPARE(snapshot->status(), qt_spy::BridgeReply::Status::Finished);
+    QCOMPARE(snapshot->requestType(), qt_spy::protocol::MessageType::SnapshotRequest);
+    QHash<QString, qt_spy::NodeId> idsByName;
+    const QJsonArray nodes = snapshot->message().value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+    for (const QJsonValue &value : nodes) {
+        const QJsonObject node = value.toObject();
+        idsByName.insert(node.value(QStringLiteral("objectName")).toString(),
+                         qt_spy::protocol::nodeIdFromJson(
+                             node.value(QLatin1String(qt_spy::protocol::keys::kId))));
+    }
+    delete snapshot;
+
+    // Many property reads in flight at once, each answered on its own reply.
+    QVector<qt_spy::BridgeReply *> replies;
+    QHash<qt_spy::BridgeReply *, QString> expectedNames;
+    int finished = 0;
+    for (QObject *child : std::as_const(children)) {
+        const qt_spy::NodeId id = idsByName.value(child->objectName());
+        QVERIFY(id != qt_spy::protocol::kInvalidNodeId);
+        qt_spy::BridgeReply *reply = client.sendPropertiesRequest(id);
+        connect(reply, &qt_spy::BridgeReply::finished, this, [&finished]() { ++finished; });
+        replies.append(reply);
+        expectedNames.insert(reply, child->objectName());
+    }
+    QCOMPARE(client.pendingRequestCount(), kPipelined);
+
+    // An error raised for a request finishes that request's reply.
+    qt_spy::BridgeReply *unknown = client.sendPropertiesRequest(qt_spy::protocol::kMaxNodeId);
+    QSignalSpy unknownSpy(unknown, &qt_spy::BridgeReply::finished);
+    QVERIFY(unknownSpy.wait(5000));
+    QCOMPARE(unknown->status(), qt_spy::BridgeReply::Status::Error);
+    QCOMPARE(unknown->message().value(QStringLiteral("code")).toString(), QStringLiteral("unknownNode"));
+    delete unknown;
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished, kPipelined, 5000);
+    for (qt_spy::BridgeReply *reply : std::as_const(replies)) {
+        QCOMPARE(reply->status(), qt_spy::BridgeReply::Status::Finished);
+        const QJsonObject properties = reply->message()
+                                           .value(QLatin1String(qt_spy::protocol::keys::kProperties))
+                                           .toObject();
+        QCOMPARE(properties.value(QStringLiteral("objectName")).toString(), expectedNames.value(reply));
+    }
+    qDeleteAll(replies);
+    QCOMPARE(client.pendingRequestCount(), 0);
+
+    // A canceled reply stays canceled when the answer turns up.
+    QSignalSpy statsSpy(&client, &qt_spy::BridgeClient::statsReceived);
+    qt_spy::BridgeReply *canceled = client.sendStatsRequest();
+    QSignalSpy canceledSpy(canceled, &qt_spy::BridgeReply::finished);
+    canceled->cancel();
+    QCOMPARE(canceledSpy.count(), 1);
+    QVERIFY(statsSpy.wait(5000));
+    QCOMPARE(canceled->status(), qt_spy::BridgeReply::Status::Canceled);
+    QCOMPARE(canceledSpy.count(), 1);
+    delete canceled;
+
+    // Pending replies finish when the connection goes away.
+    qt_spy::BridgeReply *orphan = client.sendSnapshotRequest();
+    orphan->setTimeout(0);
+    QSignalSpy orphanSpy(orphan, &qt_spy::BridgeReply::finished);
+    client.disconnectFromServer();
+    QVERIFY(orphanSpy.count() == 1 || orphanSpy.wait(5000));
+    QCOMPARE(orphan->status(), qt_spy::BridgeReply::Status::Disconnected);
+    delete orphan;
+
+    probe.stop();
+}
+
+void BridgeClientTest::testWorkerThreadIo()
+{
+    constexpr int kObjects = 300;
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("workerNotifier"));
+    for (int i = 0; i < kObjects; ++i) {
+        auto *object = new QObject(&notifier);
+        object->setObjectName(QStringLiteral("workerObject%1").arg(i));
+    }
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client(qt_spy::BridgeClient::IoMode::WorkerThread);
+    QCOMPARE(client.ioMode(), qt_spy::BridgeClient::IoMode::WorkerThread);
+
+    // Everything is still delivered on the client's own thread.
+    bool offThread = false;
+    const auto checkThread = [&client, &offThread]() {
+        offThread = offThread || QThread::currentThread() != client.thread();
+    };
+    connect(&client, &qt_spy::BridgeClient::socketConnected, this, checkThread);
+    connect(&client, &qt_spy::BridgeClient::snapshotChunkReceived, this, checkThread);
+    connect(&client, &qt_spy::BridgeClient::propertiesChanged, this, checkThread);
+
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("worker-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    QCOMPARE(client.state(), QLocalSocket::ConnectedState);
+
+    // Small chunks arrive as bursts of frames, decoded in one go on the
+    // worker and dispatched in order.
+    QSignalSpy chunkSpy(&client, &qt_spy::BridgeClient::snapshotChunkReceived);
+    QSignalSpy endSpy(&client, &qt_spy::BridgeClient::snapshotFinished);
+    qt_spy::SnapshotOptions snapshotOptions;
+    snapshotOptions.chunked = true;
+    snapshotOptions.chunkSize = 4;
+    client.requestSnapshot(QStringLiteral("req_worker"), snapshotOptions);
+    QVERIFY(endSpy.wait(5000));
+    const int chunkCount = takeFirstObject(endSpy)
+                               .value(QLatin1String(qt_spy::protocol::keys::kChunkCount)).toInt();
+    QVERIFY(chunkCount > kObjects / 4);
+    QCOMPARE(chunkSpy.count(), chunkCount);
+
+    qt_spy::NodeId notifierId = qt_spy::protocol::kInvalidNodeId;
+    for (int i = 0; i < chunkCount; ++i) {
+        const QJsonObject chunk = takeFirstObject(chunkSpy);
+        QCOMPARE(chunk.value(QLatin1String(qt_spy::protocol::keys::kChunkIndex)).toInt(), i);
+        const QJsonArray nodes = chunk.value(QLatin1String(qt_spy::protocol::keys::kNodes)).toArray();
+        for (const QJsonValue &value : nodes) {
+            const QJsonObject node = value.toObject();
+            if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("workerNotifier")) {
+                notifierId = qt_spy::protocol::nodeIdFromJson(
+                    node.value(QLatin1String(qt_spy::protocol::keys::kId)));
+            }
+        }
+    }
+    QVERIFY(notifierId != qt_spy::protocol::kInvalidNodeId);
+
+    // Requests and their replies go through the worker as well.
+    qt_spy::BridgeReply *subscription = client.sendSubscribe({notifierId});
+    QSignalSpy subscriptionSpy(subscription, &qt_spy::BridgeReply::finished);
+    QVERIFY(subscriptionSpy.wait(5000));
+    QCOMPARE(subscription->status(), qt_spy::BridgeReply::Status::Finished);
+    delete subscription;
+
+    QSignalSpy propertiesChangedSpy(&client, &qt_spy::BridgeClient::propertiesChanged);
+    notifier.setValue(7);
+    QVERIFY(propertiesChangedSpy.wait(5000));
+    const QJsonObject change = takeFirstObject(propertiesChangedSpy);
+    QCOMPARE(change.value(QLatin1String(qt_spy::protocol::keys::kType)).toString(),
+             QLatin1String(qt_spy::protocol::types::kPropertiesChanged));
+    QCOMPARE(change.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject()
+                 .value(QStringLiteral("value")).toInt(),
+             7);
+
+    QVERIFY(!offThread);
+
+    QSignalSpy disconnectedSpy(&client, &qt_spy::BridgeClient::socketDisconnected);
+    client.disconnectFromServer();
+    QVERIFY(disconnectedSpy.wait(5000));
+    QCOMPARE(client.state(), QLocalSocket::UnconnectedState);
+
+    probe.stop();
+}
+
+void BridgeClientTest::testObjectReplica()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("replicaRoot"));
+    auto *firstTwin = new QObject(&root);
+    firstTwin->setObjectName(QStringLiteral("twin"));
+    QObject secondTwin(&root);
+    secondTwin.setObjectName(QStringLiteral("twin"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    qt_spy::ObjectReplica replica;
+    replica.attach(&client);
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("replica-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+
+    QSignalSpy appliedSpy(&replica, &qt_spy::ObjectReplica::snapshotApplied);
+    client.requestSnapshot(QStringLiteral("req_replica"));
+    if (!appliedSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+
+    const QVector<qt_spy::NodeId> roots = replica.findByObjectName(QStringLiteral("replicaRoot"));
+    QCOMPARE(roots.size(), 1);
+    const qt_spy::NodeId rootId = roots.first();
+    const QVector<qt_spy::NodeId> twins = replica.findByObjectName(QStringLiteral("twin"));
+    QCOMPARE(twins.size(), 2);
+    QVERIFY(twins.first() < twins.last());
+    const QVector<qt_spy::NodeId> plainObjects = replica.findByClass(QStringLiteral("QObject"));
+    for (const qt_spy::NodeId twinId : twins) {
+        QVERIFY(plainObjects.contains(twinId));
+        QCOMPARE(replica.parentId(twinId), rootId);
+        QVERIFY(replica.childIds(rootId).contains(twinId));
+    }
+    const qt_spy::ReplicaNode firstNode = replica.node(twins.first());
+    QCOMPARE(firstNode.className, QStringLiteral("QObject"));
+    QVERIFY(firstNode.details.contains(QStringLiteral("address")));
+    QVERIFY(!replica.node(qt_spy::protocol::kMaxNodeId).isValid());
+
+    // Incremental updates land without another snapshot.
+    QVERIFY(subscribeAndWait(client, rootId));
+    QSignalSpy changedSpy(&replica, &qt_spy::ObjectReplica::propertiesChanged);
+    root.setValue(7);
+    if (!changedSpy.wait(5000)) {
+        QSKIP("Property change not observed (likely sandboxed)");
+    }
+    QCOMPARE(changedSpy.first().at(0).value<qt_spy::NodeId>(), rootId);
+    QVERIFY(changedSpy.first().at(1).toStringList().contains(QStringLiteral("value")));
+    QCOMPARE(replica.properties(rootId).value(QStringLiteral("value")).toInt(), 7);
+
+    // Removing a dynamic property removes it from the replica too.
+    const auto dynamicTag = [&replica, rootId]() {
+        return replica.properties(rootId).value(QStringLiteral("__dynamic")).toObject()
+            .value(QStringLiteral("replicaTag"));
+    };
+    root.setProperty("replicaTag", QStringLiteral("tagged"));
+    QTRY_COMPARE_WITH_TIMEOUT(dynamicTag().toString(), QStringLiteral("tagged"), 5000);
+    root.setProperty("replicaTag", QVariant());
+    QTRY_VERIFY_WITH_TIMEOUT(dynamicTag().isUndefined(), 5000);
+
+    QSignalSpy addedSpy(&replica, &qt_spy::ObjectReplica::nodeAdded);
+    QObject late(&root);
+    late.setObjectName(QStringLiteral("late"));
+    if (!addedSpy.wait(5000)) {
+        QSKIP("nodeAdded not emitted (likely sandboxed)");
+    }
+    const QVector<qt_spy::NodeId> lateIds = replica.findByObjectName(QStringLiteral("late"));
+    QCOMPARE(lateIds.size(), 1);
+    QCOMPARE(addedSpy.first().at(0).value<qt_spy::NodeId>(), lateIds.first());
+    QCOMPARE(addedSpy.first().at(1).value<qt_spy::NodeId>(), rootId);
+    QVERIFY(replica.childIds(rootId).contains(lateIds.first()));
+
+    QSignalSpy removedSpy(&replica, &qt_spy::ObjectReplica::nodeRemoved);
+    const int sizeBefore = replica.size();
+    delete firstTwin;
+    if (!removedSpy.wait(5000)) {
+        QSKIP("nodeRemoved not emitted (likely sandboxed)");
+    }
+    QCOMPARE(removedSpy.first().at(0).value<qt_spy::NodeId>(), twins.first());
+    QVERIFY(!replica.contains(twins.first()));
+    QCOMPARE(replica.size(), sizeBefore - 1);
+    QCOMPARE(replica.findByObjectName(QStringLiteral("twin")), QVector<qt_spy::NodeId>{twins.last()});
+    QVERIFY(!replica.childIds(rootId).contains(twins.first()));
+
+    // A chunked snapshot replaces the contents and ends up with the same tree.
+    QSignalSpy resetSpy(&replica, &qt_spy::ObjectReplica::reset);
+    appliedSpy.clear();
+    qt_spy::SnapshotOptions chunked;
+    chunked.chunked = true;
+    chunked.chunkSize = 2;
+    client.requestSnapshot(QStringLiteral("req_replica_chunked"), chunked);
+    QTRY_COMPARE_WITH_TIMEOUT(appliedSpy.count(), 1, 5000);
+    QCOMPARE(resetSpy.count(), 1);
+    QVERIFY(replica.isComplete());
+    QCOMPARE(replica.findByObjectName(QStringLiteral("replicaRoot")), roots);
+    QCOMPARE(replica.findByObjectName(QStringLiteral("late")), lateIds);
+    QCOMPARE(replica.findByObjectName(QStringLiteral("twin")).size(), 1);
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testResumeAfterReconnect()
+{
+    namespace protocol = qt_spy::protocol;
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    options.eventJournalSize = 16;
+    options.resumeWindowMs = 30000;
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("resumeNotifier"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    qt_spy::BridgeClient client;
+    client.setResumeEnabled(true);
+    qt_spy::ObjectReplica replica;
+    replica.attach(&client);
+    QSignalSpy helloSpy(&client, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("resume-test"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    const QJsonObject firstHello = takeFirstObject(helloSpy);
+    const QString session = firstHello.value(QLatin1String(protocol::keys::kSession)).toString();
+    QVERIFY(!session.isEmpty());
+    QVERIFY(!client.resumed());
+
+    QSignalSpy appliedSpy(&replica, &qt_spy::ObjectReplica::snapshotApplied);
+    client.requestSnapshot(QStringLiteral("req_resume"));
+    if (!appliedSpy.wait(5000)) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+    const QVector<qt_spy::NodeId> notifierIds =
+        replica.findByObjectName(QStringLiteral("resumeNotifier"));
+    QCOMPARE(notifierIds.size(), 1);
+    const qt_spy::NodeId notifierId = notifierIds.first();
+    QVERIFY(subscribeAndWait(client, notifierId));
+
+    QSignalSpy changedSpy(&client, &qt_spy::BridgeClient::propertiesChanged);
+    notifier.setValue(1);
+    if (!changedSpy.wait(5000)) {
+        QSKIP("Property change not observed (likely sandboxed)");
+    }
+    const quint64 seenBeforeDrop = client.lastSequence();
+    const double changeSeq =
+        takeFirstObject(changedSpy).value(QLatin1String(protocol::keys::kSeq)).toDouble();
+    QVERIFY(changeSeq > 0.0);
+    QVERIFY(changeSeq <= static_cast<double>(seenBeforeDrop));
+
+    // Changes made while the client is away are journaled by the probe.
+    QSignalSpy disconnectedSpy(&client, &qt_spy::BridgeClient::socketDisconnected);
+    client.disconnectFromServer();
+    QTRY_COMPARE_WITH_TIMEOUT(disconnectedSpy.count(), 1, 5000);
+    QObject missed(&notifier);
+    missed.setObjectName(QStringLiteral("missed"));
+    notifier.setValue(2);
+    QTest::qWait(100);
+
+    // Reattaching resumes the session: only the missed events follow, on top
+    // of what the replica already holds.
+    QSignalSpy snapshotSpy(&client, &qt_spy::BridgeClient::snapshotReceived);
+    QSignalSpy addedSpy(&client, &qt_spy::BridgeClient::nodeAdded);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("resume-test"))) {
+        QSKIP("Bridge client reconnection not available (likely sandboxed)");
+    }
+    const QJsonObject resumedHello = takeFirstObject(helloSpy);
+    QVERIFY(resumedHello.value(QLatin1String(protocol::keys::kResumed)).toBool());
+    QCOMPARE(resumedHello.value(QLatin1String(protocol::keys::kSession)).toString(), session);
+    QVERIFY(client.resumed());
+    QTRY_COMPARE_WITH_TIMEOUT(replica.findByObjectName(QStringLiteral("missed")).size(), 1, 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(replica.properties(notifierId).value(QStringLiteral("value")).toInt(),
+                              2, 5000);
+    QVERIFY(!addedSpy.isEmpty());
+    QVERIFY(addedSpy.first().at(0).toJsonObject().value(QLatin1String(protocol::keys::kSeq))
+                .toDouble()
+            > static_cast<double>(seenBeforeDrop));
+    QVERIFY(client.lastSequence() > seenBeforeDrop);
+    QCOMPARE(snapshotSpy.count(), 0);
+    QCOMPARE(replica.findByObjectName(QStringLiteral("resumeNotifier")), notifierIds);
+
+    // Missing more than the journal holds needs a fresh snapshot.
+    disconnectedSpy.clear();
+    client.disconnectFromServer();
+    QTRY_COMPARE_WITH_TIMEOUT(disconnectedSpy.count(), 1, 5000);
+    for (int value = 3; value < 3 + 2 * options.eventJournalSize; ++value) {
+        notifier.setValue(value);
+        QTest::qWait(5);
+    }
+    QTest::qWait(50);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("resume-test"))) {
+        QSKIP("Bridge client reconnection not available (likely sandboxed)");
+    }
+    QVERIFY(!takeFirstObject(helloSpy).value(QLatin1String(protocol::keys::kResumed)).toBool());
+    QVERIFY(!client.resumed());
+
+    // Without a snapshot since, there is nothing to resume from.
+    disconnectedSpy.clear();
+    client.disconnectFromServer();
+    QTRY_COMPARE_WITH_TIMEOUT(disconnectedSpy.count(), 1, 5000);
+    if (!connectAndAttach(client, serverName, helloSpy, QStringLiteral("resume-test"))) {
+        QSKIP("Bridge client reconnection not available (likely sandboxed)");
+    }
+    QVERIFY(!client.resumed());
+
+    client.disconnectFromServer();
+    probe.stop();
+}
+
+void BridgeClientTest::testResumeKeepsOwnSubscriptions()
+{
+    namespace protocol = qt_spy::protocol;
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("bridge_client"));
+    options.resumeWindowMs = 30000;
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("sharedResumeNotifier"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    // Two clients watch the same node, one of them only its value.
+    qt_spy::BridgeClient narrow;
+    narrow.setResumeEnabled(true);
+    qt_spy::ObjectReplica replica;
+    replica.attach(&narrow);
+    qt_spy::BridgeClient wide;
+    wide.setResumeEnabled(true);
+    QSignalSpy narrowHelloSpy(&narrow, &qt_spy::BridgeClient::helloReceived);
+    QSignalSpy wideHelloSpy(&wide, &qt_spy::BridgeClient::helloReceived);
+    if (!connectAndAttach(narrow, serverName, narrowHelloSpy, QStringLiteral("resume-narrow"))
+        || !connectAndAttach(wide, serverName, wideHelloSpy, QStringLiteral("resume-wide"))) {
+        QSKIP("Bridge client connection not available (likely sandboxed)");
+    }
+    const QString narrowSession =
+        takeFirstObject(narrowHelloSpy).value(QLatin1String(protocol::keys::kSession)).toString();
+    const QString wideSession =
+        takeFirstObject(wideHelloSpy).value(QLatin1String(protocol::keys::kSession)).toString();
+    QVERIFY(!narrowSession.isEmpty());
+    QVERIFY(narrowSession != wideSession);
+
+    QSignalSpy appliedSpy(&replica, &qt_spy::ObjectReplica::snapshotApplied);
+    QSignalSpy wideSnapshotSpy(&wide, &qt_spy::BridgeClient::snapshotReceived);
+    narrow.requestSnapshot(QStringLiteral("req_narrow"));
+    wide.requestSnapshot(QStringLiteral("req_wide"));
+    if (!appliedSpy.wait(5000) || (wideSnapshotSpy.isEmpty() && !wideSnapshotSpy.wait(5000))) {
+        QSKIP("Snapshot message not received (likely sandboxed)");
+    }
+    const QVector<qt_spy::NodeId> notifierIds =
+        replica.findByObjectName(QStringLiteral("sharedResumeNotifier"));
+    QCOMPARE(notifierIds.size(), 1);
+    const qt_spy::NodeId notifierId = notifierIds.first();
+
+    QSignalSpy ackSpy(&narrow, &qt_spy::BridgeClient::subscriptionAckReceived);
+    narrow.subscribe({notifierId}, {QStringLiteral("value")});
+    QVERIFY(ackSpy.wait(5000));
+    QVERIFY(subscribeAndWait(wide, notifierId));
+
+    // Both drop; each is parked under its own session.
+    QSignalSpy narrowDisconnectedSpy(&narrow, &qt_spy::BridgeClient::socketDisconnected);
+    QSignalSpy wideDisconnectedSpy(&wide, &qt_spy::BridgeClient::socketDisconnected);
+    narrow.disconnectFromServer();
+    wide.disconnectFromServer();
+    QTRY_COMPARE_WITH_TIMEOUT(narrowDisconnectedSpy.count(), 1, 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(wideDisconnectedSpy.count(), 1, 5000);
+    notifier.setObjectName(QStringLiteral("renamedWhileAway"));
+    notifier.setValue(5);
+    QTest::qWait(100);
+
+    const auto sawChange = [](const QSignalSpy &spy, const QString &name) {
+        for (const QList<QVariant> &arguments : spy) {
+            const QJsonObject change = arguments.at(0).toJsonObject();
+            if (change.value(QLatin1String(qt_spy::protocol::keys::kChanged)).toArray()
+                    .contains(name)
+                || change.value(QLatin1String(qt_spy::protocol::keys::kProperties)).toObject()
+                       .contains(name)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // The missed changes are narrowed to what each client subscribed to.
+    QSignalSpy narrowChangedSpy(&narrow, &qt_spy::BridgeClient::propertiesChanged);
+    if (!connectAndAttach(narrow, serverName, narrowHelloSpy, QStringLiteral("resume-narrow"))) {
+        QSKIP("Bridge client reconnection not available (likely sandboxed)");
+    }
+    const QJsonObject narrowHello = takeFirstObject(narrowHelloSpy);
+    QVERIFY(narrowHello.value(QLatin1String(protocol::keys::kResumed)).toBool());
+    QCOMPARE(narrowHello.value(QLatin1String(protocol::keys::kSession)).toString(), narrowSession);
+    QTRY_COMPARE_WITH_TIMEOUT(replica.properties(notifierId).value(QStringLiteral("value")).toInt(),
+                              5, 5000);
+    QVERIFY(!sawChange(narrowChangedSpy, QStringLiteral("objectName")));
+
+    QSignalSpy wideChangedSpy(&wide, &qt_spy::BridgeClient::propertiesChanged);
+    if (!connectAndAttach(wide, serverName, wideHelloSpy, QStringLiteral("resume-wide"))) {
+        QSKIP("Bridge client reconnection not available (likely sandboxed)");
+    }
+    const QJsonObject wideHello = takeFirstObject(wideHelloSpy);
+    QVERIFY(wideHello.value(QLatin1String(protocol::keys::kResumed)).toBool());
+    QCOMPARE(wideHello.value(QLatin1String(protocol::keys::kSession)).toString(), wideSession);
+    QTRY_VERIFY_WITH_TIMEOUT(sawChange(wideChangedSpy, QStringLiteral("objectName")), 5000);
+
+    // Subscriptions carry over without subscribing again.
+    narrowChangedSpy.clear();
+    notifier.setValue(6);
+    QTRY_COMPARE_WITH_TIMEOUT(replica.properties(notifierId).value(QStringLiteral("value")).toInt(),
+                              6, 5000);
+    QCOMPARE(probe.stats().propertySubscriptions, 2);
+
+    narrow.disconnectFromServer();
+    wide.disconnectFromServer();
+    probe.stop();
+}
+
 } // namespace
 
 QTEST_MAIN(BridgeClientTest)
@@ -13,7 +13,9 @@
 #include <QJsonValue>
 #include <QLocalSocket>
 #include <QSet>
+#include <QTimer>
 #include <QUuid>
+#include <QVector>
 
 #include <QtEndian>
 
@@ -28,6 +30,31 @@ QString uniqueServerName(const QString &tag)
         .arg(QUuid::createUuid().toString(QUuid::Id128));
 }
 
+// propertiesChanged frames batch one entry per object under "changes".
+QJsonObject changeForId(const QJsonObject &message, qt_spy::NodeId id)
+{
+    const QJsonArray changes = message.value(QLatin1String(protocol::keys::kChanges)).toArray();
+    for (const QJsonValue &value : changes) {
+        const QJsonObject change = value.toObject();
+        if (protocol::nodeIdFromJson(change.value(QLatin1String(protocol::keys::kId))) == id) {
+            return change;
+        }
+    }
+    return {};
+}
+
+qt_spy::NodeId nodeIdByName(const QJsonObject &snapshot, const QString &objectName)
+{
+    const QJsonArray nodes = snapshot.value(QLatin1String(protocol::keys::kNodes)).toArray();
+    for (const QJsonValue &value : nodes) {
+        const QJsonObject node = value.toObject();
+        if (node.value(QStringLiteral("objectName")).toString() == objectName) {
+            return protocol::nodeIdFromJson(node.value(QLatin1String(protocol::keys::kId)));
+        }
+    }
+    return protocol::kInvalidNodeId;
+}
+
 class NotifyingObject : public QObject {
     Q_OBJECT
     Q_PROPERTY(int value READ value WRITE setValue NOTIFY valueChanged)
@@ -62,6 +89,14 @@ private slots:
     void testSnapshotSerialization();
     void testIncrementalUpdates();
     void testRequestFlows();
+    void testEventDrivenDiscovery();
+    void testSharedRegistry();
+    void testSlowClientBackpressure();
+    void testLargeReplyDoesNotForceResync();
+    void testPropertySubscriptions();
+    void testLazyAttach();
+    void testPropertyRateLimit();
+    void testTimeBudgetedSnapshot();
 
 private:
     static void writeMessage(QLocalSocket &socket, const QJsonObject &message);
@@ -74,6 +109,14 @@ private:
                             const QString &type,
                             QJsonObject *out,
                             int timeoutMs = 2000);
+    static bool subscribe(QLocalSocket &socket,
+                          QByteArray &buffer,
+                          const QJsonObject &request,
+                          QJsonObject *ack = nullptr);
+    static bool subscribeIds(QLocalSocket &socket,
+                             QByteArray &buffer,
+                             const QVector<qt_spy::NodeId> &ids);
+    static bool requestSnapshot(QLocalSocket &socket, QByteArray &buffer, QJsonObject *snapshot);
 };
 
 void ProbeBridgeTest::writeMessage(QLocalSocket &socket, const QJsonObject &message)
@@ -155,6 +198,38 @@ bool ProbeBridgeTest::waitForType(QLocalSocket &socket,
     return false;
 }
 
+bool ProbeBridgeTest::subscribe(QLocalSocket &socket,
+                                QByteArray &buffer,
+                                const QJsonObject &request,
+                                QJsonObject *ack)
+{
+    writeMessage(socket, request);
+    return waitForType(socket, buffer, QLatin1String(protocol::types::kSubscriptionAck), ack, 5000);
+}
+
+bool ProbeBridgeTest::subscribeIds(QLocalSocket &socket,
+                                   QByteArray &buffer,
+                                   const QVector<qt_spy::NodeId> &ids)
+{
+    QJsonArray idArray;
+    for (qt_spy::NodeId id : ids) {
+        idArray.append(protocol::nodeIdToJson(id));
+    }
+    QJsonObject request;
+    request[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSubscribe);
+    request[QLatin1String(protocol::keys::kIds)] = idArray;
+    return subscribe(socket, buffer, request);
+}
+
+bool ProbeBridgeTest::requestSnapshot(QLocalSocket &socket, QByteArray &buffer, QJsonObject *snapshot)
+{
+    QJsonObject request;
+    request[QLatin1String(protocol::keys::kType)] =
+        QLatin1String(protocol::types::kSnapshotRequest);
+    writeMessage(socket, request);
+    return waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), snapshot, 5000);
+}
+
 void ProbeBridgeTest::testSnapshotSerialization()
 {
     qt_spy::ProbeOptions options;
@@ -212,8 +287,8 @@ void ProbeBridgeTest::testSnapshotSerialization()
     QHash<QString, QJsonObject> nodesByName;
     for (const QJsonValue &value : nodes) {
         const QJsonObject node = value.toObject();
-        const QString id = node.value(QLatin1String(protocol::keys::kId)).toString();
-        QVERIFY(!id.isEmpty());
+        const qt_spy::NodeId id = protocol::nodeIdFromJson(node.value(QLatin1String(protocol::keys::kId)));
+        QVERIFY(id != protocol::kInvalidNodeId);
         nodesByName.insert(node.value(QStringLiteral("objectName")).toString(), node);
     }
 
@@ -223,23 +298,23 @@ void ProbeBridgeTest::testSnapshotSerialization()
     const QJsonObject rootNode = nodesByName.value(QStringLiteral("rootNode"));
     const QJsonObject childNode = nodesByName.value(QStringLiteral("childNode"));
 
-    const QString rootId = rootNode.value(QLatin1String(protocol::keys::kId)).toString();
-    const QString childId = childNode.value(QLatin1String(protocol::keys::kId)).toString();
-    QVERIFY(!rootId.isEmpty());
-    QVERIFY(!childId.isEmpty());
+    const qt_spy::NodeId rootId = protocol::nodeIdFromJson(rootNode.value(QLatin1String(protocol::keys::kId)));
+    const qt_spy::NodeId childId = protocol::nodeIdFromJson(childNode.value(QLatin1String(protocol::keys::kId)));
+    QVERIFY(rootId != protocol::kInvalidNodeId);
+    QVERIFY(childId != protocol::kInvalidNodeId);
 
     QVERIFY(!rootNode.contains(QLatin1String(protocol::keys::kParentId)));
-    QCOMPARE(childNode.value(QLatin1String(protocol::keys::kParentId)).toString(), rootId);
+    QCOMPARE(protocol::nodeIdFromJson(childNode.value(QLatin1String(protocol::keys::kParentId))), rootId);
 
     const QJsonArray childIds = rootNode.value(QLatin1String(protocol::keys::kChildIds)).toArray();
-    QVERIFY(childIds.contains(QJsonValue(childId)));
+    QVERIFY(childIds.contains(protocol::nodeIdToJson(childId)));
 
     const QJsonObject props = rootNode.value(QLatin1String(protocol::keys::kProperties)).toObject();
     const QString dynamicValue = props.value(QStringLiteral("__dynamic")).toObject().value(QStringLiteral("dynamicKey")).toString();
     QCOMPARE(dynamicValue, QStringLiteral("dynamicValue"));
 
     const QJsonArray rootIds = message.value(QLatin1String(protocol::keys::kRootIds)).toArray();
-    QVERIFY(rootIds.contains(QJsonValue(rootId)));
+    QVERIFY(rootIds.contains(protocol::nodeIdToJson(rootId)));
 
     socket.disconnectFromServer();
     probe.stop();
@@ -291,15 +366,20 @@ void ProbeBridgeTest::testIncrementalUpdates()
     QCOMPARE(message.value(QLatin1String(protocol::keys::kType)).toString(),
              QLatin1String(protocol::types::kSnapshot));
 
+    const qt_spy::NodeId notifierId = nodeIdByName(message, QStringLiteral("notifier"));
+    QVERIFY2(notifierId != protocol::kInvalidNodeId, "Notifier id not found in snapshot");
+    QVERIFY(subscribeIds(socket, buffer, {notifierId}));
+
     notifier.setValue(42);
     QJsonObject propertiesMessage;
     QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged),
                         &propertiesMessage));
+    const QJsonObject notifierChange = changeForId(propertiesMessage, notifierId);
     const QJsonArray changedProps =
-        propertiesMessage.value(QLatin1String(protocol::keys::kChanged)).toArray();
+        notifierChange.value(QLatin1String(protocol::keys::kChanged)).toArray();
     QVERIFY(changedProps.contains(QStringLiteral("value")));
     const QJsonObject props =
-        propertiesMessage.value(QLatin1String(protocol::keys::kProperties)).toObject();
+        notifierChange.value(QLatin1String(protocol::keys::kProperties)).toObject();
     QCOMPARE(props.value(QStringLiteral("value")).toInt(), 42);
 
     auto *dynamicChild = new QObject(&notifier);
@@ -309,28 +389,35 @@ void ProbeBridgeTest::testIncrementalUpdates()
     QJsonObject nodeAdded;
     QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kNodeAdded), &nodeAdded));
     const QJsonObject node = nodeAdded.value(QLatin1String(protocol::keys::kNode)).toObject();
-    const QString childId = node.value(QLatin1String(protocol::keys::kId)).toString();
-    QVERIFY2(!childId.isEmpty(), "Did not receive nodeAdded with an id");
-
+    const qt_spy::NodeId childId = protocol::nodeIdFromJson(node.value(QLatin1String(protocol::keys::kId)));
+    QVERIFY2(childId != protocol::kInvalidNodeId, "Did not receive nodeAdded with an id");
+    // Discovery runs after the current event-loop pass, so the announced
+    // node already reflects what the creator set up.
+    QCOMPARE(node.value(QStringLiteral("objectName")).toString(), QStringLiteral("dynamicChild"));
+    QVERIFY(subscribeIds(socket, buffer, {childId}));
+
+    dynamicChild->setObjectName(QStringLiteral("renamedChild"));
     QJsonObject childProps;
     for (int attempt = 0; attempt < 5; ++attempt) {
-        QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged), &childProps));
-        if (childProps.value(QLatin1String(protocol::keys::kId)).toString() == childId) {
+        QJsonObject batch;
+        QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged), &batch));
+        childProps = changeForId(batch, childId);
+        if (!childProps.isEmpty()) {
             break;
         }
     }
-    QCOMPARE(childProps.value(QLatin1String(protocol::keys::kId)).toString(), childId);
+    QCOMPARE(protocol::nodeIdFromJson(childProps.value(QLatin1String(protocol::keys::kId))), childId);
     const QJsonObject childPropsPayload =
         childProps.value(QLatin1String(protocol::keys::kProperties)).toObject();
     QCOMPARE(childPropsPayload.value(QStringLiteral("objectName")).toString(),
-             QStringLiteral("dynamicChild"));
+             QStringLiteral("renamedChild"));
 
     delete dynamicChild;
     QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
 
     QJsonObject nodeRemoved;
     QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kNodeRemoved), &nodeRemoved));
-    QCOMPARE(nodeRemoved.value(QLatin1String(protocol::keys::kId)).toString(), childId);
+    QCOMPARE(protocol::nodeIdFromJson(nodeRemoved.value(QLatin1String(protocol::keys::kId))), childId);
 
     socket.disconnectFromServer();
     probe.stop();
@@ -387,27 +474,27 @@ void ProbeBridgeTest::testRequestFlows()
              QLatin1String(protocol::types::kSnapshot));
 
     const QJsonArray nodes = message.value(QLatin1String(protocol::keys::kNodes)).toArray();
-    QHash<QString, QString> idsByName;
+    QHash<QString, qt_spy::NodeId> idsByName;
     for (const QJsonValue &value : nodes) {
         const QJsonObject node = value.toObject();
         idsByName.insert(node.value(QStringLiteral("objectName")).toString(),
-                         node.value(QLatin1String(protocol::keys::kId)).toString());
+                         protocol::nodeIdFromJson(node.value(QLatin1String(protocol::keys::kId))));
     }
 
-    const QString targetId = idsByName.value(QStringLiteral("child"));
-    QVERIFY2(!targetId.isEmpty(), "Expected child node id");
+    const qt_spy::NodeId targetId = idsByName.value(QStringLiteral("child"));
+    QVERIFY2(targetId != protocol::kInvalidNodeId, "Expected child node id");
 
     QJsonObject propertiesRequest;
     propertiesRequest[QLatin1String(protocol::keys::kType)] =
         QLatin1String(protocol::types::kPropertiesRequest);
-    propertiesRequest[QLatin1String(protocol::keys::kId)] = targetId;
+    propertiesRequest[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(targetId);
     propertiesRequest[QLatin1String(protocol::keys::kRequestId)] = QStringLiteral("req_props");
     writeMessage(socket, propertiesRequest);
 
     QJsonObject propertiesMessage;
     QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kProperties),
                         &propertiesMessage));
-    QCOMPARE(propertiesMessage.value(QLatin1String(protocol::keys::kId)).toString(), targetId);
+    QCOMPARE(protocol::nodeIdFromJson(propertiesMessage.value(QLatin1String(protocol::keys::kId))), targetId);
     QCOMPARE(propertiesMessage.value(QLatin1String(protocol::keys::kRequestId)).toString(),
              QStringLiteral("req_props"));
 
@@ -419,13 +506,13 @@ void ProbeBridgeTest::testRequestFlows()
     QJsonObject selectRequest;
     selectRequest[QLatin1String(protocol::keys::kType)] =
         QLatin1String(protocol::types::kSelectNode);
-    selectRequest[QLatin1String(protocol::keys::kId)] = targetId;
+    selectRequest[QLatin1String(protocol::keys::kId)] = protocol::nodeIdToJson(targetId);
     selectRequest[QLatin1String(protocol::keys::kRequestId)] = QStringLiteral("req_select");
     writeMessage(socket, selectRequest);
 
     QJsonObject selectionAck;
     QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSelectionAck), &selectionAck));
-    QCOMPARE(selectionAck.value(QLatin1String(protocol::keys::kId)).toString(), targetId);
+    QCOMPARE(protocol::nodeIdFromJson(selectionAck.value(QLatin1String(protocol::keys::kId))), targetId);
     QCOMPARE(selectionAck.value(QLatin1String(protocol::keys::kRequestId)).toString(),
              QStringLiteral("req_select"));
 
@@ -437,7 +524,709 @@ void ProbeBridgeTest::testRequestFlows()
 
     QJsonObject verifySnapshot;
     QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &verifySnapshot));
-    QCOMPARE(verifySnapshot.value(QLatin1String(protocol::keys::kSelection)).toString(), targetId);
+    QCOMPARE(protocol::nodeIdFromJson(verifySnapshot.value(QLatin1String(protocol::keys::kSelection))), targetId);
+
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testEventDrivenDiscovery()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject existing(QCoreApplication::instance());
+    existing.setObjectName(QStringLiteral("existingRoot"));
+    for (int i = 0; i < 50; ++i) {
+        new QObject(&existing);
+    }
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("discovery-test");
+    writeMessage(socket, attach);
+    QVERIFY(readMessage(socket, buffer, &message, 5000));
+    QCOMPARE(message.value(QLatin1String(protocol::keys::kType)).toString(),
+             QLatin1String(protocol::types::kHello));
+
+    // Nothing changes while idle, so no discovery pass should run at all.
+    QTest::qWait(1500);
+    const qt_spy::ProbeStats idle = probe.stats();
+    QCOMPARE(idle.totalRefreshVisited, quint64(0));
+
+    // A new root under the application is announced by itself; the existing
+    // tree is not walked again.
+    QObject added(QCoreApplication::instance());
+    added.setObjectName(QStringLiteral("addedRoot"));
+    new QObject(&added);
+
+    QJsonObject nodeAdded;
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kNodeAdded), &nodeAdded, 5000));
+    const QJsonObject node = nodeAdded.value(QLatin1String(protocol::keys::kNode)).toObject();
+    QCOMPARE(node.value(QStringLiteral("objectName")).toString(), QStringLiteral("addedRoot"));
+    QVERIFY(!nodeAdded.contains(QLatin1String(protocol::keys::kParentId)));
+
+    const qt_spy::ProbeStats afterAdd = probe.stats();
+    QVERIFY(afterAdd.refreshCount > idle.refreshCount);
+    QCOMPARE(afterAdd.totalRefreshVisited - idle.totalRefreshVisited, quint64(2));
+
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testSharedRegistry()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject notifier(QCoreApplication::instance());
+    notifier.setObjectName(QStringLiteral("sharedNotifier"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket first;
+    QLocalSocket second;
+    first.connectToServer(serverName);
+    second.connectToServer(serverName);
+    if (!first.waitForConnected(2000) || !second.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray firstBuffer;
+    QByteArray secondBuffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("shared-first");
+    writeMessage(first, attach);
+    QVERIFY(waitForType(first, firstBuffer, QLatin1String(protocol::types::kHello), &message));
+    QVERIFY(requestSnapshot(first, firstBuffer, &message));
+    const qt_spy::NodeId notifierId = nodeIdByName(message, QStringLiteral("sharedNotifier"));
+    QVERIFY(notifierId != protocol::kInvalidNodeId);
+
+    // Nothing is observed until a client asks for it.
+    QCOMPARE(probe.stats().notifyConnections, 0);
+    QVERIFY(subscribeIds(first, firstBuffer, {notifierId}));
+    const qt_spy::ProbeStats single = probe.stats();
+    QVERIFY(single.trackedObjects > 0);
+    QVERIFY(single.notifyConnections > 0);
+    QCOMPARE(single.propertySubscriptions, 1);
+    QVERIFY(single.objectTableBytes > 0);
+    QVERIFY(single.bytesPerTrackedObject > 0);
+
+    // A second client shares the tracking instead of duplicating it.
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("shared-second");
+    writeMessage(second, attach);
+    QVERIFY(waitForType(second, secondBuffer, QLatin1String(protocol::types::kHello), &message));
+    const qt_spy::ProbeStats shared = probe.stats();
+    QCOMPARE(shared.trackedObjects, single.trackedObjects);
+    QVERIFY(subscribeIds(second, secondBuffer, {notifierId}));
+    QCOMPARE(probe.stats().notifyConnections, single.notifyConnections);
+    QCOMPARE(probe.stats().propertySubscriptions, 2);
+
+    // One change reaches both clients with the same node id.
+    notifier.setValue(7);
+    QJsonObject firstChange;
+    QJsonObject secondChange;
+    QVERIFY(waitForType(first, firstBuffer, QLatin1String(protocol::types::kPropertiesChanged), &firstChange));
+    QVERIFY(waitForType(second, secondBuffer, QLatin1String(protocol::types::kPropertiesChanged), &secondChange));
+    QCOMPARE(firstChange, secondChange);
+    const QJsonArray changes = firstChange.value(QLatin1String(protocol::keys::kChanges)).toArray();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(protocol::nodeIdFromJson(changes.first().toObject().value(QLatin1String(protocol::keys::kId))),
+             notifierId);
+
+    // Tracking survives the first client leaving.
+    first.disconnectFromServer();
+    QTest::qWait(100);
+    QCOMPARE(probe.stats().trackedObjects, single.trackedObjects);
+    QCOMPARE(probe.stats().propertySubscriptions, 1);
+
+    notifier.setValue(8);
+    QVERIFY(waitForType(second, secondBuffer, QLatin1String(protocol::types::kPropertiesChanged), &secondChange));
+    QCOMPARE(changeForId(secondChange, notifierId).value(QLatin1String(protocol::keys::kProperties))
+                 .toObject().value(QStringLiteral("value")).toInt(), 8);
+
+    second.disconnectFromServer();
+    QTest::qWait(100);
+    QCOMPARE(probe.stats().trackedObjects, 0);
+    QCOMPARE(probe.stats().bytesPerTrackedObject, 0);
+    probe.stop();
+}
+
+void ProbeBridgeTest::testSlowClientBackpressure()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+    options.sendQueueHighWater = 64 * 1024;
+    options.sendQueueLimit = 256 * 1024;
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject target(QCoreApplication::instance());
+    target.setObjectName(QStringLiteral("backpressureTarget"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("slow-client");
+    writeMessage(socket, attach);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kHello), &message));
+    QVERIFY(requestSnapshot(socket, buffer, &message));
+    const qt_spy::NodeId targetId = nodeIdByName(message, QStringLiteral("backpressureTarget"));
+    QVERIFY(targetId != protocol::kInvalidNodeId);
+    QVERIFY(subscribeIds(socket, buffer, {targetId}));
+
+    // Stop reading: once the kernel buffer is full the probe has to queue.
+    socket.setReadBufferSize(1024);
+    const QString blob(32 * 1024, QLatin1Char('x'));
+
+    // Repeated changes to one property are merged instead of piling up.
+    for (int i = 0; i < 100; ++i) {
+        target.setProperty("blob", blob + QString::number(i));
+        QCoreApplication::processEvents();
+    }
+    const qt_spy::ProbeStats merged = probe.stats();
+    QVERIFY(merged.coalescedChanges > 0);
+    QCOMPARE(merged.resyncCount, quint64(0));
+    QVERIFY(merged.queuedBytes <= options.sendQueueLimit);
+
+    // Distinct changes cannot be merged away; past the limit the client is
+    // cut off from updates until it resyncs.
+    for (int i = 0; i < 100; ++i) {
+        target.setProperty(QStringLiteral("blob_%1").arg(i).toUtf8().constData(), blob);
+        QCoreApplication::processEvents();
+    }
+    const qt_spy::ProbeStats overrun = probe.stats();
+    QCOMPARE(overrun.resyncCount, quint64(1));
+    QVERIFY(overrun.droppedFrames > 0);
+    QVERIFY(overrun.queuedBytes <= options.sendQueueLimit);
+
+    socket.setReadBufferSize(0);
+    QJsonObject resync;
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kResyncRequired), &resync, 10000));
+    QVERIFY(resync.value(QLatin1String(protocol::keys::kDropped)).toInt() > 0);
+
+    // A fresh snapshot resumes the updates.
+    QJsonObject snapshotRequest;
+    snapshotRequest[QLatin1String(protocol::keys::kType)] =
+        QLatin1String(protocol::types::kSnapshotRequest);
+    snapshotRequest[QLatin1String(protocol::keys::kFields)] =
+        QLatin1String(protocol::fields::kStructure);
+    writeMessage(socket, snapshotRequest);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &message, 10000));
+
+    target.setProperty("afterResync", true);
+    QJsonObject change;
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged), &change, 5000));
+    const QJsonArray changes = change.value(QLatin1String(protocol::keys::kChanges)).toArray();
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().toObject().value(QLatin1String(protocol::keys::kChanged)).toArray(),
+             QJsonArray{QStringLiteral("afterResync")});
+
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testLargeReplyDoesNotForceResync()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+    options.sendQueueHighWater = 64 * 1024;
+    options.sendQueueLimit = 256 * 1024;
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject target(QCoreApplication::instance());
+    target.setObjectName(QStringLiteral("largeReplyTarget"));
+    QObject bulky(QCoreApplication::instance());
+    bulky.setObjectName(QStringLiteral("largeReplyBulk"));
+    bulky.setProperty("blob", QString(4 * 1024 * 1024, QLatin1Char('x')));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("large-reply-client");
+    writeMessage(socket, attach);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kHello), &message));
+    QVERIFY(requestSnapshot(socket, buffer, &message));
+    const qt_spy::NodeId targetId = nodeIdByName(message, QStringLiteral("largeReplyTarget"));
+    QVERIFY(targetId != protocol::kInvalidNodeId);
+    QVERIFY(subscribeIds(socket, buffer, {targetId}));
+
+    // Leave a snapshot far larger than the limit sitting in the queue.
+    socket.setReadBufferSize(1024);
+    QJsonObject snapshotRequest;
+    snapshotRequest[QLatin1String(protocol::keys::kType)] =
+        QLatin1String(protocol::types::kSnapshotRequest);
+    writeMessage(socket, snapshotRequest);
+    QTRY_VERIFY_WITH_TIMEOUT(probe.stats().queuedBytes > options.sendQueueLimit, 10000);
+
+    // Events behind it only count their own bytes against the limit.
+    for (int i = 0; i < 10; ++i) {
+        target.setProperty(QStringLiteral("small_%1").arg(i).toUtf8().constData(), i);
+        QCoreApplication::processEvents();
+    }
+    QCOMPARE(probe.stats().resyncCount, quint64(0));
+    QCOMPARE(probe.stats().droppedFrames, quint64(0));
+
+    socket.setReadBufferSize(0);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &message, 10000));
+    QJsonObject change;
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged), &change, 5000));
+    QCOMPARE(probe.stats().resyncCount, quint64(0));
+
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testPropertySubscriptions()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject watched(QCoreApplication::instance());
+    watched.setObjectName(QStringLiteral("watched"));
+    NotifyingObject ignored(QCoreApplication::instance());
+    ignored.setObjectName(QStringLiteral("ignored"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("subscriptions-test");
+    writeMessage(socket, attach);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kHello), &message));
+    QVERIFY(requestSnapshot(socket, buffer, &message));
+    const qt_spy::NodeId watchedId = nodeIdByName(message, QStringLiteral("watched"));
+    QVERIFY(watchedId != protocol::kInvalidNodeId);
+
+    // Ids the probe does not know are reported back instead of failing the request.
+    const qt_spy::NodeId staleId = protocol::kMaxNodeId;
+    QJsonObject request;
+    request[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSubscribe);
+    request[QLatin1String(protocol::keys::kRequestId)] = QStringLiteral("sub_1");
+    request[QLatin1String(protocol::keys::kIds)] =
+        QJsonArray{protocol::nodeIdToJson(watchedId), protocol::nodeIdToJson(staleId)};
+    request[QLatin1String(protocol::keys::kPropertyNames)] = QJsonArray{QStringLiteral("value")};
+    QJsonObject ack;
+    QVERIFY(subscribe(socket, buffer, request, &ack));
+    QCOMPARE(ack.value(QLatin1String(protocol::keys::kRequestId)).toString(), QStringLiteral("sub_1"));
+    QCOMPARE(ack.value(QLatin1String(protocol::keys::kIds)).toArray(),
+             QJsonArray{protocol::nodeIdToJson(watchedId)});
+    QCOMPARE(ack.value(QLatin1String(protocol::keys::kUnknownIds)).toArray(),
+             QJsonArray{protocol::nodeIdToJson(staleId)});
+
+    // Only the subscribed node is reported, projected to the requested names.
+    ignored.setValue(1);
+    watched.setObjectName(QStringLiteral("watchedRenamed"));
+    watched.setValue(2);
+    QJsonObject change;
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged), &change));
+    const QJsonArray changes = change.value(QLatin1String(protocol::keys::kChanges)).toArray();
+    QCOMPARE(changes.size(), 1);
+    const QJsonObject watchedChange = changeForId(change, watchedId);
+    QCOMPARE(watchedChange.value(QLatin1String(protocol::keys::kChanged)).toArray(),
+             QJsonArray{QStringLiteral("value")});
+    const QJsonObject properties =
+        watchedChange.value(QLatin1String(protocol::keys::kProperties)).toObject();
+    QCOMPARE(properties.value(QStringLiteral("value")).toInt(), 2);
+    QVERIFY(!properties.contains(QStringLiteral("objectName")));
+
+    // After unsubscribing nothing more arrives and the signals are disconnected.
+    request[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kUnsubscribe);
+    request[QLatin1String(protocol::keys::kRequestId)] = QStringLiteral("unsub_1");
+    request[QLatin1String(protocol::keys::kIds)] = QJsonArray{protocol::nodeIdToJson(watchedId)};
+    QVERIFY(subscribe(socket, buffer, request, &ack));
+    QCOMPARE(ack.value(QLatin1String(protocol::keys::kRequestId)).toString(), QStringLiteral("unsub_1"));
+    QCOMPARE(probe.stats().propertySubscriptions, 0);
+    QCOMPARE(probe.stats().notifyConnections, 0);
+
+    watched.setValue(3);
+    QVERIFY(!waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged), &change, 300));
+
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testLazyAttach()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+    options.lazyAttach = true;
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("lazyRoot"));
+    QObject child(&root);
+    child.setObjectName(QStringLiteral("lazyChild"));
+    QObject grandchild(&child);
+    grandchild.setObjectName(QStringLiteral("lazyGrandchild"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("lazy-test");
+    writeMessage(socket, attach);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kHello), &message));
+    const int rootsOnly = probe.stats().trackedObjects;
+
+    // Only the roots are tracked on attach; their children are counted.
+    QJsonObject request;
+    request[QLatin1String(protocol::keys::kType)] =
+        QLatin1String(protocol::types::kSnapshotRequest);
+    request[QLatin1String(protocol::keys::kMaxDepth)] = 0;
+    writeMessage(socket, request);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &message, 5000));
+    QCOMPARE(message.value(QLatin1String(protocol::keys::kNodes)).toArray().size(), rootsOnly);
+    const qt_spy::NodeId rootId = nodeIdByName(message, QStringLiteral("lazyRoot"));
+    QVERIFY(rootId != protocol::kInvalidNodeId);
+    QCOMPARE(probe.stats().trackedObjects, rootsOnly);
+
+    // Reporting a subtree instruments exactly what was reported.
+    request[QLatin1String(protocol::keys::kRootId)] = protocol::nodeIdToJson(rootId);
+    request[QLatin1String(protocol::keys::kMaxDepth)] = 1;
+    writeMessage(socket, request);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &message, 5000));
+    QCOMPARE(message.value(QLatin1String(protocol::keys::kNodes)).toArray().size(), 2);
+    QVERIFY(nodeIdByName(message, QStringLiteral("lazyGrandchild")) == protocol::kInvalidNodeId);
+    QCOMPARE(probe.stats().trackedObjects, rootsOnly + 1);
+
+    // New objects are announced only below nodes whose children are tracked,
+    // and come with a childCount until a client asks for their subtree.
+    auto *hidden = new QObject(&child);
+    hidden->setObjectName(QStringLiteral("lazyHidden"));
+    auto *announced = new QObject(&root);
+    announced->setObjectName(QStringLiteral("lazyAnnounced"));
+    new QObject(announced);
+
+    QJsonObject nodeAdded;
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kNodeAdded), &nodeAdded));
+    const QJsonObject node = nodeAdded.value(QLatin1String(protocol::keys::kNode)).toObject();
+    QCOMPARE(node.value(QStringLiteral("objectName")).toString(), QStringLiteral("lazyAnnounced"));
+    QCOMPARE(node.value(QLatin1String(protocol::keys::kChildCount)).toInt(), 1);
+    QVERIFY(!node.contains(QLatin1String(protocol::keys::kChildIds)));
+    QCOMPARE(probe.stats().trackedObjects, rootsOnly + 2);
+    QVERIFY(!waitForType(socket, buffer, QLatin1String(protocol::types::kNodeAdded), &nodeAdded, 300));
+
+    // Children only counted at the depth limit get no table slots, so churn
+    // below such a node leaves the table as it was.
+    const auto churnBelowDepthLimit = [&]() {
+        QVector<QObject *> churn;
+        for (int i = 0; i < 100; ++i) {
+            churn.append(new QObject(&child));
+        }
+        writeMessage(socket, request);
+        const bool received = waitForType(socket, buffer,
+                                          QLatin1String(protocol::types::kSnapshot), &message, 5000);
+        qDeleteAll(churn);
+        QCoreApplication::processEvents();
+        return received;
+    };
+    QVERIFY(churnBelowDepthLimit());
+    const qt_spy::ProbeStats afterChurn = probe.stats();
+    for (int round = 0; round < 5; ++round) {
+        QVERIFY(churnBelowDepthLimit());
+    }
+    QCOMPARE(probe.stats().trackedObjects, afterChurn.trackedObjects);
+    QCOMPARE(probe.stats().objectTableBytes, afterChurn.objectTableBytes);
+
+    delete announced;
+    delete hidden;
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testPropertyRateLimit()
+{
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    NotifyingObject gauge(QCoreApplication::instance());
+    gauge.setObjectName(QStringLiteral("gauge"));
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("rate-limit-test");
+    writeMessage(socket, attach);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kHello), &message));
+    QVERIFY(requestSnapshot(socket, buffer, &message));
+    const qt_spy::NodeId gaugeId = nodeIdByName(message, QStringLiteral("gauge"));
+    QVERIFY(gaugeId != protocol::kInvalidNodeId);
+
+    QJsonObject request;
+    request[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kSubscribe);
+    request[QLatin1String(protocol::keys::kIds)] = QJsonArray{protocol::nodeIdToJson(gaugeId)};
+    request[QLatin1String(protocol::keys::kMaxRateHz)] = -1;
+    writeMessage(socket, request);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kError), &message));
+    QCOMPARE(message.value(QStringLiteral("code")).toString(), QStringLiteral("invalidRequest"));
+
+    request[QLatin1String(protocol::keys::kMaxRateHz)] = 5;
+    QVERIFY(subscribe(socket, buffer, request));
+
+    // A burst inside one window: the first change goes out at once, the rest
+    // collapse into one trailing update with the final value.
+    constexpr int kBurst = 50;
+    for (int i = 1; i <= kBurst; ++i) {
+        gauge.setValue(i);
+        QCoreApplication::processEvents();
+    }
+
+    int deliveries = 0;
+    int lastValue = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 1000) {
+        QJsonObject change;
+        if (!waitForType(socket, buffer, QLatin1String(protocol::types::kPropertiesChanged),
+                         &change, 100)) {
+            continue;
+        }
+        ++deliveries;
+        lastValue = changeForId(change, gaugeId).value(QLatin1String(protocol::keys::kProperties))
+                        .toObject().value(QStringLiteral("value")).toInt();
+    }
+    QCOMPARE(lastValue, kBurst);
+    QVERIFY(deliveries >= 2 && deliveries <= 4);
+    QVERIFY(probe.stats().rateLimitedChanges >= quint64(kBurst - 2 * deliveries));
+
+    socket.disconnectFromServer();
+    probe.stop();
+}
+
+void ProbeBridgeTest::testTimeBudgetedSnapshot()
+{
+    constexpr int kGroups = 200;
+    constexpr int kObjectsPerGroup = 99;
+
+    qt_spy::ProbeOptions options;
+    options.autoStart = false;
+    options.serverName = uniqueServerName(QStringLiteral("probe_bridge"));
+    options.snapshotTimeBudgetMs = 1;
+
+    qt_spy::Probe probe(options);
+    const QString serverName = probe.serverName();
+
+    QObject root(QCoreApplication::instance());
+    root.setObjectName(QStringLiteral("slicedRoot"));
+    QVector<QObject *> groups;
+    for (int g = 0; g < kGroups; ++g) {
+        auto *group = new QObject(&root);
+        group->setObjectName(QStringLiteral("slicedGroup%1").arg(g));
+        for (int o = 0; o < kObjectsPerGroup; ++o) {
+            new QObject(group);
+        }
+        groups.append(group);
+    }
+
+    probe.start();
+    if (!probe.isListening()) {
+        QSKIP("Probe failed to listen on local socket");
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(2000)) {
+        QSKIP("Failed to connect to probe server (likely sandboxed)");
+    }
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+
+    QByteArray buffer;
+    QJsonObject message;
+
+    QJsonObject attach;
+    attach[QLatin1String(protocol::keys::kType)] = QLatin1String(protocol::types::kAttach);
+    attach[QLatin1String(protocol::keys::kProtocolVersion)] = protocol::kVersion;
+    attach[QLatin1String(protocol::keys::kClientName)] = QStringLiteral("sliced-test");
+    writeMessage(socket, attach);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kHello), &message));
+
+    // Change the tree while the reply is still queued, which it is for the
+    // whole walk.
+    const auto mutate = [&]() {
+        delete groups.takeFirst();
+        auto *late = new QObject(&root);
+        late->setObjectName(QStringLiteral("slicedLate"));
+    };
+    QTimer mutator;
+    mutator.setInterval(0);
+    connect(&mutator, &QTimer::timeout, this, [&]() {
+        if (probe.stats().queuedFrames > 0) {
+            mutator.stop();
+            mutate();
+        }
+    });
+    mutator.start();
+
+    QJsonObject request;
+    request[QLatin1String(protocol::keys::kType)] =
+        QLatin1String(protocol::types::kSnapshotRequest);
+    writeMessage(socket, request);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &message, 30000));
+    QVERIFY(probe.stats().lastSnapshotSlices > 1);
+    if (mutator.isActive()) {
+        mutator.stop();
+        mutate();
+    }
+
+    // The snapshot plus the updates queued behind it is the current tree.
+    QSet<qt_spy::NodeId> ids;
+    const QJsonArray nodes = message.value(QLatin1String(protocol::keys::kNodes)).toArray();
+    for (const QJsonValue &node : nodes) {
+        ids.insert(protocol::nodeIdFromJson(node.toObject().value(QLatin1String(protocol::keys::kId))));
+    }
+    const qt_spy::NodeId rootId = nodeIdByName(message, QStringLiteral("slicedRoot"));
+    QVERIFY(rootId != protocol::kInvalidNodeId);
+
+    qt_spy::NodeId lateId = protocol::kInvalidNodeId;
+    while (lateId == protocol::kInvalidNodeId) {
+        QVERIFY(readMessage(socket, buffer, &message, 5000));
+        const QString type = message.value(QLatin1String(protocol::keys::kType)).toString();
+        const QJsonObject node = message.value(QLatin1String(protocol::keys::kNode)).toObject();
+        if (type == QLatin1String(protocol::types::kNodeRemoved)) {
+            ids.remove(protocol::nodeIdFromJson(message.value(QLatin1String(protocol::keys::kId))));
+        } else if (type == QLatin1String(protocol::types::kNodeAdded)) {
+            const qt_spy::NodeId id =
+                protocol::nodeIdFromJson(node.value(QLatin1String(protocol::keys::kId)));
+            ids.insert(id);
+            if (node.value(QStringLiteral("objectName")).toString() == QStringLiteral("slicedLate")) {
+                lateId = id;
+            }
+        }
+    }
+    QVERIFY(ids.contains(rootId));
+    QVERIFY(ids.contains(lateId));
+
+    request[QLatin1String(protocol::keys::kRootId)] = protocol::nodeIdToJson(rootId);
+    writeMessage(socket, request);
+    QVERIFY(waitForType(socket, buffer, QLatin1String(protocol::types::kSnapshot), &message, 30000));
+    const QJsonArray current = message.value(QLatin1String(protocol::keys::kNodes)).toArray();
+    QCOMPARE(current.size(), 1 + (kGroups - 1) * (kObjectsPerGroup + 1) + 1);
+    for (const QJsonValue &node : current) {
+        QVERIFY(ids.contains(
+            protocol::nodeIdFromJson(node.toObject().value(QLatin1String(protocol::keys::kId)))));
+    }
 
     socket.disconnectFromServer();
     probe.stop();